@@ -3,6 +3,12 @@
 
 #define AUDIO_NUM_CHANNELS 32
 #define AUDIO_FORMAT_FLOAT 1
+#define AUDIO_MIX_QUEUE    256  // commands, power of two
+#define AUDIO_MIX_BLOCK    1024 // frames mixed at once
+#define AUDIO_FILTER_TAPS  64
+#define AUDIO_FILTER_PHASES 256 // phase is top 8 bits of position fraction
+#define AUDIO_MAX_FILTERS  16   // distinct sound rates
+#define AUDIO_MIX_WINDOW   (AUDIO_MIX_BLOCK*2 + AUDIO_FILTER_TAPS) // source frames copied near sound edges
 
 #define PLAY_SyncStop    32 //Stop the sound now.
 #define PLAY_SyncNoMultiple 16 //Don’t start the sound if already playing.
@@ -11,11 +17,75 @@
 #define PLAY_HasOutPoint 2  //Has out-point information.
 #define PLAY_HasInPoint  1  //Has in-point information.
 
+typedef struct audio_filter
+{   // windowed sinc for one rate ratio, coefficients are interpolated between phases
+    float h[AUDIO_FILTER_PHASES][AUDIO_FILTER_TAPS];
+    float d[AUDIO_FILTER_PHASES][AUDIO_FILTER_TAPS]; // next phase minus this one
+    int rate;
+} audio_filter;
+
+typedef struct audio_mix_kernels
+{
+    const char *name;
+    void (*mix_add)(float *acc, const short *src, int count, float gain);     // same channel layout
+    void (*mix_add_dup)(float *acc, const short *src, int frames, float gain); // mono to stereo
+    void (*store_s16)(short *dst, const float *acc, int count);                // round and saturate
+    void (*store_f32)(float *dst, const float *acc, int count);                // scale to -1..1
+    // output frame i is centered at 32.32 position pos + i*step, src starts AUDIO_FILTER_TAPS/2 - 1 frames before it
+    void (*resample)(short *dst, const short *src, int channels, int frames, const audio_filter *f, uint64_t pos, uint64_t step);
+} audio_mix_kernels;
+
+typedef struct audio_mix_cmd
+{
+    LVGSound *sound; // 0 with PLAY_SyncStop stops all channels
+    const audio_filter *filter;
+    float gain;
+    int flags, start_sample, end_sample, loops;
+} audio_mix_cmd;
+
+typedef struct audio_mix_channel
+{
+    LVGSound *sound;
+    const audio_filter *filter;
+    float gain;
+    int pos, start, end, flags, loops; // source frames
+    uint32_t frac;                     // position between source frames
+    uint64_t step;                     // 32.32 source frames per output frame
+} audio_mix_channel;
+
+typedef struct audio_mp3 audio_mp3;
+
+typedef struct audio_mixer
+{   // play and stop_all are called from game thread, mix from audio thread
+    audio_mix_channel channels[AUDIO_NUM_CHANNELS]; // owned by audio thread
+    audio_mix_cmd queue[AUDIO_MIX_QUEUE];
+    uint32_t head, tail; // head written by game thread only, tail by audio thread only
+    const audio_mix_kernels *k;
+    audio_filter *filters[AUDIO_MAX_FILTERS]; // built and read by game thread, commands carry them
+    audio_mp3 *mp3;                           // decoder per channel
+    float *acc;
+    short *tmp, *win;
+    int rate, out_channels, format, dropped, num_filters;
+} audio_mixer;
+
+const audio_mix_kernels *audio_select_kernels(void);
+void audio_mixer_init(audio_mixer *m, int rate, int channels, int format);
+void audio_mixer_release(audio_mixer *m);
+const audio_filter *audio_mixer_prepare(audio_mixer *m, int rate);
+void audio_mixer_play(audio_mixer *m, LVGSound *sound, int flags, int start_sample, int end_sample, int loops, float gain);
+void audio_mixer_stop_all(audio_mixer *m);
+void audio_mixer_mix(audio_mixer *m, void *stream, int frames);
+#ifdef _TEST
+void audio_bench_mixer(void);
+void audio_bench_mp3(LVGSound *sounds, int num_sounds);
+#endif
+
 typedef struct audio_render
 {
     int (*init)(void **audio_render, int samplerate, int channels, int format, int buffer, int is_capture);
     void (*release)(void *audio_render);
     void (*play)(void *audio_render, LVGSound *sound, int flags, int start_sample, int end_sample, int loops);
     void (*stop_all)(void *audio_render);
-    void (*resample)(void *audio_render, LVGSound *sound);
+    void (*resample)(void *audio_render, LVGSound *sound); // prepare resampling at load, samples keep native rate
+    void (*mix)(void *audio_render, void *stream, int frames); // pull output, 0 when device thread pulls it
 } audio_render;
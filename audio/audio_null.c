@@ -1,26 +1,39 @@
 #include <config.h>
 #include <audio/audio.h>
 
+// no device: mixer output is pulled by caller, e.g. offline render
 static int null_audio_init(void **audio_render, int samplerate, int channels, int format, int buffer, int is_capture)
 {
-    *audio_render = (void *)1;
-    return 0;
+    audio_mixer *m = malloc(sizeof(audio_mixer));
+    audio_mixer_init(m, samplerate, channels, format);
+    *audio_render = m;
+    return 1;
 }
 
 static void null_audio_release(void *audio_render)
 {
+    audio_mixer_release((audio_mixer *)audio_render);
+    free(audio_render);
 }
 
 static void null_audio_play(void *audio_render, LVGSound *sound, int flags, int start_sample, int end_sample, int loops)
 {
+    audio_mixer_play((audio_mixer *)audio_render, sound, flags, start_sample, end_sample, loops, 1.0f);
 }
 
 static void null_audio_stop_all(void *audio_render)
 {
+    audio_mixer_stop_all((audio_mixer *)audio_render);
 }
 
 static void null_resample(void *audio_render, LVGSound *sound)
 {
+    audio_mixer_prepare((audio_mixer *)audio_render, sound->rate);
+}
+
+static void null_audio_mix(void *audio_render, void *stream, int frames)
+{
+    audio_mixer_mix((audio_mixer *)audio_render, stream, frames);
 }
 
 const audio_render null_audio_render =
@@ -29,5 +42,6 @@ const audio_render null_audio_render =
     null_audio_release,
     null_audio_play,
     null_audio_stop_all,
-    null_resample
+    null_resample,
+    null_audio_mix
 };
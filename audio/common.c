@@ -1,5 +1,17 @@
 #include <config.h>
 #include <lvg.h>
+#include <audio/audio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <limits.h>
+#if defined(__x86_64__) || defined(__SSE2__)
+#define AUDIO_X86 1
+#include <emmintrin.h>
+#endif
+#define MINIMP3_IMPLEMENTATION
+#include "mp3/minimp3.h"
 #if ENABLE_AUDIO && !defined(_TEST)
 #include <stddef.h>
 #include <stdlib.h>
@@ -7,8 +19,6 @@
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
-#define MINIMP3_IMPLEMENTATION
-#include "mp3/minimp3.h"
 
 short *lvgLoadMP3Buf(const unsigned char *buf, uint32_t buf_size, int *rate, int *channels, int *nsamples)
 {
@@ -55,16 +65,63 @@ short *lvgLoadMP3Buf(const unsigned char *buf, uint32_t buf_size, int *rate, int
 
 short *lvgLoadMP3(LVGEngine *e, const char *file_name, int *rate, int *channels, int *num_samples)
 {
-    unsigned char *buf;
+    const unsigned char *buf;
     uint32_t music_size;
-    if ((buf = (unsigned char *)lvgGetFileContents(e, file_name, &music_size)))
+    if ((buf = (const unsigned char *)lvgGetFileView(e, file_name, &music_size)))
     {
         short *ret = lvgLoadMP3Buf(buf, music_size, rate, channels, num_samples);
-        free(buf);
+        lvgReleaseFileView(e, (const char *)buf);
         return ret;
     }
     return 0;
 }
+#else
+short *lvgLoadMP3Buf(const unsigned char *buf, uint32_t buf_size, int *rate, int *channels, int *nsamples)
+{
+    *nsamples = 0;
+    return 0;
+}
+
+short *lvgLoadMP3(LVGEngine *e, const char *file_name, int *rate, int *channels, int *num_samples)
+{
+    *num_samples = 0;
+    return 0;
+}
+#endif
+
+int lvgLoadMP3Sound(LVGSound *sound, unsigned char *buf, uint32_t buf_size)
+{   // index frames without decoding, mixer decodes them while playing
+    int pos = 0, free_format_bytes = 0, max_frames = 0;
+    sound->mp3 = buf;
+    sound->mp3_size = buf_size;
+    sound->num_samples = sound->num_mp3_frames = 0;
+    for (;;)
+    {
+        int frame_bytes, i = mp3d_find_frame(buf + pos, buf_size - pos, &free_format_bytes, &frame_bytes);
+        if (!frame_bytes)
+            break;
+        pos += i;
+        const unsigned char *hdr = buf + pos;
+        if (!sound->num_mp3_frames)
+        {
+            sound->rate = hdr_sample_rate_hz(hdr);
+            sound->channels = HDR_IS_MONO(hdr) ? 1 : 2;
+            sound->mp3_frame_samples = hdr_frame_samples(hdr);
+        } else if (!hdr_compare(buf + sound->mp3_frames[0], hdr) || hdr_frame_samples(hdr) != sound->mp3_frame_samples)
+            break; // format change is not supported, play first part
+        if (sound->num_mp3_frames == max_frames)
+        {
+            max_frames = max_frames ? max_frames*2 : 256;
+            sound->mp3_frames = realloc(sound->mp3_frames, max_frames*sizeof(uint32_t));
+        }
+        sound->mp3_frames[sound->num_mp3_frames++] = pos;
+        pos += frame_bytes;
+    }
+    if (sound->num_mp3_frames)
+        sound->mp3_frames = realloc(sound->mp3_frames, sound->num_mp3_frames*sizeof(uint32_t));
+    sound->num_samples = sound->num_mp3_frames*sound->mp3_frame_samples;
+    return sound->num_samples;
+}
 
 void lvgPlaySound(LVGEngine *e, LVGSound *sound, int flags, int start_sample, int end_sample, int loops)
 {
@@ -75,24 +132,765 @@ void lvgStopAudio(LVGEngine *e)
 {
     e->audio_render->stop_all(e->audio_render_obj);
 }
-#else
-short *lvgLoadMP3Buf(const unsigned char *buf, uint32_t buf_size, int *rate, int *channels, int *nsamples)
+
+static void mix_add_c(float *acc, const short *src, int count, float gain)
 {
-    *nsamples = 0;
-    return 0;
+    for (int i = 0; i < count; i++)
+        acc[i] += src[i]*gain;
 }
 
-short *lvgLoadMP3(LVGEngine *e, const char *file_name, int *rate, int *channels, int *num_samples)
+static void mix_add_dup_c(float *acc, const short *src, int frames, float gain)
 {
-    *num_samples = 0;
-    return 0;
+    for (int i = 0; i < frames; i++)
+    {
+        float s = src[i]*gain;
+        acc[i*2] += s;
+        acc[i*2 + 1] += s;
+    }
 }
 
-void lvgPlaySound(LVGEngine *e, LVGSound *sound, int flags, int start_sample, int end_sample, int loops)
+static inline short audio_round_s16(float v);
+
+static void store_s16_c(short *dst, const float *acc, int count)
+{   // same rounding as cvtps_epi32
+    for (int i = 0; i < count; i++)
+        dst[i] = audio_round_s16(acc[i]);
+}
+
+static void store_f32_c(float *dst, const float *acc, int count)
 {
+    for (int i = 0; i < count; i++)
+        dst[i] = acc[i]*(1.0f/32768.0f);
 }
 
-void lvgStopAudio(LVGEngine *e)
+static inline short audio_round_s16(float v)
+{
+    int s = (int)lrintf(v);
+    return s < -32768 ? -32768 : (s > 32767 ? 32767 : s);
+}
+
+static void resample_c(short *dst, const short *src, int channels, int frames, const audio_filter *f, uint64_t pos, uint64_t step)
+{   // 4 partial sums per channel summed in same order as simd
+    for (int i = 0; i < frames; i++, pos += step)
+    {
+        const short *s = src + (size_t)(pos >> 32)*channels;
+        uint32_t frac = (uint32_t)pos;
+        const float *h = f->h[frac >> 24], *d = f->d[frac >> 24];
+        float t = (frac & 0xffffff)*(1.0f/16777216.0f);
+        for (int c = 0; c < channels; c++)
+        {
+            float a[4] = { 0 };
+            for (int k = 0; k < AUDIO_FILTER_TAPS; k += 4)
+                for (int j = 0; j < 4; j++)
+                    a[j] += s[(k + j)*channels + c]*(h[k + j] + t*d[k + j]);
+            *dst++ = audio_round_s16((a[0] + a[2]) + (a[1] + a[3]));
+        }
+    }
+}
+
+static const audio_mix_kernels audio_kernels_c = { "c", mix_add_c, mix_add_dup_c, store_s16_c, store_f32_c, resample_c };
+
+#if AUDIO_X86
+static inline __m128 mix_cvt_lo(__m128i s)
+{
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+}
+
+static inline __m128 mix_cvt_hi(__m128i s)
+{
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+}
+
+static void mix_add_sse2(float *acc, const short *src, int count, float gain)
+{
+    __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(mix_cvt_lo(s), g)));
+        _mm_storeu_ps(acc + i + 4, _mm_add_ps(_mm_loadu_ps(acc + i + 4), _mm_mul_ps(mix_cvt_hi(s), g)));
+    }
+    mix_add_c(acc + i, src + i, count - i, gain);
+}
+
+static void mix_add_dup_sse2(float *acc, const short *src, int frames, float gain)
+{
+    __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + 4 <= frames; i += 4)
+    {
+        __m128i s = _mm_loadl_epi64((const __m128i *)(src + i));
+        __m128 f = _mm_mul_ps(mix_cvt_lo(s), g);
+        float *a = acc + i*2;
+        _mm_storeu_ps(a, _mm_add_ps(_mm_loadu_ps(a), _mm_unpacklo_ps(f, f)));
+        _mm_storeu_ps(a + 4, _mm_add_ps(_mm_loadu_ps(a + 4), _mm_unpackhi_ps(f, f)));
+    }
+    mix_add_dup_c(acc + i*2, src + i, frames - i, gain);
+}
+
+static void store_s16_sse2(short *dst, const float *acc, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i lo = _mm_cvtps_epi32(_mm_loadu_ps(acc + i)), hi = _mm_cvtps_epi32(_mm_loadu_ps(acc + i + 4));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(lo, hi));
+    }
+    store_s16_c(dst + i, acc + i, count - i);
+}
+
+static void store_f32_sse2(float *dst, const float *acc, int count)
+{
+    __m128 scale = _mm_set1_ps(1.0f/32768.0f);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(acc + i), scale));
+    store_f32_c(dst + i, acc + i, count - i);
+}
+
+static inline float mix_hsum(__m128 a)
+{   // (a0 + a2) + (a1 + a3) like C
+    a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+    return _mm_cvtss_f32(_mm_add_ss(a, _mm_shuffle_ps(a, a, 1)));
+}
+
+static void resample_sse2(short *dst, const short *src, int channels, int frames, const audio_filter *f, uint64_t pos, uint64_t step)
+{
+    if (channels > 2)
+    {
+        resample_c(dst, src, channels, frames, f, pos, step);
+        return;
+    }
+    for (int i = 0; i < frames; i++, pos += step)
+    {
+        const short *s = src + (size_t)(pos >> 32)*channels;
+        uint32_t frac = (uint32_t)pos;
+        const float *h = f->h[frac >> 24], *d = f->d[frac >> 24];
+        __m128 t = _mm_set1_ps((frac & 0xffffff)*(1.0f/16777216.0f)), a = _mm_setzero_ps();
+        if (1 == channels)
+        {
+            for (int k = 0; k < AUDIO_FILTER_TAPS; k += 8)
+            {
+                __m128i x = _mm_loadu_si128((const __m128i *)(s + k));
+                __m128 c0 = _mm_add_ps(_mm_loadu_ps(h + k), _mm_mul_ps(t, _mm_loadu_ps(d + k)));
+                __m128 c1 = _mm_add_ps(_mm_loadu_ps(h + k + 4), _mm_mul_ps(t, _mm_loadu_ps(d + k + 4)));
+                a = _mm_add_ps(a, _mm_mul_ps(mix_cvt_lo(x), c0));
+                a = _mm_add_ps(a, _mm_mul_ps(mix_cvt_hi(x), c1));
+            }
+            *dst++ = audio_round_s16(mix_hsum(a));
+            continue;
+        }
+        __m128 b = _mm_setzero_ps();
+        for (int k = 0; k < AUDIO_FILTER_TAPS; k += 4)
+        {   // 4 frames: left in low half of each 32 bit lane, right in high
+            __m128i x = _mm_loadu_si128((const __m128i *)(s + k*2));
+            __m128 c = _mm_add_ps(_mm_loadu_ps(h + k), _mm_mul_ps(t, _mm_loadu_ps(d + k)));
+            a = _mm_add_ps(a, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(x, 16), 16)), c));
+            b = _mm_add_ps(b, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(x, 16)), c));
+        }
+        *dst++ = audio_round_s16(mix_hsum(a));
+        *dst++ = audio_round_s16(mix_hsum(b));
+    }
+}
+
+static const audio_mix_kernels audio_kernels_sse2 = { "sse2", mix_add_sse2, mix_add_dup_sse2, store_s16_sse2, store_f32_sse2, resample_sse2 };
+#endif
+
+static const audio_mix_kernels *audio_available_kernels(int n)
+{   // n-th kernel set supported by this cpu, scalar first
+    const audio_mix_kernels *k[2];
+    int num = 0;
+    k[num++] = &audio_kernels_c;
+#if AUDIO_X86
+    k[num++] = &audio_kernels_sse2;
+#endif
+    return n < num ? k[n] : 0;
+}
+
+const audio_mix_kernels *audio_select_kernels(void)
+{
+    const audio_mix_kernels *k = &audio_kernels_c, *next;
+    for (int i = 0; (next = audio_available_kernels(i)); i++)
+        k = next;
+    return k;
+}
+
+#define AUDIO_MP3_BUFFER  (AUDIO_MIX_WINDOW + 1152) // decoded frames
+#define AUDIO_MP3_RESERVE 1024 // bytes before seek target decoded to refill bit reservoir
+
+struct audio_mp3
+{   // decoded window [first, first + count) of channel sound, frames before sound start are zeros
+    mp3dec_t dec;
+    short pcm[AUDIO_MP3_BUFFER*2];
+    int first, count, next_frame, skip;
+};
+
+static void audio_mp3_decode(audio_mp3 *d, const LVGSound *s, short *pcm)
+{   // next frame, silence when it can not be decoded to keep positions of following frames
+    mp3dec_frame_info_t info;
+    uint32_t pos = s->mp3_frames[d->next_frame++];
+    int ch = s->channels;
+    if (mp3dec_decode_frame(&d->dec, s->mp3 + pos, s->mp3_size - pos, pcm, &info) != s->mp3_frame_samples || info.channels != ch)
+        memset(pcm, 0, s->mp3_frame_samples*ch*sizeof(short));
+}
+
+static void audio_mp3_seek(audio_mp3 *d, const LVGSound *s, int first)
+{   // restart decoder some frames before target, so reservoir and overlap are same as in sequential decode
+    int ch = s->channels, frame = first > 0 ? first/s->mp3_frame_samples : 0, f = frame;
+    short pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+    while (f > 0 && (frame - f < 2 || s->mp3_frames[frame] - s->mp3_frames[f] < AUDIO_MP3_RESERVE))
+        f--;
+    mp3dec_init(&d->dec);
+    for (d->next_frame = f; d->next_frame < frame;)
+        audio_mp3_decode(d, s, pcm);
+    d->first = first;
+    d->count = first < 0 ? (-first < AUDIO_MP3_BUFFER ? -first : AUDIO_MP3_BUFFER) : 0;
+    memset(d->pcm, 0, d->count*ch*sizeof(short));
+    d->skip  = first > 0 ? first - frame*s->mp3_frame_samples : 0;
+}
+
+static const short *audio_mp3_source(audio_mp3 *d, const LVGSound *s, int first, int span)
+{   // decode ahead as playback advances, seek through frame index on jumps
+    int ch = s->channels, fs = s->mp3_frame_samples;
+    if (first < d->first || first > d->first + d->count)
+        audio_mp3_seek(d, s, first);
+    else if (first > d->first)
+    {
+        d->count -= first - d->first;
+        memmove(d->pcm, d->pcm + (first - d->first)*ch, d->count*ch*sizeof(short));
+        d->first = first;
+    }
+    while (d->count < span)
+    {
+        short *dst = d->pcm + d->count*ch;
+        if (d->next_frame >= s->num_mp3_frames)
+        {   // after sound end
+            memset(dst, 0, (span - d->count)*ch*sizeof(short));
+            d->count = span;
+            break;
+        }
+        if (d->skip)
+        {
+            short pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+            audio_mp3_decode(d, s, pcm);
+            memcpy(dst, pcm + d->skip*ch, (fs - d->skip)*ch*sizeof(short));
+            d->count += fs - d->skip;
+            d->skip = 0;
+            continue;
+        }
+        audio_mp3_decode(d, s, dst);
+        d->count += fs;
+    }
+    return d->pcm;
+}
+
+void audio_mixer_init(audio_mixer *m, int rate, int channels, int format)
+{
+    memset(m, 0, sizeof(*m));
+    m->rate     = rate;
+    m->out_channels = channels;
+    m->format   = format;
+    m->k   = audio_select_kernels();
+    m->acc = malloc(AUDIO_MIX_BLOCK*channels*sizeof(float));
+    m->tmp = malloc(AUDIO_MIX_BLOCK*2*sizeof(short));
+    m->win = malloc(AUDIO_MIX_WINDOW*2*sizeof(short));
+    m->mp3 = malloc(AUDIO_NUM_CHANNELS*sizeof(audio_mp3));
+}
+
+void audio_mixer_release(audio_mixer *m)
+{
+    free(m->acc);
+    free(m->tmp);
+    free(m->win);
+    free(m->mp3);
+    for (int i = 0; i < m->num_filters; i++)
+        free(m->filters[i]);
+    m->acc = 0;
+    m->tmp = m->win = 0;
+    m->mp3 = 0;
+    m->num_filters = 0;
+}
+
+static double audio_bessel_i0(double x)
+{
+    double sum = 1, term = 1;
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x/(2*k))*(x/(2*k));
+        sum += term;
+    }
+    return sum;
+}
+
+const audio_filter *audio_mixer_prepare(audio_mixer *m, int rate)
+{   // game thread only: kaiser windowed sinc, cutoff below lower of two nyquist rates
+    int i, k, p;
+    if (rate == m->rate || rate <= 0)
+        return 0;
+    for (i = 0; i < m->num_filters; i++)
+        if (m->filters[i]->rate == rate)
+            return m->filters[i];
+    if (AUDIO_MAX_FILTERS == m->num_filters)
+        return 0;
+    audio_filter *f = malloc(sizeof(audio_filter));
+    const double beta = 8.0, fc = 0.46*(rate > m->rate ? (double)m->rate/rate : 1.0);
+    float prev[AUDIO_FILTER_TAPS];
+    for (p = 0; p <= AUDIO_FILTER_PHASES; p++)
+    {
+        double row[AUDIO_FILTER_TAPS], sum = 0;
+        for (k = 0; k < AUDIO_FILTER_TAPS; k++)
+        {
+            double x = k - (AUDIO_FILTER_TAPS/2 - 1) - (double)p/AUDIO_FILTER_PHASES, u = x/(AUDIO_FILTER_TAPS/2);
+            double w = fabs(u) < 1 ? audio_bessel_i0(beta*sqrt(1 - u*u))/audio_bessel_i0(beta) : 0;
+            double y = 2*M_PI*fc*x;
+            row[k] = (fabs(y) < 1e-9 ? 1.0 : sin(y)/y)*w;
+            sum += row[k];
+        }
+        for (k = 0; k < AUDIO_FILTER_TAPS; k++)
+        {   // unity gain at dc for every phase
+            float v = row[k]/sum;
+            if (p)
+                f->d[p - 1][k] = v - prev[k];
+            if (p < AUDIO_FILTER_PHASES)
+                f->h[p][k] = v;
+            prev[k] = v;
+        }
+    }
+    f->rate = rate;
+    m->filters[m->num_filters++] = f;
+    return f;
+}
+
+static void audio_mixer_push(audio_mixer *m, const audio_mix_cmd *cmd)
+{   // wait-free: when audio thread does not keep up command is dropped
+    uint32_t head = __atomic_load_n(&m->head, __ATOMIC_RELAXED);
+    if (head - __atomic_load_n(&m->tail, __ATOMIC_ACQUIRE) >= AUDIO_MIX_QUEUE)
+    {
+        __atomic_add_fetch(&m->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    m->queue[head % AUDIO_MIX_QUEUE] = *cmd;
+    __atomic_store_n(&m->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void audio_mixer_play(audio_mixer *m, LVGSound *sound, int flags, int start_sample, int end_sample, int loops, float gain)
+{
+    if (!sound->num_samples)
+        return;
+    audio_mix_cmd cmd = { sound, audio_mixer_prepare(m, sound->rate), gain, flags, start_sample, end_sample, loops };
+    audio_mixer_push(m, &cmd);
+}
+
+void audio_mixer_stop_all(audio_mixer *m)
+{
+    audio_mix_cmd cmd = { 0, 0, 0.0f, PLAY_SyncStop, 0, 0, 0 };
+    audio_mixer_push(m, &cmd);
+}
+
+static void audio_mixer_exec(audio_mixer *m, const audio_mix_cmd *cmd)
+{
+    LVGSound *sound = cmd->sound;
+    int i;
+    if (cmd->flags & PLAY_SyncStop)
+    {
+        for (i = 0; i < AUDIO_NUM_CHANNELS; i++)
+            if (!sound || m->channels[i].sound == sound)
+                m->channels[i].sound = 0;
+        return;
+    }
+    if (cmd->flags & PLAY_SyncNoMultiple)
+    {
+        for (i = 0; i < AUDIO_NUM_CHANNELS; i++)
+            if (m->channels[i].sound == sound)
+                return;
+    }
+    for (i = 0; i < AUDIO_NUM_CHANNELS; i++)
+        if (!m->channels[i].sound)
+            break;
+    if (AUDIO_NUM_CHANNELS == i)
+        return;
+    audio_mix_channel *c = &m->channels[i];
+    int orig_rate = sound->orig_rate ? sound->orig_rate : sound->rate;
+    int64_t start = (int64_t)cmd->start_sample*sound->rate/orig_rate, end = (int64_t)cmd->end_sample*sound->rate/orig_rate;
+    start = start > sound->num_samples ? sound->num_samples : start;
+    end   = end > sound->num_samples ? sound->num_samples : end;
+    if (start >= end || (sound->rate != m->rate && !cmd->filter))
+        return;
+    c->start = c->pos = start;
+    c->end   = end;
+    c->frac  = 0;
+    c->step  = ((uint64_t)sound->rate << 32)/m->rate;
+    c->filter = cmd->filter;
+    c->gain  = cmd->gain;
+    c->flags = cmd->flags;
+    c->loops = cmd->loops;
+    c->sound = sound;
+    m->mp3[i].first = INT_MIN/2; // seek on first fetch
+    m->mp3[i].count = 0;
+}
+
+static const short *audio_mixer_source(audio_mixer *m, audio_mix_channel *c, int first, int span)
+{   // span contiguous source frames, zeros outside of sound
+    const LVGSound *sound = c->sound;
+    int i, ch = sound->channels;
+    if (sound->mp3)
+        return audio_mp3_source(m->mp3 + (c - m->channels), sound, first, span);
+    if (first >= 0 && first + span <= sound->num_samples)
+        return sound->samples + (size_t)first*ch;
+    for (i = 0; i < span; i++)
+    {
+        int j = first + i, in = j >= 0 && j < sound->num_samples;
+        m->win[i*ch] = in ? sound->samples[(size_t)j*ch] : 0;
+        if (2 == ch)
+            m->win[i*ch + 1] = in ? sound->samples[(size_t)j*ch + 1] : 0;
+    }
+    return m->win;
+}
+
+static const short *audio_mixer_fetch(audio_mixer *m, audio_mix_channel *c, int *frames)
+{   // up to *frames output frames at output rate
+    if (1ull << 32 == c->step)
+    {
+        int n = *frames < c->end - c->pos ? *frames : c->end - c->pos;
+        const short *src = audio_mixer_source(m, c, c->pos, n);
+        c->pos += n;
+        *frames = n;
+        return src;
+    }
+    uint64_t left = ((uint64_t)(c->end - c->pos) << 32) - c->frac;
+    int n = (int)((left + c->step - 1)/c->step);
+    n = n < *frames ? n : *frames;
+    int span = (int)((c->frac + (uint64_t)(n - 1)*c->step) >> 32) + AUDIO_FILTER_TAPS;
+    if (span > AUDIO_MIX_WINDOW)
+    {   // high ratio
+        n = (int)(((((uint64_t)(AUDIO_MIX_WINDOW - AUDIO_FILTER_TAPS + 1)) << 32) - 1 - c->frac)/c->step) + 1;
+        span = (int)((c->frac + (uint64_t)(n - 1)*c->step) >> 32) + AUDIO_FILTER_TAPS;
+    }
+    const short *src = audio_mixer_source(m, c, c->pos - (AUDIO_FILTER_TAPS/2 - 1), span);
+    m->k->resample(m->tmp, src, c->sound->channels, n, c->filter, c->frac, c->step);
+    uint64_t pos = c->frac + (uint64_t)n*c->step;
+    c->pos += (int)(pos >> 32);
+    c->frac = (uint32_t)pos;
+    *frames = n;
+    return m->tmp;
+}
+
+static void audio_mixer_channel(audio_mixer *m, audio_mix_channel *c, float *acc, int frames)
+{
+    while (frames)
+    {
+        int n = frames, sch = c->sound->channels;
+        const short *src = audio_mixer_fetch(m, c, &n);
+        if (sch == m->out_channels)
+            m->k->mix_add(acc, src, n*sch, c->gain);
+        else if (1 == sch && 2 == m->out_channels)
+            m->k->mix_add_dup(acc, src, n, c->gain);
+        else
+            for (int i = 0; i < n; i++)
+            {   // downmix to mono
+                float s = 0;
+                for (int j = 0; j < sch; j++)
+                    s += src[i*sch + j];
+                for (int j = 0; j < m->out_channels; j++)
+                    acc[i*m->out_channels + j] += s*c->gain/sch;
+            }
+        acc += n*m->out_channels;
+        frames -= n;
+        if (c->pos < c->end)
+            continue;
+        if (c->flags & PLAY_HasLoops)
+        {
+            if (32767 != c->loops && c->loops)
+                c->loops--;
+            if (c->loops)
+            {
+                c->pos  = c->start;
+                c->frac = 0;
+                continue;
+            }
+        }
+        c->sound = 0;
+        break;
+    }
+}
+
+void audio_mixer_mix(audio_mixer *m, void *stream, int frames)
+{
+    uint32_t tail = m->tail, head = __atomic_load_n(&m->head, __ATOMIC_ACQUIRE);
+    for (; tail != head; tail++)
+        audio_mixer_exec(m, m->queue + tail % AUDIO_MIX_QUEUE);
+    __atomic_store_n(&m->tail, tail, __ATOMIC_RELEASE);
+    while (frames)
+    {
+        int n = frames < AUDIO_MIX_BLOCK ? frames : AUDIO_MIX_BLOCK, count = n*m->out_channels;
+        memset(m->acc, 0, count*sizeof(float));
+        for (int i = 0; i < AUDIO_NUM_CHANNELS; i++)
+            if (m->channels[i].sound)
+                audio_mixer_channel(m, &m->channels[i], m->acc, n);
+        if (AUDIO_FORMAT_FLOAT == m->format)
+        {
+            m->k->store_f32((float *)stream, m->acc, count);
+            stream = (float *)stream + count;
+        } else
+        {
+            m->k->store_s16((short *)stream, m->acc, count);
+            stream = (short *)stream + count;
+        }
+        frames -= n;
+    }
+}
+
+#ifdef _TEST
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define BENCH_RATE    44100
+#define BENCH_SECONDS 10
+#define BENCH_COMMANDS 200000
+
+static uint32_t bench_rand(uint32_t *seed)
+{
+    *seed = *seed*1664525 + 1013904223;
+    return *seed >> 8;
+}
+
+static double bench_now(void)
 {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static void bench_sounds(LVGSound *sounds, int num, int resampled)
+{   // mono and stereo noise, some or all at other rates
+    static const int rates[8] = { BENCH_RATE, BENCH_RATE, BENCH_RATE, BENCH_RATE, BENCH_RATE, 48000, BENCH_RATE, BENCH_RATE/2 };
+    uint32_t seed = 4321;
+    for (int i = 0; i < num; i++)
+    {
+        LVGSound *s = sounds + i;
+        memset(s, 0, sizeof(*s));
+        s->channels = 1 + (i & 1);
+        s->rate = resampled ? ((i & 2) ? 48000 : BENCH_RATE/2) : rates[i % 8];
+        s->num_samples = s->rate + i*37;
+        s->samples = malloc(s->num_samples*s->channels*sizeof(short));
+        for (int j = 0; j < s->num_samples*s->channels; j++)
+            s->samples[j] = (short)bench_rand(&seed);
+    }
+}
+
+static double bench_mix(const audio_mix_kernels *k, LVGSound *sounds, int num, int format, short *out)
+{
+    audio_mixer m;
+    audio_mixer_init(&m, BENCH_RATE, 2, format);
+    m.k = k;
+    for (int i = 0; i < num; i++)
+        audio_mixer_play(&m, sounds + i, PLAY_HasLoops, 0, sounds[i].num_samples, 32767, 0.25f + (i % 4)*0.25f);
+    float *f = malloc(AUDIO_MIX_BLOCK*2*sizeof(float));
+    double t = bench_now();
+    for (int pos = 0, i = 0; pos < BENCH_RATE*BENCH_SECONDS; i++)
+    {   // callback sizes vary to hit all tails
+        int n = 1000 + (i*37) % 24;
+        n = n < BENCH_RATE*BENCH_SECONDS - pos ? n : BENCH_RATE*BENCH_SECONDS - pos;
+        audio_mixer_mix(&m, out ? (void *)(out + pos*2) : (void *)f, n);
+        pos += n;
+    }
+    t = bench_now() - t;
+    free(f);
+    audio_mixer_release(&m);
+    return t;
+}
+
+static double bench_thdn(const audio_mix_kernels *k, int rate, double freq)
+{   // sine through resampler: residual after fitted sine relative to sine, middle second
+    LVGSound s = { .num_samples = rate*2, .rate = rate, .channels = 1 };
+    audio_mixer m;
+    int i, n = BENCH_RATE, first = BENCH_RATE/2;
+    s.samples = malloc(s.num_samples*sizeof(short));
+    for (i = 0; i < s.num_samples; i++)
+        s.samples[i] = (short)lrint(16384*sin(2*M_PI*freq*i/rate));
+    float *out = malloc(BENCH_RATE*2*sizeof(float));
+    audio_mixer_init(&m, BENCH_RATE, 1, AUDIO_FORMAT_FLOAT);
+    m.k = k;
+    audio_mixer_play(&m, &s, 0, 0, s.num_samples, 0, 1.0f);
+    audio_mixer_mix(&m, out, BENCH_RATE*2);
+    double a[3][3] = { { 0 } }, b[3] = { 0 }, x[3];
+    for (i = first; i < first + n; i++)
+    {   // least squares fit of sin, cos and dc
+        double w = 2*M_PI*freq*i/BENCH_RATE, v[3] = { sin(w), cos(w), 1 };
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 3; c++)
+                a[r][c] += v[r]*v[c];
+            b[r] += v[r]*out[i];
+        }
+    }
+    double det = a[0][0]*(a[1][1]*a[2][2] - a[1][2]*a[2][1]) - a[0][1]*(a[1][0]*a[2][2] - a[1][2]*a[2][0]) + a[0][2]*(a[1][0]*a[2][1] - a[1][1]*a[2][0]);
+    for (int c = 0; c < 3; c++)
+    {   // cramer's rule
+        double t[3][3];
+        memcpy(t, a, sizeof(t));
+        for (int r = 0; r < 3; r++)
+            t[r][c] = b[r];
+        x[c] = (t[0][0]*(t[1][1]*t[2][2] - t[1][2]*t[2][1]) - t[0][1]*(t[1][0]*t[2][2] - t[1][2]*t[2][0]) + t[0][2]*(t[1][0]*t[2][1] - t[1][1]*t[2][0]))/det;
+    }
+    double sig = 0, noise = 0;
+    for (i = first; i < first + n; i++)
+    {
+        double w = 2*M_PI*freq*i/BENCH_RATE, fit = x[0]*sin(w) + x[1]*cos(w);
+        sig += fit*fit;
+        noise += (out[i] - fit - x[2])*(out[i] - fit - x[2]);
+    }
+    audio_mixer_release(&m);
+    free(out);
+    free(s.samples);
+    return 10*log10(noise/sig);
+}
+
+static int bench_compare_mp3(LVGSound *mp3, LVGSound *pcm, int rate)
+{   // lazy decode with seeks from in point and loops against decoded copy
+    audio_mixer a, b;
+    int n = (int)((int64_t)mp3->num_samples*3*rate/mp3->rate) + rate/10, ret;
+    short *oa = malloc(n*2*sizeof(short)), *ob = malloc(n*2*sizeof(short));
+    audio_mixer_init(&a, rate, 2, 0);
+    audio_mixer_init(&b, rate, 2, 0);
+    audio_mixer_play(&a, mp3, PLAY_HasInPoint | PLAY_HasLoops, mp3->num_samples/3, mp3->num_samples, 3, 1.0f);
+    audio_mixer_play(&b, pcm, PLAY_HasInPoint | PLAY_HasLoops, mp3->num_samples/3, mp3->num_samples, 3, 1.0f);
+    audio_mixer_play(&a, mp3, 0, 0, mp3->num_samples, 0, 0.5f);
+    audio_mixer_play(&b, pcm, 0, 0, mp3->num_samples, 0, 0.5f);
+    for (int pos = 0, i = 0; pos < n; i++)
+    {
+        int len = 700 + (i*53) % 400;
+        len = len < n - pos ? len : n - pos;
+        audio_mixer_mix(&a, oa + pos*2, len);
+        audio_mixer_mix(&b, ob + pos*2, len);
+        pos += len;
+    }
+    ret = memcmp(oa, ob, n*2*sizeof(short));
+    audio_mixer_release(&a);
+    audio_mixer_release(&b);
+    free(oa);
+    free(ob);
+    return ret;
+}
+
+void audio_bench_mp3(LVGSound *sounds, int num_sounds)
+{
+    int num = 0, mismatch = 0;
+    double mp3_bytes = 0, index_bytes = 0, pcm_bytes = 0, seconds = 0, t = 0;
+    for (int i = 0; i < num_sounds; i++)
+    {
+        LVGSound *s = sounds + i, pcm = *s;
+        if (!s->mp3 || !s->num_samples)
+            continue;
+        audio_mp3 *d = malloc(sizeof(audio_mp3));
+        pcm.mp3 = 0;
+        pcm.samples = malloc(s->num_samples*s->channels*sizeof(short));
+        double t0 = bench_now();
+        mp3dec_init(&d->dec);
+        for (d->next_frame = 0; d->next_frame < s->num_mp3_frames;)
+            audio_mp3_decode(d, s, pcm.samples + (size_t)d->next_frame*s->mp3_frame_samples*s->channels);
+        t += bench_now() - t0;
+        mismatch |= bench_compare_mp3(s, &pcm, s->rate) | bench_compare_mp3(s, &pcm, 48000);
+        mp3_bytes   += s->mp3_size;
+        index_bytes += s->num_mp3_frames*sizeof(uint32_t);
+        pcm_bytes   += s->num_samples*s->channels*sizeof(short);
+        seconds     += (double)s->num_samples/s->rate;
+        num++;
+        free(pcm.samples);
+        free(d);
+    }
+    if (num)
+        printf("bench: audio mp3: sounds %d, compressed %.0fKB, index %.1fKB, decoded %.0fKB, decode %.1fx realtime%s\n", num,
+            mp3_bytes/1024, index_bytes/1024, pcm_bytes/1024, seconds/t, mismatch ? ", MISMATCH" : "");
+}
+
+typedef struct bench_queue
+{
+    audio_mixer m;
+    LVGSound *sounds;
+    volatile int done;
+} bench_queue;
+
+static void *bench_queue_producer(void *arg)
+{
+    bench_queue *q = (bench_queue *)arg;
+    for (int i = 0; i < BENCH_COMMANDS; i++)
+    {
+        while (i - __atomic_load_n(&q->m.tail, __ATOMIC_ACQUIRE) >= AUDIO_MIX_QUEUE/2)
+            sched_yield(); // pace like game frames, a full queue would drop
+        if (i % 64 == 63)
+            audio_mixer_stop_all(&q->m);
+        else
+            audio_mixer_play(&q->m, q->sounds + i % AUDIO_NUM_CHANNELS, (i & 1) ? PLAY_SyncNoMultiple : PLAY_SyncStop, 0, 1000, 0, 1.0f);
+    }
+    __atomic_store_n(&q->done, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void audio_bench_mixer(void)
+{
+    LVGSound sounds[AUDIO_NUM_CHANNELS];
+    const audio_mix_kernels *k;
+    int count = BENCH_RATE*BENCH_SECONDS*2;
+    short *ref = malloc(count*sizeof(short)), *out = malloc(count*sizeof(short));
+    LVGSound rs[AUDIO_NUM_CHANNELS];
+    short *rref = malloc(count*sizeof(short));
+    bench_sounds(sounds, AUDIO_NUM_CHANNELS, 0);
+    bench_sounds(rs, AUDIO_NUM_CHANNELS, 1);
+    bench_mix(&audio_kernels_c, sounds, AUDIO_NUM_CHANNELS, 0, ref);
+    bench_mix(&audio_kernels_c, rs, AUDIO_NUM_CHANNELS, 0, rref);
+    for (int n = 0; (k = audio_available_kernels(n)); n++)
+    {
+        double t = bench_mix(k, sounds, AUDIO_NUM_CHANNELS, 0, out);
+        int mismatch = memcmp(ref, out, count*sizeof(short));
+        double tf = bench_mix(k, sounds, AUDIO_NUM_CHANNELS, AUDIO_FORMAT_FLOAT, 0);
+        double tr = bench_mix(k, rs, AUDIO_NUM_CHANNELS, 0, out);
+        mismatch |= memcmp(rref, out, count*sizeof(short));
+        printf("bench: audio mix %s: channels %d, s16 %.1fx realtime, float %.1fx realtime, resampled %.1fx realtime%s\n", k->name,
+            AUDIO_NUM_CHANNELS, BENCH_SECONDS/t, BENCH_SECONDS/tf, BENCH_SECONDS/tr, mismatch ? ", MISMATCH" : "");
+    }
+    {   // quality limit is set by 16 bit samples around -98dB
+        static const int rates[] = { 22050, 22050, 11025, 5512, 48000 };
+        static const double freqs[] = { 1000, 9000, 4000, 2000, 15000 };
+        double worst = -200;
+        printf("bench: audio resample: thd+n");
+        for (int i = 0; i < 5; i++)
+        {
+            double db = bench_thdn(audio_select_kernels(), rates[i], freqs[i]);
+            worst = db > worst ? db : worst;
+            printf("%s %d %.0fHz %.1fdB", i ? "," : "", rates[i], freqs[i], db);
+        }
+        printf("%s\n", worst > -80 ? ", MISMATCH" : "");
+    }
+    bench_queue *q = calloc(1, sizeof(bench_queue));
+    audio_mixer_init(&q->m, BENCH_RATE, 2, 0);
+    q->sounds = sounds;
+    short buf[256*2];
+    int calls = 0;
+    pthread_t th;
+    pthread_create(&th, 0, bench_queue_producer, q);
+    while (!__atomic_load_n(&q->done, __ATOMIC_ACQUIRE))
+    {
+        audio_mixer_mix(&q->m, buf, 256);
+        calls++;
+        sched_yield();
+    }
+    pthread_join(th, 0);
+    audio_mixer_mix(&q->m, buf, 256);
+    int dropped = __atomic_load_n(&q->m.dropped, __ATOMIC_RELAXED);
+    printf("bench: audio queue: commands %d, dropped %d, mix calls %d%s\n", BENCH_COMMANDS, dropped, calls,
+        q->m.tail + dropped != BENCH_COMMANDS ? ", MISMATCH" : "");
+    audio_mixer_release(&q->m);
+    free(q);
+    for (int i = 0; i < AUDIO_NUM_CHANNELS; i++)
+    {
+        free(sounds[i].samples);
+        free(rs[i].samples);
+    }
+    free(rref);
+    free(ref);
+    free(out);
 }
 #endif
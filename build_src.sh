@@ -1,5 +1,5 @@
 
-SRC="nanovg/nanovg.c src/lvg.c src/lunzip.c \
+SRC="nanovg/nanovg.c src/lvg.c src/lunzip.c src/jobs.c src/profile.c \
 audio/*.c \
 render/*.c \
 render/jfes/*.c \
@@ -3,6 +3,7 @@
 #define VERSION_STR "0.0.5"
 #define RENDER_NVPR 1
 #define RENDER_NANOVG 1
+#define RENDER_SW 1
 #define AUDIO_SDL 1
 #define VIDEO_FFMPEG 1
 #define SCRIPT_TCC 0
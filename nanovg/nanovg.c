@@ -1345,7 +1345,8 @@ void nvg__tesselateBezierAFD(NVGcontext* ctx, float x1, float y1, float x2, floa
   int t = 0;
   int dt = ONE;
   
-  float tol = ctx->tessTol * 4.0;
+  // d is squared length, so tolerance is squared too to tessellate same at any scale
+  float tol = ctx->tessTol * ctx->tessTol * 16.0f;
   
   while(t < ONE) {
     
@@ -2374,6 +2375,206 @@ void nvgStroke(NVGcontext* ctx)
 	}
 }
 
+struct NVGretained {
+	NVGpath* paths;
+	int npaths;
+	NVGvertex* verts;
+	int nverts;
+	float bounds[4];
+	float strokeWidth;
+};
+
+static void nvg__scaleTolerances(NVGcontext* ctx, float scale)
+{
+	ctx->tessTol /= scale;
+	ctx->distTol /= scale;
+	ctx->fringeWidth /= scale;
+}
+
+static NVGretained* nvg__retainCache(NVGcontext* ctx)
+{
+	NVGpathCache* cache = ctx->cache;
+	NVGretained* r;
+	int i, nverts = 0;
+
+	for (i = 0; i < cache->npaths; i++)
+		nverts += cache->paths[i].nfill + cache->paths[i].nstroke;
+	r = (NVGretained*)malloc(sizeof(NVGretained) + sizeof(NVGpath)*cache->npaths + sizeof(NVGvertex)*nverts);
+	if (r == NULL) return NULL;
+	r->paths = (NVGpath*)(r + 1);
+	r->npaths = cache->npaths;
+	r->verts = (NVGvertex*)(r->paths + cache->npaths);
+	r->nverts = nverts;
+	memcpy(r->bounds, cache->bounds, sizeof(r->bounds));
+	r->strokeWidth = 0;
+
+	// Expanded vertices are contiguous, keep offsets of each path.
+	memcpy(r->verts, cache->verts, sizeof(NVGvertex)*nverts);
+	memcpy(r->paths, cache->paths, sizeof(NVGpath)*cache->npaths);
+	for (i = 0; i < r->npaths; i++) {
+		NVGpath* path = &r->paths[i];
+		path->fill = path->nfill ? r->verts + (path->fill - cache->verts) : NULL;
+		path->stroke = path->nstroke ? r->verts + (path->stroke - cache->verts) : NULL;
+	}
+	return r;
+}
+
+NVGretained* nvgRetainFill(NVGcontext* ctx, float scale)
+{
+	NVGretained* r;
+
+	nvg__clearPathCache(ctx);
+	nvg__scaleTolerances(ctx, scale);
+	nvg__flattenPaths(ctx);
+	if (ctx->params.edgeAntiAlias)
+		nvg__expandFill(ctx, ctx->fringeWidth, NVG_MITER, 2.4f);
+	else
+		nvg__expandFill(ctx, 0.0f, NVG_MITER, 2.4f);
+	r = nvg__retainCache(ctx);
+	nvg__scaleTolerances(ctx, 1.0f/scale);
+	nvg__clearPathCache(ctx);
+	return r;
+}
+
+NVGretained* nvgRetainStroke(NVGcontext* ctx, float scale)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float strokeWidth = nvg__clampf(state->strokeWidth * scale, 0.0f, 200.0f);
+	NVGretained* r;
+
+	// Thin strokes are widened to pixel size and faded when drawn.
+	if (strokeWidth < ctx->fringeWidth)
+		strokeWidth = ctx->fringeWidth;
+
+	nvg__clearPathCache(ctx);
+	nvg__scaleTolerances(ctx, scale);
+	strokeWidth /= scale;
+	nvg__flattenPaths(ctx);
+	if (ctx->params.edgeAntiAlias)
+		nvg__expandStroke(ctx, strokeWidth*0.5f + ctx->fringeWidth*0.5f, state->lineCap, state->lineJoin, state->miterLimit);
+	else
+		nvg__expandStroke(ctx, strokeWidth*0.5f, state->lineCap, state->lineJoin, state->miterLimit);
+	r = nvg__retainCache(ctx);
+	if (r != NULL)
+		r->strokeWidth = state->strokeWidth;
+	nvg__scaleTolerances(ctx, 1.0f/scale);
+	nvg__clearPathCache(ctx);
+	return r;
+}
+
+// Transforms retained vertices to path cache, returns paths to render.
+static NVGpath* nvg__replayRetained(NVGcontext* ctx, const NVGretained* r, float* bounds)
+{
+	NVGpathCache* cache = ctx->cache;
+	float* t = nvg__getState(ctx)->xform;
+	NVGvertex* verts;
+	int i;
+
+	nvg__clearPathCache(ctx);
+	if (r->npaths > cache->cpaths) {
+		NVGpath* paths;
+		int cpaths = r->npaths + cache->cpaths/2;
+		paths = (NVGpath*)realloc(cache->paths, sizeof(NVGpath)*cpaths);
+		if (paths == NULL) return NULL;
+		cache->paths = paths;
+		cache->cpaths = cpaths;
+	}
+	verts = nvg__allocTempVerts(ctx, r->nverts);
+	if (verts == NULL) return NULL;
+
+	for (i = 0; i < r->nverts; i++) {
+		const NVGvertex* v = &r->verts[i];
+		verts[i].x = v->x*t[0] + v->y*t[2] + t[4];
+		verts[i].y = v->x*t[1] + v->y*t[3] + t[5];
+		verts[i].u = v->u;
+		verts[i].v = v->v;
+	}
+	for (i = 0; i < r->npaths; i++) {
+		NVGpath* path = &cache->paths[i];
+		*path = r->paths[i];
+		if (path->fill != NULL) path->fill = verts + (path->fill - r->verts);
+		if (path->stroke != NULL) path->stroke = verts + (path->stroke - r->verts);
+	}
+
+	bounds[0] = bounds[1] = 1e6f;
+	bounds[2] = bounds[3] = -1e6f;
+	for (i = 0; i < 4; i++) {
+		float x = r->bounds[(i & 1) ? 2 : 0], y = r->bounds[(i & 2) ? 3 : 1], tx, ty;
+		nvgTransformPoint(&tx, &ty, t, x, y);
+		bounds[0] = nvg__minf(bounds[0], tx);
+		bounds[1] = nvg__minf(bounds[1], ty);
+		bounds[2] = nvg__maxf(bounds[2], tx);
+		bounds[3] = nvg__maxf(bounds[3], ty);
+	}
+	return cache->paths;
+}
+
+void nvgFillRetained(NVGcontext* ctx, const NVGretained* r)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGpaint fillPaint = state->fill;
+	const NVGpath* paths;
+	float bounds[4];
+	int i;
+
+	if ((paths = nvg__replayRetained(ctx, r, bounds)) == NULL)
+		return;
+
+	// Apply global alpha
+	fillPaint.innerColor.a *= state->alpha;
+	fillPaint.outerColor.a *= state->alpha;
+
+	ctx->params.renderFill(ctx->params.userPtr, &fillPaint, &state->scissor, ctx->fringeWidth,
+						   bounds, paths, r->npaths);
+
+	// Count triangles
+	for (i = 0; i < r->npaths; i++) {
+		ctx->fillTriCount += paths[i].nfill-2;
+		ctx->fillTriCount += paths[i].nstroke-2;
+		ctx->drawCallCount += 2;
+	}
+}
+
+void nvgStrokeRetained(NVGcontext* ctx, const NVGretained* r)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float scale = nvg__getAverageScale(state->xform);
+	float strokeWidth = nvg__clampf(r->strokeWidth * scale, 0.0f, 200.0f);
+	NVGpaint strokePaint = state->stroke;
+	const NVGpath* paths;
+	float bounds[4];
+	int i;
+
+	if (strokeWidth < ctx->fringeWidth) {
+		// Same coverage emulation as nvgStroke().
+		float alpha = nvg__clampf(strokeWidth / ctx->fringeWidth, 0.0f, 1.0f);
+		strokePaint.innerColor.a *= alpha*alpha;
+		strokePaint.outerColor.a *= alpha*alpha;
+		strokeWidth = ctx->fringeWidth;
+	}
+
+	// Apply global alpha
+	strokePaint.innerColor.a *= state->alpha;
+	strokePaint.outerColor.a *= state->alpha;
+
+	if ((paths = nvg__replayRetained(ctx, r, bounds)) == NULL)
+		return;
+
+	ctx->params.renderStroke(ctx->params.userPtr, &strokePaint, &state->scissor, ctx->fringeWidth,
+							 strokeWidth, paths, r->npaths);
+
+	// Count triangles
+	for (i = 0; i < r->npaths; i++) {
+		ctx->strokeTriCount += paths[i].nstroke-2;
+		ctx->drawCallCount++;
+	}
+}
+
+void nvgDeleteRetained(NVGretained* r)
+{
+	free(r);
+}
+
 // Add fonts
 int nvgCreateFont(NVGcontext* ctx, const char* name, const char* path)
 {
@@ -511,6 +511,32 @@ void nvgFill(NVGcontext* ctx);
 // Fills the current path with current stroke style.
 void nvgStroke(NVGcontext* ctx);
 
+//
+// Retained paths
+//
+// Tessellating a path costs much more than drawing it. Static paths can be tessellated once with
+// nvgRetainFill() or nvgRetainStroke() and drawn many times with nvgFillRetained() and
+// nvgStrokeRetained(), which only apply current transform and style to stored vertices.
+// The path must be defined with identity transform. Tessellation is made for given scale of
+// later transforms, drawing at much bigger scale shows segments, so retain again when zoom changes.
+// Drawing retained paths discards tessellation of the current path.
+
+typedef struct NVGretained NVGretained;
+
+// Tessellates fill of the current path for transforms with given average scale.
+NVGretained* nvgRetainFill(NVGcontext* ctx, float scale);
+
+// Tessellates stroke of the current path with current stroke width, joins and caps.
+NVGretained* nvgRetainStroke(NVGcontext* ctx, float scale);
+
+// Fills retained path with current transform and fill style.
+void nvgFillRetained(NVGcontext* ctx, const NVGretained* path);
+
+// Strokes retained path with current transform and stroke paint.
+void nvgStrokeRetained(NVGcontext* ctx, const NVGretained* path);
+
+void nvgDeleteRetained(NVGretained* path);
+
 
 //
 // Text
@@ -32,6 +32,9 @@ enum NVGcreateFlags {
 	NVG_STENCIL_STROKES	= 1<<1,
 	// Flag indicating that additional debug checks are done.
 	NVG_DEBUG 			= 1<<2,
+	// Flag indicating that consecutive solid color convex fills and strokes are merged into one draw call,
+	// with color per vertex instead of per call uniforms.
+	NVG_BATCH			= 1<<3,
 };
 
 #if defined NANOVG_GL2_IMPLEMENTATION
@@ -61,6 +64,8 @@ void nvgDeleteGL2(NVGcontext* ctx);
 
 int nvglCreateImageFromHandleGL2(NVGcontext* ctx, GLuint textureId, int w, int h, int flags);
 GLuint nvglImageHandleGL2(NVGcontext* ctx, int image);
+// Returns draw calls of last frame and how many it would take without NVG_BATCH.
+void nvglDrawCallsGL2(NVGcontext* ctx, int* draws, int* unbatched);
 
 #endif
 
@@ -71,6 +76,8 @@ void nvgDeleteGL3(NVGcontext* ctx);
 
 int nvglCreateImageFromHandleGL3(NVGcontext* ctx, GLuint textureId, int w, int h, int flags);
 GLuint nvglImageHandleGL3(NVGcontext* ctx, int image);
+// Returns draw calls of last frame and how many it would take without NVG_BATCH.
+void nvglDrawCallsGL3(NVGcontext* ctx, int* draws, int* unbatched);
 
 #endif
 
@@ -81,6 +88,8 @@ void nvgDeleteGLES2(NVGcontext* ctx);
 
 int nvglCreateImageFromHandleGLES2(NVGcontext* ctx, GLuint textureId, int w, int h, int flags);
 GLuint nvglImageHandleGLES2(NVGcontext* ctx, int image);
+// Returns draw calls of last frame and how many it would take without NVG_BATCH.
+void nvglDrawCallsGLES2(NVGcontext* ctx, int* draws, int* unbatched);
 
 #endif
 
@@ -91,6 +100,8 @@ void nvgDeleteGLES3(NVGcontext* ctx);
 
 int nvglCreateImageFromHandleGLES3(NVGcontext* ctx, GLuint textureId, int w, int h, int flags);
 GLuint nvglImageHandleGLES3(NVGcontext* ctx, int image);
+// Returns draw calls of last frame and how many it would take without NVG_BATCH.
+void nvglDrawCallsGLES3(NVGcontext* ctx, int* draws, int* unbatched);
 
 #endif
 
@@ -124,7 +135,8 @@ enum GLNVGshaderType {
 	NSVG_SHADER_FILLGRAD,
 	NSVG_SHADER_FILLIMG,
 	NSVG_SHADER_SIMPLE,
-	NSVG_SHADER_IMG
+	NSVG_SHADER_IMG,
+	NSVG_SHADER_BATCH
 };
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
@@ -156,6 +168,7 @@ enum GLNVGcallType {
 	GLNVG_CONVEXFILL,
 	GLNVG_STROKE,
 	GLNVG_TRIANGLES,
+	GLNVG_BATCH,
 };
 
 struct GLNVGcall {
@@ -167,6 +180,7 @@ struct GLNVGcall {
 	int triangleOffset;
 	int triangleCount;
 	int uniformOffset;
+	int drawCount;		// Draw calls merged into batch.
 };
 typedef struct GLNVGcall GLNVGcall;
 
@@ -227,6 +241,7 @@ struct GLNVGcontext {
 	int ctextures;
 	int textureId;
 	GLuint vertBuf;
+	GLuint colorBuf;
 #if defined NANOVG_GL3
 	GLuint vertArr;
 #endif
@@ -246,10 +261,15 @@ struct GLNVGcontext {
 	struct NVGvertex* verts;
 	int cverts;
 	int nverts;
+	unsigned char* colors;	// RGBA per vertex, used by batched calls only
 	unsigned char* uniforms;
 	int cuniforms;
 	int nuniforms;
 
+	// Draw calls of last frame
+	int drawCalls;
+	int unbatchedCalls;
+
 	// cached state
 	#if NANOVG_GL_USE_STATE_FILTER
 	GLuint boundTexture;
@@ -438,6 +458,7 @@ static int glnvg__createShader(GLNVGshader* shader, const char* name, const char
 
 	glBindAttribLocation(prog, 0, "vertex");
 	glBindAttribLocation(prog, 1, "tcoord");
+	glBindAttribLocation(prog, 2, "color");
 
 	glLinkProgram(prog);
 	glGetProgramiv(prog, GL_LINK_STATUS, &status);
@@ -508,17 +529,22 @@ static int glnvg__renderCreate(void* uptr)
 		"	uniform vec2 viewSize;\n"
 		"	in vec2 vertex;\n"
 		"	in vec2 tcoord;\n"
+		"	in vec4 color;\n"
 		"	out vec2 ftcoord;\n"
 		"	out vec2 fpos;\n"
+		"	out vec4 fcolor;\n"
 		"#else\n"
 		"	uniform vec2 viewSize;\n"
 		"	attribute vec2 vertex;\n"
 		"	attribute vec2 tcoord;\n"
+		"	attribute vec4 color;\n"
 		"	varying vec2 ftcoord;\n"
 		"	varying vec2 fpos;\n"
+		"	varying vec4 fcolor;\n"
 		"#endif\n"
 		"void main(void) {\n"
 		"	ftcoord = tcoord;\n"
+		"	fcolor = color;\n"
 		"	fpos = vertex;\n"
 		"	gl_Position = vec4(2.0*vertex.x/viewSize.x - 1.0, 1.0 - 2.0*vertex.y/viewSize.y, 0, 1);\n"
 		"}\n";
@@ -554,12 +580,14 @@ static int glnvg__renderCreate(void* uptr)
 		"	uniform sampler2D tex;\n"
 		"	in vec2 ftcoord;\n"
 		"	in vec2 fpos;\n"
+		"	in vec4 fcolor;\n"
 		"	out vec4 outColor;\n"
 		"#else\n" // !NANOVG_GL3
 		"	uniform vec4 frag[UNIFORMARRAY_SIZE];\n"
 		"	uniform sampler2D tex;\n"
 		"	varying vec2 ftcoord;\n"
 		"	varying vec2 fpos;\n"
+		"	varying vec4 fcolor;\n"
 		"#endif\n"
 		"#ifndef USE_UNIFORMBUFFER\n"
 		"	#define scissorMat mat3(frag[0].xyz, frag[1].xyz, frag[2].xyz)\n"
@@ -640,6 +668,8 @@ static int glnvg__renderCreate(void* uptr)
 		"		if (texType == 2) color = vec4(color.x);"
 		"		color *= scissor;\n"
 		"		result = color * innerCol;\n"
+		"	} else if (type == 4) {		// Batched solid color\n"
+		"		result = fcolor * strokeAlpha * scissor;\n"
 		"	}\n"
 // Discard is really bad on iOS.
 #ifndef TARGET_OS_IPHONE
@@ -672,6 +702,8 @@ static int glnvg__renderCreate(void* uptr)
 	glGenVertexArrays(1, &gl->vertArr);
 #endif
 	glGenBuffers(1, &gl->vertBuf);
+	if (gl->flags & NVG_BATCH)
+		glGenBuffers(1, &gl->colorBuf);
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
 	// Create UBOs
@@ -978,6 +1010,12 @@ static void glnvg__renderViewport(void* uptr, int width, int height, float devic
 	gl->view[1] = (float)height;
 }
 
+static void glnvg__drawArrays(GLNVGcontext* gl, GLenum mode, GLint first, GLsizei count)
+{
+	glDrawArrays(mode, first, count);
+	gl->drawCalls++;
+}
+
 static void glnvg__fill(GLNVGcontext* gl, GLNVGcall* call)
 {
 	GLNVGpath* paths = &gl->paths[call->pathOffset];
@@ -997,7 +1035,7 @@ static void glnvg__fill(GLNVGcontext* gl, GLNVGcall* call)
 	glStencilOpSeparate(GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP);
 	glDisable(GL_CULL_FACE);
 	for (i = 0; i < npaths; i++)
-		glDrawArrays(GL_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount);
+		glnvg__drawArrays(gl, GL_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount);
 	glEnable(GL_CULL_FACE);
 
 	// Draw anti-aliased pixels
@@ -1011,13 +1049,13 @@ static void glnvg__fill(GLNVGcontext* gl, GLNVGcall* call)
 		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
 		// Draw fringes
 		for (i = 0; i < npaths; i++)
-			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+			glnvg__drawArrays(gl, GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
 	}
 
 	// Draw fill
 	glnvg__stencilFunc(gl, GL_NOTEQUAL, 0x0, 0xff);
 	glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
-	glDrawArrays(GL_TRIANGLES, call->triangleOffset, call->triangleCount);
+	glnvg__drawArrays(gl, GL_TRIANGLES, call->triangleOffset, call->triangleCount);
 
 	glDisable(GL_STENCIL_TEST);
 }
@@ -1031,11 +1069,11 @@ static void glnvg__convexFill(GLNVGcontext* gl, GLNVGcall* call)
 	glnvg__checkError(gl, "convex fill");
 
 	for (i = 0; i < npaths; i++)
-		glDrawArrays(GL_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount);
+		glnvg__drawArrays(gl, GL_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount);
 	if (gl->flags & NVG_ANTIALIAS) {
 		// Draw fringes
 		for (i = 0; i < npaths; i++)
-			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+			glnvg__drawArrays(gl, GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
 	}
 }
 
@@ -1055,14 +1093,14 @@ static void glnvg__stroke(GLNVGcontext* gl, GLNVGcall* call)
 		glnvg__setUniforms(gl, call->uniformOffset + gl->fragSize, call);
 		glnvg__checkError(gl, "stroke fill 0");
 		for (i = 0; i < npaths; i++)
-			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+			glnvg__drawArrays(gl, GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
 
 		// Draw anti-aliased pixels.
 		glnvg__setUniforms(gl, call->uniformOffset, call);
 		glnvg__stencilFunc(gl, GL_EQUAL, 0x00, 0xff);
 		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
 		for (i = 0; i < npaths; i++)
-			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+			glnvg__drawArrays(gl, GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
 
 		// Clear stencil buffer.
 		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
@@ -1070,7 +1108,7 @@ static void glnvg__stroke(GLNVGcontext* gl, GLNVGcall* call)
 		glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
 		glnvg__checkError(gl, "stroke fill 1");
 		for (i = 0; i < npaths; i++)
-			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+			glnvg__drawArrays(gl, GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
 		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
 		glDisable(GL_STENCIL_TEST);
@@ -1082,7 +1120,7 @@ static void glnvg__stroke(GLNVGcontext* gl, GLNVGcall* call)
 		glnvg__checkError(gl, "stroke fill");
 		// Draw Strokes
 		for (i = 0; i < npaths; i++)
-			glDrawArrays(GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
+			glnvg__drawArrays(gl, GL_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount);
 	}
 }
 
@@ -1091,7 +1129,15 @@ static void glnvg__triangles(GLNVGcontext* gl, GLNVGcall* call)
 	glnvg__setUniforms(gl, call->uniformOffset, call);
 	glnvg__checkError(gl, "triangles fill");
 
-	glDrawArrays(GL_TRIANGLES, call->triangleOffset, call->triangleCount);
+	glnvg__drawArrays(gl, GL_TRIANGLES, call->triangleOffset, call->triangleCount);
+}
+
+static void glnvg__batch(GLNVGcontext* gl, GLNVGcall* call)
+{
+	glnvg__setUniforms(gl, call->uniformOffset, call);
+	glnvg__checkError(gl, "batch fill");
+
+	glnvg__drawArrays(gl, GL_TRIANGLES, call->triangleOffset, call->triangleCount);
 }
 
 static void glnvg__renderCancel(void* uptr) {
@@ -1146,6 +1192,8 @@ static void glnvg__renderFlush(void* uptr, NVGcompositeOperationState compositeO
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
 	int i;
 
+	gl->drawCalls = 0;
+	gl->unbatchedCalls = 0;
 	if (gl->ncalls > 0) {
 
 		// Setup require GL state.
@@ -1192,6 +1240,12 @@ static void glnvg__renderFlush(void* uptr, NVGcompositeOperationState compositeO
 		glEnableVertexAttribArray(1);
 		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)(size_t)0);
 		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)(0 + 2*sizeof(float)));
+		if (gl->flags & NVG_BATCH) {
+			glBindBuffer(GL_ARRAY_BUFFER, gl->colorBuf);
+			glBufferData(GL_ARRAY_BUFFER, gl->nverts * 4, gl->colors, GL_STREAM_DRAW);
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, 4, (const GLvoid*)(size_t)0);
+		}
 
 		// Set view and texture just once per frame.
 		glUniform1i(gl->shader.loc[GLNVG_LOC_TEX], 0);
@@ -1203,6 +1257,7 @@ static void glnvg__renderFlush(void* uptr, NVGcompositeOperationState compositeO
 
 		for (i = 0; i < gl->ncalls; i++) {
 			GLNVGcall* call = &gl->calls[i];
+			int draws = gl->drawCalls;
 			if (call->type == GLNVG_FILL)
 				glnvg__fill(gl, call);
 			else if (call->type == GLNVG_CONVEXFILL)
@@ -1211,10 +1266,15 @@ static void glnvg__renderFlush(void* uptr, NVGcompositeOperationState compositeO
 				glnvg__stroke(gl, call);
 			else if (call->type == GLNVG_TRIANGLES)
 				glnvg__triangles(gl, call);
+			else if (call->type == GLNVG_BATCH)
+				glnvg__batch(gl, call);
+			gl->unbatchedCalls += call->type == GLNVG_BATCH ? call->drawCount : gl->drawCalls - draws;
 		}
 
 		glDisableVertexAttribArray(0);
 		glDisableVertexAttribArray(1);
+		if (gl->flags & NVG_BATCH)
+			glDisableVertexAttribArray(2);
 #if defined NANOVG_GL3
 		glBindVertexArray(0);
 #endif
@@ -1282,8 +1342,15 @@ static int glnvg__allocVerts(GLNVGcontext* gl, int n)
 		verts = (NVGvertex*)realloc(gl->verts, sizeof(NVGvertex) * cverts);
 		if (verts == NULL) return -1;
 		gl->verts = verts;
+		if (gl->flags & NVG_BATCH) {
+			unsigned char* colors = (unsigned char*)realloc(gl->colors, 4 * cverts);
+			if (colors == NULL) return -1;
+			gl->colors = colors;
+		}
 		gl->cverts = cverts;
 	}
+	if (gl->flags & NVG_BATCH)
+		memset(&gl->colors[gl->nverts * 4], 0, 4 * n);
 	ret = gl->nverts;
 	gl->nverts += n;
 	return ret;
@@ -1318,15 +1385,119 @@ static void glnvg__vset(NVGvertex* vtx, float x, float y, float u, float v)
 	vtx->v = v;
 }
 
+static int glnvg__solidPaint(NVGpaint* paint, NVGscissor* scissor)
+{
+	return paint->image == 0 && memcmp(&paint->innerColor, &paint->outerColor, sizeof(NVGcolor)) == 0 &&
+		(scissor->extent[0] < -0.5f || scissor->extent[1] < -0.5f);
+}
+
+static unsigned char glnvg__colorByte(float c)
+{
+	return c <= 0.0f ? 0 : c >= 1.0f ? 255 : (unsigned char)(c * 255.0f + 0.5f);
+}
+
+// Appends n vertices to the batch at the end of call list, starts new batch if previous call is something else.
+static int glnvg__allocBatch(GLNVGcontext* gl, int n, int draws)
+{
+	GLNVGcall* call = gl->ncalls > 0 ? &gl->calls[gl->ncalls-1] : NULL;
+	int offset;
+
+	if (call == NULL || call->type != GLNVG_BATCH) {
+		GLNVGfragUniforms* frag;
+		int uniformOffset = glnvg__allocFragUniforms(gl, 1);
+		if (uniformOffset == -1) return -1;
+		call = glnvg__allocCall(gl);
+		if (call == NULL) return -1;
+		call->type = GLNVG_BATCH;
+		call->uniformOffset = uniformOffset;
+		call->triangleOffset = gl->nverts;
+		frag = nvg__fragUniformPtr(gl, uniformOffset);
+		memset(frag, 0, sizeof(*frag));
+		frag->scissorExt[0] = 1.0f;
+		frag->scissorExt[1] = 1.0f;
+		frag->scissorScale[0] = 1.0f;
+		frag->scissorScale[1] = 1.0f;
+		frag->strokeMult = 1.0f;
+		frag->strokeThr = -1.0f;
+		frag->type = NSVG_SHADER_BATCH;
+	}
+	offset = glnvg__allocVerts(gl, n);
+	if (offset == -1) return -1;
+	call->triangleCount += n;
+	call->drawCount += draws;
+	return offset;
+}
+
+// Converts fan or strip to triangles with same winding, so culling stays the same.
+static int glnvg__batchVerts(GLNVGcontext* gl, int offset, const NVGvertex* verts, int n, int fan, const unsigned char* color)
+{
+	int i;
+	for (i = 0; i + 2 < n; i++) {
+		NVGvertex* dst = &gl->verts[offset];
+		if (fan) {
+			dst[0] = verts[0];
+			dst[1] = verts[i + 1];
+			dst[2] = verts[i + 2];
+		} else {
+			dst[0] = verts[i + (i & 1)];
+			dst[1] = verts[i + 1 - (i & 1)];
+			dst[2] = verts[i + 2];
+		}
+		memcpy(&gl->colors[offset * 4], color, 4);
+		memcpy(&gl->colors[offset * 4 + 4], color, 4);
+		memcpy(&gl->colors[offset * 4 + 8], color, 4);
+		offset += 3;
+	}
+	return offset;
+}
+
+static int glnvg__batchCount(int n)
+{
+	return n > 2 ? (n - 2) * 3 : 0;
+}
+
+static void glnvg__batchPaths(GLNVGcontext* gl, NVGpaint* paint, const NVGpath* paths, int npaths, int fill)
+{
+	NVGcolor c = glnvg__premulColor(paint->innerColor);
+	unsigned char color[4] = { glnvg__colorByte(c.r), glnvg__colorByte(c.g), glnvg__colorByte(c.b), glnvg__colorByte(c.a) };
+	int i, nverts = 0, draws = 0, offset;
+
+	for (i = 0; i < npaths; i++) {
+		if (fill) {
+			nverts += glnvg__batchCount(paths[i].nfill);
+			draws++;
+		}
+		if (!fill || (gl->flags & NVG_ANTIALIAS)) {
+			nverts += glnvg__batchCount(paths[i].nstroke);
+			draws++;
+		}
+	}
+	offset = glnvg__allocBatch(gl, nverts, draws);
+	if (offset == -1) return;
+
+	for (i = 0; i < npaths; i++) {
+		if (fill)
+			offset = glnvg__batchVerts(gl, offset, paths[i].fill, paths[i].nfill, 1, color);
+		if (!fill || (gl->flags & NVG_ANTIALIAS))
+			offset = glnvg__batchVerts(gl, offset, paths[i].stroke, paths[i].nstroke, 0, color);
+	}
+}
+
 static void glnvg__renderFill(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe,
 							  const float* bounds, const NVGpath* paths, int npaths)
 {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
-	GLNVGcall* call = glnvg__allocCall(gl);
+	GLNVGcall* call;
 	NVGvertex* quad;
 	GLNVGfragUniforms* frag;
 	int i, maxverts, offset;
 
+	if ((gl->flags & NVG_BATCH) && npaths == 1 && paths[0].convex && glnvg__solidPaint(paint, scissor)) {
+		glnvg__batchPaths(gl, paint, paths, npaths, 1);
+		return;
+	}
+
+	call = glnvg__allocCall(gl);
 	if (call == NULL) return;
 
 	call->type = GLNVG_FILL;
@@ -1408,9 +1579,16 @@ static void glnvg__renderStroke(void* uptr, NVGpaint* paint, NVGscissor* scissor
 								float strokeWidth, const NVGpath* paths, int npaths)
 {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
-	GLNVGcall* call = glnvg__allocCall(gl);
+	GLNVGcall* call;
 	int i, maxverts, offset;
 
+	// Antialiased and stencil strokes depend on per call uniforms.
+	if ((gl->flags & NVG_BATCH) && !(gl->flags & (NVG_ANTIALIAS | NVG_STENCIL_STROKES)) && glnvg__solidPaint(paint, scissor)) {
+		glnvg__batchPaths(gl, paint, paths, npaths, 0);
+		return;
+	}
+
+	call = glnvg__allocCall(gl);
 	if (call == NULL) return;
 
 	call->type = GLNVG_STROKE;
@@ -1511,6 +1689,8 @@ static void glnvg__renderDelete(void* uptr)
 #endif
 	if (gl->vertBuf != 0)
 		glDeleteBuffers(1, &gl->vertBuf);
+	if (gl->colorBuf != 0)
+		glDeleteBuffers(1, &gl->colorBuf);
 
 	for (i = 0; i < gl->ntextures; i++) {
 		if (gl->textures[i].tex != 0 && (gl->textures[i].flags & NVG_IMAGE_NODELETE) == 0)
@@ -1520,6 +1700,7 @@ static void glnvg__renderDelete(void* uptr)
 
 	free(gl->paths);
 	free(gl->verts);
+	free(gl->colors);
 	free(gl->uniforms);
 	free(gl->calls);
 
@@ -1623,4 +1804,19 @@ GLuint nvglImageHandleGLES3(NVGcontext* ctx, int image)
 	return tex->tex;
 }
 
+#if defined NANOVG_GL2
+void nvglDrawCallsGL2(NVGcontext* ctx, int* draws, int* unbatched)
+#elif defined NANOVG_GL3
+void nvglDrawCallsGL3(NVGcontext* ctx, int* draws, int* unbatched)
+#elif defined NANOVG_GLES2
+void nvglDrawCallsGLES2(NVGcontext* ctx, int* draws, int* unbatched)
+#elif defined NANOVG_GLES3
+void nvglDrawCallsGLES3(NVGcontext* ctx, int* draws, int* unbatched)
+#endif
+{
+	GLNVGcontext* gl = (GLNVGcontext*)nvgInternalParams(ctx)->userPtr;
+	*draws = gl->drawCalls;
+	*unbatched = gl->unbatchedCalls;
+}
+
 #endif /* NANOVG_GL_IMPLEMENTATION */
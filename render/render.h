@@ -40,6 +40,12 @@ typedef struct render
     void (*set_transform)(void *render, float *t, int reset);
     void (*get_transform)(void *render, float *t);
     int (*inside_shape)(void *render, NSVGshape *shape, float x, float y);
+    void (*free_shape)(void *render, NSVGshape *shape);
+    // redraw only rects (x0, y0, x1, y1 in pixels) in current frame, other pixels keep previous frame
+    void (*set_damage)(void *render, const int *rects, int num_rects);
+    // draws up to end_offscreen go to image of same size instead of frame, returns 0 if not supported
+    int (*begin_offscreen)(void *render, int image, int width, int height);
+    void (*end_offscreen)(void *render);
 } render;
 
 NVGcolor nvgColorU32(uint32_t c);
@@ -47,6 +53,19 @@ NVGcolor transformColor(NVGcolor color, LVGColorTransform *x);
 int LinearGradientStops(const render *render, void *render_obj, NSVGgradient *gradient, LVGColorTransform *x);
 int RadialGradientStops(const render *render, void *render_obj, NSVGgradient *gradient, LVGColorTransform *x);
 void gl_free_image(void *render, int image);
+// software render: premultiplied RGBA pixels of last frame, width*4 bytes per row
+const unsigned char *sw_get_framebuffer(void *render, int *width, int *height);
+// software render: rasterize tiles on given number of threads, 0 - one per cpu, returns threads used
+int sw_set_threads(void *render, int threads);
+// software render: fraction of framebuffer pixels redrawn by last frame
+double sw_get_redrawn(void *render);
+#ifdef _TEST
+// software render: time pixel kernels of each supported instruction set and compare with scalar ones
+void sw_bench_kernels(void);
+// nanovg render: time shapes drawn with and without retained tessellation
+void nvg_bench_cache(LVGShapeCollection *col, int width, int height);
+void nvg_bench_batch(LVGShapeCollection *col, int width, int height);
+#endif
 
 typedef float Transform3x2[2][3];
 
@@ -8,6 +8,11 @@
 #include "render.h"
 #include "nanovg_gl.h"
 #include <assert.h>
+#ifdef _TEST
+#include <stdio.h>
+#include <time.h>
+#include <inttypes.h>
+#endif
 
 extern const render nvg_render;
 
@@ -129,53 +134,149 @@ static void ImagePaint(struct NVGcontext *vg, struct NSVGshape *shape, LVGColorT
         nvgStrokePaint(vg, p);
 }
 
-static void nvgDrawShape(NVGcontext *vg, LVGShapeCollection *shapecol, LVGColorTransform *cxform, float ratio, int blend_mode)
+#define NVG_SCALE_BUCKETS 4 // retained tessellations per shape
+#define NVG_BUCKET_STEPS  2 // scale buckets per octave
+
+typedef struct NVGtessCache
+{
+    NVGretained *fill, *stroke;
+    int bucket;
+} NVGtessCache;
+
+typedef struct NVGshapeCache
+{
+    NVGtessCache tess[NVG_SCALE_BUCKETS];
+    int num_tess, next; // next: tessellation to replace, or next free slot when shape freed
+} NVGshapeCache;
+
+typedef struct NVGrender
+{
+    NVGcontext *vg;
+    NVGshapeCache *shapes; // NSVGshape.cache - 1 indexes this
+    int num_shapes, max_shapes, free_shapes;
+    int num_tessellations;
+} NVGrender;
+
+static void nvgShapePath(NVGcontext *vg, NSVGshape *shape, NSVGshape *shape2, float ratio)
 {
-    int i, j;
+    int i;
     NSVGpath *path, *path2;
     float om_ratio = 1.0f - ratio;
-    for (j = 0; j < shapecol->num_shapes; j++)
+    nvgBeginPath(vg);
+    path2 = shape2 ? shape2->paths : 0;
+    for (path = shape->paths; path != NULL; path = path->next)
     {
-        NSVGshape *shape = shapecol->shapes + j;
-        NSVGshape *shape2 = shapecol->morph ? shapecol->morph->shapes + j : 0;
-        nvgBeginPath(vg);
-        path2 = shape2 ? shape2->paths : 0;
-        for (path = shape->paths; path != NULL; path = path->next)
+        if (NSVG_PAINT_NONE == shape->stroke.type && (NSVG_PAINT_NONE == shape->fill.type || (NSVG_PAINT_NONE != shape->fill.type && !path->closed)))
         {
-            if (NSVG_PAINT_NONE == shape->stroke.type && (NSVG_PAINT_NONE == shape->fill.type || (NSVG_PAINT_NONE != shape->fill.type && !path->closed)))
-            {
-                if (path2)
-                    path2 = path2->next;
-                continue;
-            }
-            int l = path->npts - 1;
-            //l = (int)(l*g_time*0.4) % l;
             if (path2)
-            {
-                assert(path->npts == path2->npts);
-                nvgMoveTo(vg, path->pts[0]*om_ratio + path2->pts[0]*ratio, path->pts[1]*om_ratio + path2->pts[1]*ratio);
-                for (i = 0; i < l; i += 3)
-                {
-                    float *p  = &path->pts[i*2];
-                    float *p2 = &path2->pts[i*2];
-                    nvgBezierTo(vg, p[2]*om_ratio + p2[2]*ratio, p[3]*om_ratio + p2[3]*ratio, p[4]*om_ratio + p2[4]*ratio,
-                            p[5]*om_ratio + p2[5]*ratio, p[6]*om_ratio + p2[6]*ratio, p[7]*om_ratio + p2[7]*ratio);
-                }
-                if (path->closed)
-                    nvgClosePath(vg);
                 path2 = path2->next;
-            } else
+            continue;
+        }
+        int l = path->npts - 1;
+        //l = (int)(l*g_time*0.4) % l;
+        if (path2)
+        {
+            assert(path->npts == path2->npts);
+            nvgMoveTo(vg, path->pts[0]*om_ratio + path2->pts[0]*ratio, path->pts[1]*om_ratio + path2->pts[1]*ratio);
+            for (i = 0; i < l; i += 3)
+            {
+                float *p  = &path->pts[i*2];
+                float *p2 = &path2->pts[i*2];
+                nvgBezierTo(vg, p[2]*om_ratio + p2[2]*ratio, p[3]*om_ratio + p2[3]*ratio, p[4]*om_ratio + p2[4]*ratio,
+                        p[5]*om_ratio + p2[5]*ratio, p[6]*om_ratio + p2[6]*ratio, p[7]*om_ratio + p2[7]*ratio);
+            }
+            if (path->closed)
+                nvgClosePath(vg);
+            path2 = path2->next;
+        } else
+        {
+            nvgMoveTo(vg, path->pts[0], path->pts[1]);
+            for (i = 0; i < l; i += 3)
             {
-                nvgMoveTo(vg, path->pts[0], path->pts[1]);
-                for (i = 0; i < l; i += 3)
-                {
-                    float *p = &path->pts[i*2];
-                    nvgBezierTo(vg, p[2], p[3], p[4], p[5], p[6], p[7]);
-                }
-                if (path->closed)
-                    nvgClosePath(vg);
+                float *p = &path->pts[i*2];
+                nvgBezierTo(vg, p[2], p[3], p[4], p[5], p[6], p[7]);
             }
+            if (path->closed)
+                nvgClosePath(vg);
         }
+    }
+}
+
+static void nvgShapeStrokeStyle(NVGcontext *vg, NSVGshape *shape)
+{
+    nvgStrokeWidth(vg, shape->strokeWidth);
+    nvgLineJoin(vg, shape->strokeLineJoin);
+    nvgLineCap(vg, shape->strokeLineCap);
+    nvgMiterLimit(vg, shape->miterLimit);
+}
+
+static void nvgFreeTess(NVGtessCache *tc)
+{
+    if (tc->fill)
+        nvgDeleteRetained(tc->fill);
+    if (tc->stroke)
+        nvgDeleteRetained(tc->stroke);
+    tc->fill = tc->stroke = 0;
+}
+
+static NVGtessCache *nvgShapeTess(NVGrender *nvg, NSVGshape *shape)
+{   // find or make tessellation of static shape for current zoom
+    NVGcontext *vg = nvg->vg;
+    if (shape->cache <= 0 || shape->cache > nvg->num_shapes)
+        return 0;
+    NVGshapeCache *sc = nvg->shapes + shape->cache - 1;
+    float t[6], ratio = nvgDevicePixelRatio(vg);
+    nvgCurrentTransform(vg, t);
+    float s = (sqrtf(t[0]*t[0] + t[2]*t[2]) + sqrtf(t[1]*t[1] + t[3]*t[3]))*0.5f*ratio;
+    if (!(s > 1e-6f && s < 1e6f))
+        return 0;
+    int i, bucket = (int)floorf(log2f(s)*NVG_BUCKET_STEPS + 0.5f);
+    for (i = 0; i < sc->num_tess; i++)
+        if (sc->tess[i].bucket == bucket)
+            return sc->tess + i;
+    // tessellate for top of bucket, so error stays under tolerance at any zoom inside it
+    float scale = exp2f((bucket + 0.5f)/NVG_BUCKET_STEPS)/ratio;
+    NVGtessCache tc = { 0, 0, bucket };
+    nvgSave(vg);
+    nvgResetTransform(vg);
+    nvgShapePath(vg, shape, 0, 0);
+    if (NSVG_PAINT_NONE != shape->fill.type)
+        tc.fill = nvgRetainFill(vg, scale);
+    if (NSVG_PAINT_NONE != shape->stroke.type)
+    {
+        nvgShapeStrokeStyle(vg, shape);
+        tc.stroke = nvgRetainStroke(vg, scale);
+    }
+    nvgRestore(vg);
+    if ((NSVG_PAINT_NONE != shape->fill.type && !tc.fill) || (NSVG_PAINT_NONE != shape->stroke.type && !tc.stroke))
+    {
+        nvgFreeTess(&tc);
+        return 0;
+    }
+    nvg->num_tessellations++;
+    if (sc->num_tess < NVG_SCALE_BUCKETS)
+        i = sc->num_tess++;
+    else
+    {
+        i = sc->next;
+        sc->next = (sc->next + 1) % NVG_SCALE_BUCKETS;
+        nvgFreeTess(sc->tess + i);
+    }
+    sc->tess[i] = tc;
+    return sc->tess + i;
+}
+
+static void nvgDrawShape(NVGrender *nvg, LVGShapeCollection *shapecol, LVGColorTransform *cxform, float ratio, int blend_mode)
+{
+    NVGcontext *vg = nvg->vg;
+    int j;
+    for (j = 0; j < shapecol->num_shapes; j++)
+    {
+        NSVGshape *shape = shapecol->shapes + j;
+        NSVGshape *shape2 = shapecol->morph ? shapecol->morph->shapes + j : 0;
+        NVGtessCache *tc = shape2 ? 0 : nvgShapeTess(nvg, shape);
+        if (!tc)
+            nvgShapePath(vg, shape, shape2, ratio);
         if (NSVG_PAINT_NONE != shape->fill.type)
         {
             if (NSVG_PAINT_COLOR == shape->fill.type)
@@ -186,7 +287,10 @@ static void nvgDrawShape(NVGcontext *vg, LVGShapeCollection *shapecol, LVGColorT
                 nvgSVGRadialGrad(vg, shape, cxform, 1);
             else if (NSVG_PAINT_IMAGE == shape->fill.type)
                 ImagePaint(vg, shape, cxform, 1);
-            nvgFill(vg);
+            if (tc)
+                nvgFillRetained(vg, tc->fill);
+            else
+                nvgFill(vg);
         }
         if (NSVG_PAINT_NONE != shape->stroke.type)
         {
@@ -196,43 +300,57 @@ static void nvgDrawShape(NVGcontext *vg, LVGShapeCollection *shapecol, LVGColorT
                 nvgSVGLinearGrad(vg, shape, cxform, 0);
             else if (NSVG_PAINT_RADIAL_GRADIENT == shape->stroke.type)
                 nvgSVGRadialGrad(vg, shape, cxform, 0);
-            nvgStrokeWidth(vg, shape->strokeWidth);
-            nvgLineJoin(vg, shape->strokeLineJoin);
-            nvgLineCap(vg, shape->strokeLineCap);
-            nvgMiterLimit(vg, shape->miterLimit);
-            nvgStroke(vg);
+            if (tc)
+                nvgStrokeRetained(vg, tc->stroke);
+            else
+            {
+                nvgShapeStrokeStyle(vg, shape);
+                nvgStroke(vg);
+            }
         }
     }
 }
 
-
 static int nvg_init(void **render, const platform *platform)
 {
+    NVGrender *nvg = calloc(1, sizeof(NVGrender));
 #ifdef EMSCRIPTEN
-    *render = nvgCreateGLES2(0);
+    nvg->vg = nvgCreateGLES2(0);
 #else
-    *render = nvgCreateGL2(/*NVG_ANTIALIAS | NVG_STENCIL_STROKES*/0
+    nvg->vg = nvgCreateGL2(/*NVG_ANTIALIAS | NVG_STENCIL_STROKES | */NVG_BATCH
 #ifdef DEBUG
         | NVG_DEBUG
 #endif
         );
 #endif
+    if (!nvg->vg)
+    {
+        free(nvg);
+        return 0;
+    }
+    nvg->free_shapes = -1;
+    *render = nvg;
     return 1;
 }
 
 static void nvg_release(void *render)
 {
-    NVGcontext *vg = render;
+    NVGrender *nvg = render;
+    for (int i = 0; i < nvg->num_shapes; i++)
+        for (int j = 0; j < nvg->shapes[i].num_tess; j++)
+            nvgFreeTess(nvg->shapes[i].tess + j);
+    free(nvg->shapes);
 #ifdef EMSCRIPTEN
-    nvgDeleteGLES2(vg);
+    nvgDeleteGLES2(nvg->vg);
 #else
-    nvgDeleteGL2(vg);
+    nvgDeleteGL2(nvg->vg);
 #endif
+    free(nvg);
 }
 
 static void nvg_begin_frame(void *render, int viewportWidth, int viewportHeight, int winWidth, int winHeight, int width, int height)
 {
-    NVGcontext *vg = render;
+    NVGcontext *vg = ((NVGrender *)render)->vg;
     nvgBeginFrame(vg, winWidth, winHeight, (float)width / (float)winWidth);
     float scalex = (float)width/viewportWidth;
     float scaley = (float)height/viewportHeight;
@@ -244,18 +362,47 @@ static void nvg_begin_frame(void *render, int viewportWidth, int viewportHeight,
 
 static void nvg_end_frame(void *render)
 {
-    NVGcontext *vg = render;
+    NVGcontext *vg = ((NVGrender *)render)->vg;
     nvgEndFrame(vg);
 }
 
 static int nvg_cache_shape(void *render, NSVGshape *shape)
-{
+{   // only reserve slot, shape is tessellated on first draw when zoom is known
+    NVGrender *nvg = render;
+    int idx = nvg->free_shapes;
+    if (idx >= 0)
+        nvg->free_shapes = nvg->shapes[idx].next;
+    else
+    {
+        if (nvg->num_shapes >= nvg->max_shapes)
+        {
+            nvg->max_shapes = nvg->max_shapes ? nvg->max_shapes*2 : 256;
+            nvg->shapes = realloc(nvg->shapes, nvg->max_shapes*sizeof(NVGshapeCache));
+        }
+        idx = nvg->num_shapes++;
+    }
+    memset(nvg->shapes + idx, 0, sizeof(NVGshapeCache));
+    shape->cache = idx + 1;
     return 1;
 }
 
+static void nvg_free_shape(void *render, NSVGshape *shape)
+{
+    NVGrender *nvg = render;
+    if (shape->cache <= 0 || shape->cache > nvg->num_shapes)
+        return;
+    NVGshapeCache *sc = nvg->shapes + shape->cache - 1;
+    for (int i = 0; i < sc->num_tess; i++)
+        nvgFreeTess(sc->tess + i);
+    sc->num_tess = 0;
+    sc->next = nvg->free_shapes;
+    nvg->free_shapes = shape->cache - 1;
+    shape->cache = 0;
+}
+
 static int nvg_cache_image(void *render, int width, int height, int flags, const void *rgba)
 {
-    NVGcontext *vg = render;
+    NVGcontext *vg = ((NVGrender *)render)->vg;
     return nvgCreateImageRGBA(vg, width, height,
 #ifndef EMSCRIPTEN
         NVG_IMAGE_GENERATE_MIPMAPS |
@@ -273,19 +420,18 @@ static int nvg_cache_gradient(void *render, NSVGpaint *fill)
 
 static void nvg_update_image(void *render, int image, const void *rgba)
 {
-    NVGcontext *vg = render;
+    NVGcontext *vg = ((NVGrender *)render)->vg;
     nvgUpdateImage(vg, image, rgba);
 }
 
 static void nvg_render_shape(void *render, LVGShapeCollection *shapecol, LVGColorTransform *cxform, float ratio, int blend_mode)
 {
-    NVGcontext *vg = render;
-    nvgDrawShape(vg, shapecol, cxform, ratio, blend_mode);
+    nvgDrawShape(render, shapecol, cxform, ratio, blend_mode);
 }
 
 static void nvg_render_image(void *render, int image)
 {
-    NVGcontext *vg = render;
+    NVGcontext *vg = ((NVGrender *)render)->vg;
     int w, h;
     nvgImageSize(vg, image, &w, &h);
     NVGpaint imgPaint = nvgImagePattern(vg, 0, 0, w, h, 0, image, 1.0f);
@@ -297,7 +443,7 @@ static void nvg_render_image(void *render, int image)
 
 static void nvg_set_transform(void *render, float *t, int reset)
 {
-    NVGcontext *vg = render;
+    NVGcontext *vg = ((NVGrender *)render)->vg;
     if (reset)
         nvgResetTransform(vg);
     nvgTransform(vg, t[0], t[1], t[2], t[3], t[4], t[5]);
@@ -305,10 +451,318 @@ static void nvg_set_transform(void *render, float *t, int reset)
 
 static void nvg_get_transform(void *render, float *t)
 {
-    NVGcontext *vg = render;
+    NVGcontext *vg = ((NVGrender *)render)->vg;
     nvgCurrentTransform(vg, t);
 }
 
+#ifdef _TEST
+typedef struct nvg_bench_stats
+{
+    int64_t verts;
+    double area;
+} nvg_bench_stats;
+
+static int bench_create(void *uptr) { return 1; }
+static int bench_create_texture(void *uptr, int type, int w, int h, int imageFlags, const unsigned char *data) { return 1; }
+static int bench_delete_texture(void *uptr, int image) { return 1; }
+static int bench_update_texture(void *uptr, int image, int x, int y, int w, int h, const unsigned char *data) { return 1; }
+static int bench_texture_size(void *uptr, int image, int *w, int *h) { *w = *h = 512; return 1; }
+static void bench_viewport(void *uptr, int width, int height, float devicePixelRatio) {}
+static void bench_cancel(void *uptr) {}
+static void bench_flush(void *uptr, NVGcompositeOperationState compositeOperation) {}
+static void bench_triangles(void *uptr, NVGpaint *paint, NVGscissor *scissor, const NVGvertex *verts, int nverts) {}
+
+static void bench_fill(void *uptr, NVGpaint *paint, NVGscissor *scissor, float fringe, const float *bounds, const NVGpath *paths, int npaths)
+{
+    nvg_bench_stats *st = uptr;
+    for (int i = 0; i < npaths; i++)
+    {   // area of flattened polygon, compared between direct and retained tessellation
+        const NVGvertex *v = paths[i].fill;
+        double a = 0;
+        for (int j = 0, k = paths[i].nfill - 1; j < paths[i].nfill; k = j++)
+            a += (double)v[k].x*v[j].y - (double)v[j].x*v[k].y;
+        st->area += fabs(a)*0.5;
+        st->verts += paths[i].nfill + paths[i].nstroke;
+    }
+}
+
+static void bench_stroke(void *uptr, NVGpaint *paint, NVGscissor *scissor, float fringe, float strokeWidth, const NVGpath *paths, int npaths)
+{
+    nvg_bench_stats *st = uptr;
+    for (int i = 0; i < npaths; i++)
+        st->verts += paths[i].nstroke;
+}
+
+static double bench_frames(NVGrender *nvg, LVGShapeCollection *col, int width, int height, int frames, int zoom, nvg_bench_stats *st, double *max_area)
+{
+    struct timespec ts0, ts1;
+    clock_gettime(CLOCK_MONOTONIC, &ts0);
+    for (int f = 0; f < frames; f++)
+    {   // zoom in and out by half octave around center, like animated camera
+        float s = zoom ? exp2f(0.5f*sinf(f*2.0f*NVG_PI/frames)) : 1.0f;
+        double area = st->area;
+        nvgBeginFrame(nvg->vg, width, height, 1.0f);
+        nvgTranslate(nvg->vg, width*0.5f, height*0.5f);
+        nvgScale(nvg->vg, s, s);
+        nvgTranslate(nvg->vg, -width*0.5f, -height*0.5f);
+        nvgDrawShape(nvg, col, 0, 0.0f, BLEND_REPLACE);
+        nvgEndFrame(nvg->vg);
+        if (max_area)
+            max_area[f] = st->area - area;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts1);
+    return ((ts1.tv_sec - ts0.tv_sec)*1e6 + (ts1.tv_nsec - ts0.tv_nsec)*1e-3)/frames;
+}
+
+void nvg_bench_cache(LVGShapeCollection *col, int width, int height)
+{
+    nvg_bench_stats st;
+    NVGparams params;
+    memset(&st, 0, sizeof(st));
+    memset(&params, 0, sizeof(params));
+    params.userPtr = &st;
+    params.renderCreate = bench_create;
+    params.renderCreateTexture = bench_create_texture;
+    params.renderDeleteTexture = bench_delete_texture;
+    params.renderUpdateTexture = bench_update_texture;
+    params.renderGetTextureSize = bench_texture_size;
+    params.renderViewport = bench_viewport;
+    params.renderCancel = bench_cancel;
+    params.renderFlush = bench_flush;
+    params.renderFill = bench_fill;
+    params.renderStroke = bench_stroke;
+    params.renderTriangles = bench_triangles;
+    NVGrender nvg;
+    memset(&nvg, 0, sizeof(nvg));
+    nvg.vg = nvgCreateInternal(&params);
+    nvg.free_shapes = -1;
+    const int frames = 60;
+    double direct[frames], retained[frames], max_err = 0;
+    int i, zoom;
+    for (zoom = 0; zoom < 2; zoom++)
+    {
+        memset(&st, 0, sizeof(st));
+        double direct_time = bench_frames(&nvg, col, width, height, frames, zoom, &st, direct);
+        int64_t direct_verts = st.verts;
+        for (i = 0; i < col->num_shapes; i++)
+            nvg_cache_shape(&nvg, col->shapes + i);
+        nvg.num_tessellations = 0;
+        memset(&st, 0, sizeof(st));
+        double retained_time = bench_frames(&nvg, col, width, height, frames, zoom, &st, retained);
+        for (i = 0; i < frames; i++)
+        {
+            double err = fabs(retained[i] - direct[i])/(direct[i] > 1.0 ? direct[i] : 1.0);
+            max_err = err > max_err ? err : max_err;
+        }
+        printf("bench: render nvg %s: direct frame time %.2fus, retained frame time %.2fus, tessellations %d, verts %"PRId64"/%"PRId64", fill area error %.3f%%%s\n",
+            zoom ? "zoom" : "static", direct_time, retained_time, nvg.num_tessellations, direct_verts/frames, st.verts/frames,
+            max_err*100.0, max_err > 0.01 ? ", MISMATCH" : "");
+        for (i = 0; i < col->num_shapes; i++)
+            nvg_free_shape(&nvg, col->shapes + i);
+    }
+    free(nvg.shapes);
+    nvgDeleteInternal(nvg.vg);
+}
+
+#ifndef EMSCRIPTEN
+// mock gl layer: keeps vertex buffers and fragment uniforms, expands every color pass draw to triangles and hashes them
+#define MOCK_MAX_NAMES 16
+#define MOCK_LOC_FRAG  3
+typedef struct mock_gl
+{
+    unsigned char *buffers[MOCK_MAX_NAMES];
+    size_t sizes[MOCK_MAX_NAMES];
+    GLuint next_name, array_buffer, attrib_buffer[3];
+    GLboolean color_mask;
+    GLNVGfragUniforms frag;
+    int draws, triangles;
+    uint32_t hash;
+} mock_gl;
+static mock_gl g_mock;
+
+static void mock_hash(const void *data, size_t size)
+{
+    const unsigned char *p = data;
+    for (size_t i = 0; i < size; i++)
+        g_mock.hash = (g_mock.hash ^ p[i])*16777619u;
+}
+
+static void mock_vertex(int idx)
+{
+    GLuint vb = g_mock.attrib_buffer[0], cb = g_mock.attrib_buffer[2];
+    if ((size_t)(idx + 1)*sizeof(NVGvertex) > g_mock.sizes[vb])
+        return;
+    const NVGvertex *v = (const NVGvertex *)g_mock.buffers[vb] + idx;
+    unsigned char color[4];
+    if ((int)g_mock.frag.type == NSVG_SHADER_BATCH && (size_t)(idx + 1)*4 <= g_mock.sizes[cb])
+        memcpy(color, g_mock.buffers[cb] + idx*4, 4);
+    else
+    {
+        color[0] = glnvg__colorByte(g_mock.frag.innerCol.r);
+        color[1] = glnvg__colorByte(g_mock.frag.innerCol.g);
+        color[2] = glnvg__colorByte(g_mock.frag.innerCol.b);
+        color[3] = glnvg__colorByte(g_mock.frag.innerCol.a);
+    }
+    mock_hash(&v->x, sizeof(float)*2);
+    mock_hash(color, 4);
+}
+
+static void APIENTRY mock_glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    g_mock.draws++;
+    if (!g_mock.color_mask)
+        return;
+    for (int i = 0; i + 2 < count; i += (GL_TRIANGLES == mode) ? 3 : 1)
+    {
+        int a = first + i, b = first + i + 1, c = first + i + 2;
+        if (GL_TRIANGLE_FAN == mode)
+            a = first;
+        else if (GL_TRIANGLE_STRIP == mode && (i & 1))
+            a = first + i + 1, b = first + i;
+        mock_vertex(a);
+        mock_vertex(b);
+        mock_vertex(c);
+        g_mock.triangles++;
+    }
+}
+
+static void APIENTRY mock_glBindBuffer(GLenum target, GLuint buffer) { if (GL_ARRAY_BUFFER == target) g_mock.array_buffer = buffer < MOCK_MAX_NAMES ? buffer : 0; }
+static void APIENTRY mock_glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+    GLuint b = g_mock.array_buffer;
+    if (GL_ARRAY_BUFFER != target || !b)
+        return;
+    g_mock.buffers[b] = realloc(g_mock.buffers[b], size ? size : 1);
+    g_mock.sizes[b] = size;
+    if (data)
+        memcpy(g_mock.buffers[b], data, size);
+}
+static void APIENTRY mock_glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer) { if (index < 3) g_mock.attrib_buffer[index] = g_mock.array_buffer; }
+static void APIENTRY mock_glUniform4fv(GLint location, GLsizei count, const GLfloat *value)
+{
+    if (MOCK_LOC_FRAG == location && count*4*sizeof(float) <= sizeof(g_mock.frag))
+        memcpy(&g_mock.frag, value, count*4*sizeof(float));
+}
+static void APIENTRY mock_glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) { g_mock.color_mask = red; }
+static void APIENTRY mock_glGenBuffers(GLsizei n, GLuint *buffers) { while (n--) *buffers++ = ++g_mock.next_name; }
+static void APIENTRY mock_glGenTextures(GLsizei n, GLuint *textures) { while (n--) *textures++ = ++g_mock.next_name; }
+static GLuint APIENTRY mock_glCreateProgram(void) { return 1; }
+static GLuint APIENTRY mock_glCreateShader(GLenum type) { return 1; }
+static GLint APIENTRY mock_glGetUniformLocation(GLuint program, const GLchar *name) { return !strcmp(name, "frag") ? MOCK_LOC_FRAG : !strcmp(name, "tex") ? 2 : 1; }
+static void APIENTRY mock_glGetProgramiv(GLuint program, GLenum pname, GLint *params) { *params = GL_TRUE; }
+static void APIENTRY mock_glGetShaderiv(GLuint shader, GLenum pname, GLint *params) { *params = GL_TRUE; }
+static void APIENTRY mock_glGetIntegerv(GLenum pname, GLint *data) { *data = 4; }
+static GLenum APIENTRY mock_glGetError(void) { return GL_NO_ERROR; }
+static void APIENTRY mock_glGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog) { if (bufSize) *infoLog = 0; }
+static void APIENTRY mock_glGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei *length, GLchar *infoLog) { if (bufSize) *infoLog = 0; }
+static void APIENTRY mock_glShaderSource(GLuint shader, GLsizei count, const GLchar *const*string, const GLint *length) {}
+static void APIENTRY mock_glBindAttribLocation(GLuint program, GLuint index, const GLchar *name) {}
+static void APIENTRY mock_glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels) {}
+static void APIENTRY mock_glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels) {}
+static void APIENTRY mock_glBlendFuncSeparate(GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha) {}
+static void APIENTRY mock_glStencilOpSeparate(GLenum face, GLenum sfail, GLenum dpfail, GLenum dppass) {}
+static void APIENTRY mock_glStencilOp(GLenum fail, GLenum zfail, GLenum zpass) {}
+static void APIENTRY mock_glStencilFunc(GLenum func, GLint ref, GLuint mask) {}
+static void APIENTRY mock_glDeleteBuffers(GLsizei n, const GLuint *buffers) {}
+static void APIENTRY mock_glDeleteTextures(GLsizei n, const GLuint *textures) {}
+static void APIENTRY mock_glUniform2fv(GLint location, GLsizei count, const GLfloat *value) {}
+static void APIENTRY mock_glAttachShader(GLuint program, GLuint shader) {}
+static void APIENTRY mock_glBindTexture(GLenum target, GLuint texture) {}
+static void APIENTRY mock_glBlendFunc(GLenum sfactor, GLenum dfactor) {}
+static void APIENTRY mock_glPixelStorei(GLenum pname, GLint param) {}
+static void APIENTRY mock_glTexParameteri(GLenum target, GLenum pname, GLint param) {}
+static void APIENTRY mock_glUniform1i(GLint location, GLint v0) {}
+static void APIENTRY mock_glUint(GLuint v) {}
+static void APIENTRY mock_glEnum(GLenum v) {}
+static void APIENTRY mock_glVoid(void) {}
+
+#define MOCK_GL_FUNCS(X, Y) \
+    X(DrawArrays) X(BindBuffer) X(BufferData) X(VertexAttribPointer) X(Uniform4fv) X(ColorMask) X(GenBuffers) X(GenTextures) \
+    X(CreateProgram) X(CreateShader) X(GetUniformLocation) X(GetProgramiv) X(GetShaderiv) X(GetIntegerv) X(GetError) \
+    X(GetProgramInfoLog) X(GetShaderInfoLog) X(ShaderSource) X(BindAttribLocation) X(TexImage2D) X(TexSubImage2D) \
+    X(BlendFuncSeparate) X(StencilOpSeparate) X(StencilOp) X(StencilFunc) X(DeleteBuffers) X(DeleteTextures) X(Uniform2fv) \
+    X(AttachShader) X(BindTexture) X(BlendFunc) X(PixelStorei) X(TexParameteri) X(Uniform1i) \
+    Y(CompileShader, Uint) Y(LinkProgram, Uint) Y(DeleteProgram, Uint) Y(DeleteShader, Uint) Y(UseProgram, Uint) \
+    Y(EnableVertexAttribArray, Uint) Y(DisableVertexAttribArray, Uint) Y(StencilMask, Uint) \
+    Y(Enable, Enum) Y(Disable, Enum) Y(CullFace, Enum) Y(FrontFace, Enum) Y(ActiveTexture, Enum) Y(GenerateMipmap, Enum) \
+    Y(Finish, Void)
+
+typedef struct mock_gl_funcs
+{
+#define MOCK_FIELD(f) __typeof__(glad_gl##f) f;
+#define MOCK_FIELD2(f, m) MOCK_FIELD(f)
+    MOCK_GL_FUNCS(MOCK_FIELD, MOCK_FIELD2)
+} mock_gl_funcs;
+
+static NSVGpaint *bench_gradient_paint(LVGShapeCollection *col, int i)
+{   // i indexes fill and stroke of every shape
+    NSVGshape *shape = col->shapes + i/2;
+    NSVGpaint *paint = (i & 1) ? &shape->stroke : &shape->fill;
+    return (NSVG_PAINT_LINEAR_GRADIENT == paint->type || NSVG_PAINT_RADIAL_GRADIENT == paint->type) ? paint : 0;
+}
+
+static void bench_batch_frame(NVGrender *nvg, LVGShapeCollection *col, int width, int height, int *draws, int *unbatched)
+{
+    NSVGpaint *paint;
+    for (int i = 0; i < col->num_shapes*2; i++)
+        if ((paint = bench_gradient_paint(col, i)))
+            nvg_cache_gradient(nvg, paint); // gradient textures are per context, make them in mocked one
+    g_mock.hash = 2166136261u;
+    g_mock.triangles = 0;
+    nvgBeginFrame(nvg->vg, width, height, 1.0f);
+    nvgDrawShape(nvg, col, 0, 0.0f, BLEND_REPLACE);
+    nvgEndFrame(nvg->vg);
+    nvglDrawCallsGL2(nvg->vg, draws, unbatched);
+}
+
+void nvg_bench_batch(LVGShapeCollection *col, int width, int height)
+{
+    mock_gl_funcs saved;
+#define MOCK_SET(f) saved.f = glad_gl##f; glad_gl##f = mock_gl##f;
+#define MOCK_SET2(f, m) saved.f = glad_gl##f; glad_gl##f = (__typeof__(glad_gl##f))mock_gl##m;
+    MOCK_GL_FUNCS(MOCK_SET, MOCK_SET2)
+    memset(&g_mock, 0, sizeof(g_mock));
+    g_mock.color_mask = GL_TRUE;
+    NVGrender direct, batched;
+    memset(&direct, 0, sizeof(direct));
+    memset(&batched, 0, sizeof(batched));
+    direct.vg = nvgCreateGL2(0);
+    batched.vg = nvgCreateGL2(NVG_BATCH);
+    direct.free_shapes = batched.free_shapes = -1;
+    NSVGpaint *paint;
+    int i, *caches = malloc(col->num_shapes*2*sizeof(int) + 1);
+    for (i = 0; i < col->num_shapes*2; i++)
+        if ((paint = bench_gradient_paint(col, i)))
+            caches[i] = paint->gradient->cache;
+    if (direct.vg && batched.vg)
+    {
+        int draws, unbatched, batch_draws, batch_unbatched, triangles;
+        bench_batch_frame(&direct, col, width, height, &draws, &unbatched);
+        uint32_t hash = g_mock.hash;
+        triangles = g_mock.triangles;
+        bench_batch_frame(&batched, col, width, height, &batch_draws, &batch_unbatched);
+        printf("bench: render nvg batch: draw calls %d, batched draw calls %d, triangles %d%s\n", draws, batch_draws, triangles,
+            (hash != g_mock.hash || triangles != g_mock.triangles || draws != batch_unbatched || draws != unbatched) ? ", MISMATCH" : "");
+    }
+    for (i = 0; i < col->num_shapes*2; i++)
+        if ((paint = bench_gradient_paint(col, i)))
+            paint->gradient->cache = caches[i]; // back to images of engine render
+    free(caches);
+    if (direct.vg)
+        nvgDeleteGL2(direct.vg);
+    if (batched.vg)
+        nvgDeleteGL2(batched.vg);
+    for (i = 0; i < MOCK_MAX_NAMES; i++)
+        free(g_mock.buffers[i]);
+#define MOCK_RESTORE(f) glad_gl##f = saved.f;
+#define MOCK_RESTORE2(f, m) MOCK_RESTORE(f)
+    MOCK_GL_FUNCS(MOCK_RESTORE, MOCK_RESTORE2)
+}
+#else
+void nvg_bench_batch(LVGShapeCollection *col, int width, int height) {}
+#endif
+#endif
+
 const render nvg_render =
 {
     nvg_init,
@@ -324,5 +778,9 @@ const render nvg_render =
     nvg_render_image,
     nvg_set_transform,
     nvg_get_transform,
+    0,
+    nvg_free_shape,
+    0, // set_damage: whole frame is redrawn
+    0,
     0
 };
@@ -0,0 +1,1129 @@
+#define NANOSVGRAST_IMPLEMENTATION
+#include <stdlib.h>
+#include <string.h>
+#include "render.h"
+#include "sw_kernels.h"
+#include "../nanovg/nanosvgrast.h"
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#ifndef EMSCRIPTEN
+#include "gl.h"
+#include <pthread.h>
+#endif
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#include <assert.h>
+#include <math.h>
+
+#define SW_TILE_ROWS   16
+#define SW_MAX_THREADS 64
+#define SW_SPAN_CHUNK  256
+
+extern const render sw_render;
+
+typedef struct SWImage
+{
+    uint32_t *rgba;          // not premultiplied, as passed to cache_image
+    int width, height, flags;
+} SWImage;
+
+typedef struct SWPaint
+{
+    Transform3x2 m;          // pixel center -> gradient (-1..1) or image pixel space
+    uint32_t color;          // premultiplied solid color
+    uint32_t lut[256];       // premultiplied gradient ramp
+    SWImage *img;            // resolved from image when frame is flushed
+    int cm[4], ca[4];        // color transform in 8.8 fixed point
+    int type, image, repeat, filtered, blend_mode;
+} SWPaint;
+
+typedef struct SWCommand
+{   // one fill or stroke, edges in pixels with y in subsamples, sorted by y0
+    SWPaint paint;
+    int first_edge, num_edges;
+    int bounds[4];           // x0, y0, x1, y1 in pixels, exclusive end
+    char fill_rule;
+} SWCommand;
+
+typedef struct SWBin
+{   // edges of one command that cross one tile
+    int cmd, first, count;
+} SWBin;
+
+typedef struct SWWorker
+{
+    struct SWRender *sw;
+    NSVGrasterizer *r;       // private active edge pool
+    unsigned char *cover;    // coverage row, kept zeroed
+    int generation;
+#ifndef EMSCRIPTEN
+    pthread_t thread;
+#endif
+} SWWorker;
+
+typedef struct SWRender
+{
+    NSVGrasterizer *r;
+    const platform *platform;
+    const sw_kernels *k;
+    unsigned char *fb;       // premultiplied RGBA, width*4 stride
+    int width, height;
+    Transform3x2 t;
+    SWImage *images;
+    int num_images;
+    SWPaint paint;
+    // frame commands, rasterized in end_frame
+    SWCommand *cmds;
+    int num_cmds, max_cmds;
+    NSVGedge *edges;
+    int num_edges, max_edges;
+    // tiles are SW_TILE_ROWS high full width bands, each keeps its bins in painter's order
+    int num_tiles, *tile_bins, *tile_edges, *tile_last;
+    // area of each tile redrawn by frame: x0, y0, x1, y1, rest of framebuffer keeps previous frame
+    int *tile_damage, fb_valid, full_damage;
+    int64_t redrawn;
+    // draws between begin_offscreen and end_offscreen go to image, child render shares images
+    struct SWRender *offscreen;
+    int offscreen_image, offscreen_active;
+    SWBin *bins;
+    int *bin_edges, max_bins, max_bin_edges;
+    SWWorker *workers;
+    int num_threads, next_tile;
+#ifndef EMSCRIPTEN
+    pthread_mutex_t lock;
+    pthread_cond_t start, done;
+    int generation, busy, quit;
+#endif
+} SWRender;
+
+static inline int sw_clamp255(int v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+static inline uint32_t sw_premultiply(uint32_t c)
+{
+    int a = c >> 24;
+    return nsvg__RGBA(nsvg__div255((c & 0xff)*a), nsvg__div255(((c >> 8) & 0xff)*a), nsvg__div255(((c >> 16) & 0xff)*a), a);
+}
+
+static inline uint32_t sw_cxform(const SWPaint *p, uint32_t c)
+{
+    int r = sw_clamp255((((c      ) & 0xff)*p->cm[0] >> 8) + p->ca[0]);
+    int g = sw_clamp255((((c >>  8) & 0xff)*p->cm[1] >> 8) + p->ca[1]);
+    int b = sw_clamp255((((c >> 16) & 0xff)*p->cm[2] >> 8) + p->ca[2]);
+    int a = sw_clamp255((((c >> 24) & 0xff)*p->cm[3] >> 8) + p->ca[3]);
+    return sw_premultiply(nsvg__RGBA(r, g, b, a));
+}
+
+static inline uint32_t sw_texel(const SWPaint *p, int x, int y)
+{
+    const SWImage *img = p->img;
+    if (p->repeat)
+    {
+        x %= img->width;  if (x < 0) x += img->width;
+        y %= img->height; if (y < 0) y += img->height;
+    } else
+    {
+        x = x < 0 ? 0 : (x >= img->width  ? img->width  - 1 : x);
+        y = y < 0 ? 0 : (y >= img->height ? img->height - 1 : y);
+    }
+    return sw_cxform(p, img->rgba[y*img->width + x]);
+}
+
+static inline uint32_t sw_lerp(uint32_t c0, uint32_t c1, int w)
+{   // w in 0..256
+    uint32_t rb = ((c0 & 0x00ff00ff)*(256 - w) + (c1 & 0x00ff00ff)*w) >> 8;
+    uint32_t ag = (((c0 >> 8) & 0x00ff00ff)*(256 - w) + ((c1 >> 8) & 0x00ff00ff)*w) >> 8;
+    return (rb & 0x00ff00ff) | ((ag & 0x00ff00ff) << 8);
+}
+
+static inline uint32_t sw_fetch_image(const SWPaint *p, float u, float v)
+{
+    if (p->filtered)
+    {
+        u -= 0.5f; v -= 0.5f;
+        int x = (int)floorf(u), y = (int)floorf(v);
+        int fx = (int)((u - x)*256.0f), fy = (int)((v - y)*256.0f);
+        uint32_t c0 = sw_lerp(sw_texel(p, x, y),     sw_texel(p, x + 1, y),     fx);
+        uint32_t c1 = sw_lerp(sw_texel(p, x, y + 1), sw_texel(p, x + 1, y + 1), fx);
+        return sw_lerp(c0, c1, fy);
+    }
+    return sw_texel(p, (int)floorf(u), (int)floorf(v));
+}
+
+static void sw_fetch(const sw_kernels *k, const SWPaint *p, uint32_t *src, const unsigned char *cover, int count, int x, int y)
+{
+    int i;
+    switch (p->type)
+    {
+    case NSVG_PAINT_LINEAR_GRADIENT:
+    case NSVG_PAINT_RADIAL_GRADIENT:
+        k->gradient(src, p->lut, &p->m[0][0], x, y, count, NSVG_PAINT_RADIAL_GRADIENT == p->type);
+        return;
+    case NSVG_PAINT_IMAGE:
+    {
+        float fy = y + 0.5f;
+        for (i = 0; i < count; i++)
+        {
+            float fx = (float)(x + i) + 0.5f;
+            src[i] = cover[i] ? sw_fetch_image(p, p->m[0][0]*fx + p->m[0][1]*fy + p->m[0][2], p->m[1][0]*fx + p->m[1][1]*fy + p->m[1][2]) : 0;
+        }
+        return;
+    }
+    }
+    for (i = 0; i < count; i++)
+        src[i] = p->color;
+}
+
+static void sw_span(const sw_kernels *k, const SWPaint *p, unsigned char *dst, int count, const unsigned char *cover, int x, int y)
+{
+    uint32_t src[SW_SPAN_CHUNK];
+    int normal = p->blend_mode <= BLEND_LAYER;
+    if (normal && NSVG_PAINT_COLOR == p->type)
+    {
+        k->span_solid(dst, cover, count, p->color);
+        return;
+    }
+    for (int i = 0; i < count; i += SW_SPAN_CHUNK)
+    {
+        int n = count - i < SW_SPAN_CHUNK ? count - i : SW_SPAN_CHUNK;
+        sw_fetch(k, p, src, cover + i, n, x + i, y);
+        if (normal)
+            k->span_over(dst + i*4, cover + i, src, n);
+        else
+            k->span_blend(dst + i*4, cover + i, src, n, p->blend_mode);
+    }
+}
+
+static void sw_fill_scanline(const sw_kernels *k, unsigned char *scanline, int len, int x0, int x1, int maxWeight, int *xmin, int *xmax)
+{   // nsvg__fillScanline with inner run done by kernel
+    int i = x0 >> NSVG__FIXSHIFT;
+    int j = x1 >> NSVG__FIXSHIFT;
+    if (i < *xmin)
+        *xmin = i;
+    if (j > *xmax)
+        *xmax = j;
+    if (i >= len || j < 0)
+        return;
+    if (i == j)
+    {   // x0, x1 are the same pixel, so compute combined coverage
+        scanline[i] = (unsigned char)(scanline[i] + ((x1 - x0)*maxWeight >> NSVG__FIXSHIFT));
+        return;
+    }
+    if (i >= 0)
+        scanline[i] = (unsigned char)(scanline[i] + (((NSVG__FIX - (x0 & NSVG__FIXMASK))*maxWeight) >> NSVG__FIXSHIFT));
+    else
+        i = -1;
+    if (j < len)
+        scanline[j] = (unsigned char)(scanline[j] + (((x1 & NSVG__FIXMASK)*maxWeight) >> NSVG__FIXSHIFT));
+    else
+        j = len;
+    if (++i < j)
+        k->fill_cover(scanline + i, j - i, maxWeight);
+}
+
+static void sw_fill_active(const sw_kernels *k, unsigned char *scanline, int len, NSVGactiveEdge *e, int maxWeight, int *xmin, int *xmax, char fillRule)
+{
+    int x0 = 0, w = 0;
+    for (; e; e = e->next)
+    {
+        if (NSVG_FILLRULE_NONZERO == fillRule)
+        {
+            if (!w)
+                x0 = e->x;
+            else if (!(w + e->dir))
+                sw_fill_scanline(k, scanline, len, x0, e->x, maxWeight, xmin, xmax);
+            w += e->dir;
+        } else
+        {
+            if (!w)
+                x0 = e->x;
+            else
+                sw_fill_scanline(k, scanline, len, x0, e->x, maxWeight, xmin, xmax);
+            w = !w;
+        }
+    }
+}
+
+static void sw_raster_bin(SWWorker *w, const SWBin *bin, const int *damage)
+{   // same scanline algorithm as nsvg__rasterizeSortedEdges, limited to damaged area of tile covered by command
+    SWRender *sw = w->sw;
+    NSVGrasterizer *r = w->r;
+    const SWCommand *c = sw->cmds + bin->cmd;
+    const int *idx = sw->bin_edges + bin->first;
+    NSVGactiveEdge *active = NULL;
+    int e = 0, y, s, xmin, xmax, y0 = damage[1], y1 = damage[3];
+    int maxWeight = (255 / NSVG__SUBSAMPLES);
+    if (c->bounds[0] >= damage[2] || c->bounds[2] <= damage[0])
+        return;
+    if (y0 < c->bounds[1])
+        y0 = c->bounds[1];
+    if (y1 > c->bounds[3])
+        y1 = c->bounds[3];
+    nsvg__resetPool(r);
+    r->freelist = NULL;
+    for (y = y0; y < y1; y++)
+    {
+        xmin = sw->width;
+        xmax = 0;
+        for (s = 0; s < NSVG__SUBSAMPLES; ++s)
+        {
+            float scany = (float)(y*NSVG__SUBSAMPLES + s) + 0.5f;
+            NSVGactiveEdge **step = &active;
+            while (*step)
+            {
+                NSVGactiveEdge *z = *step;
+                if (z->ey <= scany)
+                {
+                    *step = z->next;
+                    nsvg__freeActive(r, z);
+                } else
+                {
+                    z->x += z->dx;
+                    step = &((*step)->next);
+                }
+            }
+            for (;;)
+            {
+                int changed = 0;
+                step = &active;
+                while (*step && (*step)->next)
+                {
+                    if ((*step)->x > (*step)->next->x)
+                    {
+                        NSVGactiveEdge *t = *step;
+                        NSVGactiveEdge *q = t->next;
+                        t->next = q->next;
+                        q->next = t;
+                        *step = q;
+                        changed = 1;
+                    }
+                    step = &(*step)->next;
+                }
+                if (!changed)
+                    break;
+            }
+            while (e < bin->count && sw->edges[idx[e]].y0 <= scany)
+            {
+                NSVGedge *edge = sw->edges + idx[e];
+                if (edge->y1 > scany)
+                {   // edges from tiles above are stepped from their first sample, result does not depend on tiling
+                    float start = fmaxf(ceilf(edge->y0 - 0.5f) + 0.5f, 0.5f);
+                    NSVGactiveEdge *z = nsvg__addActive(r, edge, start);
+                    if (z == NULL)
+                        break;
+                    z->x += z->dx*(int)(scany - start);
+                    if (active == NULL)
+                        active = z;
+                    else if (z->x < active->x)
+                    {
+                        z->next = active;
+                        active = z;
+                    } else
+                    {
+                        NSVGactiveEdge *p = active;
+                        while (p->next && p->next->x < z->x)
+                            p = p->next;
+                        z->next = p->next;
+                        p->next = z;
+                    }
+                }
+                e++;
+            }
+            if (active != NULL)
+                sw_fill_active(sw->k, w->cover, sw->width, active, maxWeight, &xmin, &xmax, c->fill_rule);
+        }
+        if (xmin < 0)
+            xmin = 0;
+        if (xmax > sw->width - 1)
+            xmax = sw->width - 1;
+        if (xmin <= xmax)
+        {   // cover is kept zeroed outside of touched range
+            int x0 = xmin > damage[0] ? xmin : damage[0], x1 = xmax < damage[2] - 1 ? xmax : damage[2] - 1;
+            if (x0 <= x1)
+                sw_span(sw->k, &c->paint, sw->fb + (y*sw->width + x0)*4, x1 - x0 + 1, w->cover + x0, x0, y);
+            memset(w->cover + xmin, 0, xmax - xmin + 1);
+        }
+    }
+}
+
+static void sw_raster_tile(SWWorker *w, int tile)
+{
+    SWRender *sw = w->sw;
+    const int *damage = sw->tile_damage + tile*4;
+    if (damage[0] >= damage[2] || damage[1] >= damage[3])
+        return;
+    for (int y = damage[1]; y < damage[3]; y++)
+        memset(sw->fb + (y*sw->width + damage[0])*4, 0, (damage[2] - damage[0])*4);
+    for (int i = sw->tile_bins[tile]; i < sw->tile_bins[tile + 1]; i++)
+        sw_raster_bin(w, sw->bins + i, damage);
+}
+
+static void sw_run_tiles(SWWorker *w)
+{
+    SWRender *sw = w->sw;
+    int tile;
+    while ((tile = __sync_fetch_and_add(&sw->next_tile, 1)) < sw->num_tiles)
+        sw_raster_tile(w, tile);
+}
+
+#ifndef EMSCRIPTEN
+static void *sw_worker(void *arg)
+{
+    SWWorker *w = arg;
+    SWRender *sw = w->sw;
+    pthread_mutex_lock(&sw->lock);
+    for (;;)
+    {
+        while (!sw->quit && w->generation == sw->generation)
+            pthread_cond_wait(&sw->start, &sw->lock);
+        if (sw->quit)
+            break;
+        w->generation = sw->generation;
+        pthread_mutex_unlock(&sw->lock);
+        sw_run_tiles(w);
+        pthread_mutex_lock(&sw->lock);
+        if (!--sw->busy)
+            pthread_cond_signal(&sw->done);
+    }
+    pthread_mutex_unlock(&sw->lock);
+    return 0;
+}
+#endif
+
+static void sw_edge_tiles(SWRender *sw, const NSVGedge *e, int *t0, int *t1)
+{
+    int y0 = (int)floorf(e->y0/NSVG__SUBSAMPLES), y1 = (int)floorf(e->y1/NSVG__SUBSAMPLES);
+    if (y0 < 0)
+        y0 = 0;
+    if (y1 > sw->height - 1)
+        y1 = sw->height - 1;
+    *t0 = y0/SW_TILE_ROWS;
+    *t1 = y1 < y0 ? *t0 - 1 : y1/SW_TILE_ROWS;
+}
+
+static void sw_bin(SWRender *sw)
+{   // two passes: count edges and bins per tile, then fill in command order
+    int i, j, t, t0, t1, num_bins = 0, num_edges = 0;
+    memset(sw->tile_bins, 0, (sw->num_tiles + 1)*sizeof(int));
+    memset(sw->tile_edges, 0, (sw->num_tiles + 1)*sizeof(int));
+    for (t = 0; t < sw->num_tiles; t++)
+        sw->tile_last[t] = -1;
+    for (i = 0; i < sw->num_cmds; i++)
+    {
+        const SWCommand *c = sw->cmds + i;
+        for (j = c->first_edge; j < c->first_edge + c->num_edges; j++)
+        {
+            sw_edge_tiles(sw, sw->edges + j, &t0, &t1);
+            for (t = t0; t <= t1; t++)
+            {
+                if (sw->tile_last[t] != i)
+                {
+                    sw->tile_last[t] = i;
+                    sw->tile_bins[t + 1]++;
+                }
+                sw->tile_edges[t + 1]++;
+            }
+        }
+    }
+    for (t = 0; t < sw->num_tiles; t++)
+    {
+        sw->tile_bins[t + 1]  += sw->tile_bins[t];
+        sw->tile_edges[t + 1] += sw->tile_edges[t];
+    }
+    num_bins  = sw->tile_bins[sw->num_tiles];
+    num_edges = sw->tile_edges[sw->num_tiles];
+    if (num_bins > sw->max_bins)
+    {
+        sw->max_bins = num_bins;
+        sw->bins = realloc(sw->bins, num_bins*sizeof(SWBin));
+    }
+    if (num_edges > sw->max_bin_edges)
+    {
+        sw->max_bin_edges = num_edges;
+        sw->bin_edges = realloc(sw->bin_edges, num_edges*sizeof(int));
+    }
+    // tile_last now holds fill position of last bin, edges are appended to it
+    for (t = 0; t < sw->num_tiles; t++)
+        sw->tile_last[t] = sw->tile_bins[t] - 1;
+    for (i = 0; i < sw->num_cmds; i++)
+    {
+        const SWCommand *c = sw->cmds + i;
+        for (j = c->first_edge; j < c->first_edge + c->num_edges; j++)
+        {
+            sw_edge_tiles(sw, sw->edges + j, &t0, &t1);
+            for (t = t0; t <= t1; t++)
+            {
+                int k = sw->tile_last[t];
+                if (k < sw->tile_bins[t] || sw->bins[k].cmd != i)
+                {
+                    k = ++sw->tile_last[t];
+                    sw->bins[k].cmd   = i;
+                    sw->bins[k].first = sw->tile_edges[t];
+                    sw->bins[k].count = 0;
+                }
+                SWBin *bin = sw->bins + k;
+                sw->bin_edges[bin->first + bin->count++] = j;
+                sw->tile_edges[t]++;
+            }
+        }
+    }
+}
+
+static void sw_flush(SWRender *sw)
+{
+    int i;
+    sw->redrawn = 0;
+    for (i = 0; i < sw->num_tiles; i++)
+    {
+        int *damage = sw->tile_damage + i*4;
+        if (sw->full_damage)
+        {
+            damage[0] = 0;
+            damage[1] = i*SW_TILE_ROWS;
+            damage[2] = sw->width;
+            damage[3] = damage[1] + SW_TILE_ROWS < sw->height ? damage[1] + SW_TILE_ROWS : sw->height;
+        }
+        if (damage[0] < damage[2] && damage[1] < damage[3])
+            sw->redrawn += (int64_t)(damage[2] - damage[0])*(damage[3] - damage[1]);
+    }
+    sw->fb_valid = 1;
+    if (!sw->redrawn)
+    {
+        sw->num_cmds  = 0;
+        sw->num_edges = 0;
+        return;
+    }
+    for (i = 0; i < sw->num_cmds; i++)
+    {   // images may be reallocated or freed after shape was drawn
+        SWPaint *p = &sw->cmds[i].paint;
+        if (NSVG_PAINT_IMAGE != p->type)
+            continue;
+        if (p->image <= 0 || p->image > sw->num_images || !sw->images[p->image - 1].rgba)
+        {
+            p->type  = NSVG_PAINT_COLOR;
+            p->color = 0;
+        } else
+            p->img = sw->images + p->image - 1;
+    }
+    sw_bin(sw);
+    sw->next_tile = 0;
+#ifndef EMSCRIPTEN
+    if (sw->num_threads > 1)
+    {
+        pthread_mutex_lock(&sw->lock);
+        sw->busy = sw->num_threads - 1;
+        sw->generation++;
+        pthread_cond_broadcast(&sw->start);
+        pthread_mutex_unlock(&sw->lock);
+    }
+#endif
+    sw_run_tiles(sw->workers);
+#ifndef EMSCRIPTEN
+    if (sw->num_threads > 1)
+    {
+        pthread_mutex_lock(&sw->lock);
+        while (sw->busy)
+            pthread_cond_wait(&sw->done, &sw->lock);
+        pthread_mutex_unlock(&sw->lock);
+    }
+#endif
+    sw->num_cmds  = 0;
+    sw->num_edges = 0;
+}
+
+static void sw_emit(SWRender *sw, char fill_rule)
+{   // queue flattened edges of rasterizer with current paint
+    NSVGrasterizer *r = sw->r;
+    float x0 = 1e30f, y0 = 1e30f, x1 = -1e30f, y1 = -1e30f;
+    int i;
+    if (!r->nedges)
+        return;
+    for (i = 0; i < r->nedges; i++)
+    {
+        NSVGedge *e = r->edges + i;
+        x0 = fminf(x0, fminf(e->x0, e->x1));
+        x1 = fmaxf(x1, fmaxf(e->x0, e->x1));
+        if (e->y0 < y0)
+            y0 = e->y0;
+        if (e->y1 > y1)
+            y1 = e->y1;
+        e->y0 *= NSVG__SUBSAMPLES;
+        e->y1 *= NSVG__SUBSAMPLES;
+    }
+    int bounds[4] = { (int)floorf(x0), (int)floorf(y0), (int)ceilf(x1) + 1, (int)ceilf(y1) + 1 };
+    if (bounds[0] < 0)
+        bounds[0] = 0;
+    if (bounds[1] < 0)
+        bounds[1] = 0;
+    if (bounds[2] > sw->width)
+        bounds[2] = sw->width;
+    if (bounds[3] > sw->height)
+        bounds[3] = sw->height;
+    if (bounds[0] >= bounds[2] || bounds[1] >= bounds[3])
+        return;
+    qsort(r->edges, r->nedges, sizeof(NSVGedge), nsvg__cmpEdge);
+    if (sw->num_cmds >= sw->max_cmds)
+    {
+        sw->max_cmds = sw->max_cmds ? sw->max_cmds*2 : 64;
+        sw->cmds = realloc(sw->cmds, sw->max_cmds*sizeof(SWCommand));
+    }
+    if (sw->num_edges + r->nedges > sw->max_edges)
+    {
+        while (sw->num_edges + r->nedges > sw->max_edges)
+            sw->max_edges = sw->max_edges ? sw->max_edges*2 : 4096;
+        sw->edges = realloc(sw->edges, sw->max_edges*sizeof(NSVGedge));
+    }
+    SWCommand *c = sw->cmds + sw->num_cmds++;
+    c->paint = sw->paint;
+    c->first_edge = sw->num_edges;
+    c->num_edges  = r->nedges;
+    memcpy(c->bounds, bounds, sizeof(bounds));
+    c->fill_rule = fill_rule;
+    memcpy(sw->edges + sw->num_edges, r->edges, r->nedges*sizeof(NSVGedge));
+    sw->num_edges += r->nedges;
+}
+
+static void sw_point(SWRender *sw, NSVGpath *path, NSVGpath *path2, float ratio, int i, float *dst)
+{
+    float p[2] = { path->pts[i*2], path->pts[i*2 + 1] };
+    if (path2)
+    {
+        p[0] += (path2->pts[i*2]     - p[0])*ratio;
+        p[1] += (path2->pts[i*2 + 1] - p[1])*ratio;
+    }
+    xform(dst, sw->t, p);
+}
+
+static void sw_flatten_path(SWRender *sw, NSVGpath *path, NSVGpath *path2, float ratio, int flags)
+{   // transform control points first, beziers are affine invariant and tolerance stays in pixels
+    NSVGrasterizer *r = sw->r;
+    float p[8];
+    r->npoints = 0;
+    sw_point(sw, path, path2, ratio, 0, p + 6);
+    nsvg__addPathPoint(r, p[6], p[7], flags);
+    for (int i = 0; i < path->npts - 1; i += 3)
+    {
+        p[0] = p[6]; p[1] = p[7];
+        sw_point(sw, path, path2, ratio, i + 1, p + 2);
+        sw_point(sw, path, path2, ratio, i + 2, p + 4);
+        sw_point(sw, path, path2, ratio, i + 3, p + 6);
+        nsvg__flattenCubicBez(r, p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], 0, flags);
+    }
+}
+
+static void sw_set_paint(SWRender *sw, NSVGpaint *paint, uint32_t color2, float ratio, int has_morph, LVGColorTransform *cxform, int blend_mode)
+{
+    SWPaint *p = &sw->paint;
+    int i;
+    for (i = 0; i < 4; i++)
+    {
+        p->cm[i] = cxform ? (int)(cxform->mul[i]*256.0f) : 256;
+        p->ca[i] = cxform ? (int)(cxform->add[i]*255.0f) : 0;
+    }
+    p->type = paint->type;
+    p->blend_mode = blend_mode;
+    identity(p->m);
+    if (NSVG_PAINT_COLOR == paint->type)
+    {
+        uint32_t c = paint->color;
+        if (has_morph)
+            c = nsvg__lerpRGBA(c, color2, ratio);
+        p->color = sw_cxform(p, c);
+        return;
+    }
+    float *xf;
+    float k;
+    if (NSVG_PAINT_IMAGE == paint->type)
+    {
+        if (!paint->color || paint->color > sw->num_images || !sw->images[paint->color - 1].rgba)
+        {   // missing bitmap
+            p->type = NSVG_PAINT_COLOR;
+            p->color = 0;
+            return;
+        }
+        p->image = paint->color;
+        p->repeat = NSVG_SPREAD_PAD != paint->spread;
+        p->filtered = paint->filtered;
+        xf = paint->xform;
+        k = 20.0f;              // bitmap fill matrix maps bitmap pixels to twips
+    } else
+    {
+        NSVGgradient *gradient = paint->gradient;
+        SWImage *ramp = (gradient->cache > 0 && gradient->cache <= sw->num_images) ? sw->images + gradient->cache - 1 : 0;
+        for (i = 0; i < 256; i++)
+            p->lut[i] = ramp && ramp->rgba ? sw_cxform(p, ramp->rgba[i]) : 0;
+        xf = gradient->xform;
+        k = 20.0f/16384.0f;     // swf gradients -16384..16384 square in twips
+    }
+    Transform3x2 inv, tr;
+    Transform3x2 pm = { { xf[0], xf[2], xf[4] },
+                        { xf[1], xf[3], xf[5] } };
+    inverse(pm, pm);
+    scale(tr, k, k);
+    mul(pm, tr, pm);
+    inverse(inv, sw->t);
+    mul(p->m, pm, inv);
+}
+
+static void sw_draw_shape(SWRender *sw, LVGShapeCollection *shapecol, LVGColorTransform *cxform, float ratio, int blend_mode)
+{
+    NSVGrasterizer *r = sw->r;
+    NSVGpath *path, *path2;
+    float scale = sqrtf(fabsf(sw->t[0][0]*sw->t[1][1] - sw->t[0][1]*sw->t[1][0]));
+    for (int j = 0; j < shapecol->num_shapes; j++)
+    {
+        NSVGshape *shape = shapecol->shapes + j;
+        NSVGshape *shape2 = shapecol->morph ? shapecol->morph->shapes + j : 0;
+        if (NSVG_PAINT_NONE != shape->fill.type)
+        {
+            r->nedges = 0;
+            for (path = shape->paths, path2 = shape2 ? shape2->paths : 0; path; path = path->next, path2 = path2 ? path2->next : 0)
+            {
+                if (!path->closed && NSVG_PAINT_NONE == shape->stroke.type)
+                    continue;
+                sw_flatten_path(sw, path, path2, ratio, 0);
+                nsvg__addPathPoint(r, r->points[0].x, r->points[0].y, 0);
+                for (int i = 0, k = r->npoints - 1; i < r->npoints; k = i++)
+                    nsvg__addEdge(r, r->points[k].x, r->points[k].y, r->points[i].x, r->points[i].y);
+            }
+            sw_set_paint(sw, &shape->fill, shape2 ? shape2->fill.color : 0, ratio, shape2 && NSVG_PAINT_COLOR == shape2->fill.type, cxform, blend_mode);
+            sw_emit(sw, shape->fillRule);
+        }
+        if (NSVG_PAINT_NONE != shape->stroke.type)
+        {
+            float width = shape->strokeWidth*scale;
+            if (shape2)
+                width = (shape->strokeWidth + (shape2->strokeWidth - shape->strokeWidth)*ratio)*scale;
+            r->nedges = 0;
+            for (path = shape->paths, path2 = shape2 ? shape2->paths : 0; path; path = path->next, path2 = path2 ? path2->next : 0)
+            {
+                sw_flatten_path(sw, path, path2, ratio, NSVG_PT_CORNER);
+                if (r->npoints < 2)
+                    continue;
+                int closed = path->closed;
+                NSVGpoint *p0 = &r->points[r->npoints - 1], *p1 = &r->points[0];
+                if (nsvg__ptEquals(p0->x, p0->y, p1->x, p1->y, r->distTol))
+                {
+                    r->npoints--;
+                    closed = 1;
+                }
+                if (r->npoints < 2)
+                    continue;
+                nsvg__prepareStroke(r, shape->miterLimit, shape->strokeLineJoin);
+                nsvg__expandStroke(r, r->points, r->npoints, closed, shape->strokeLineJoin, shape->strokeLineCap, width);
+            }
+            sw_set_paint(sw, &shape->stroke, shape2 ? shape2->stroke.color : 0, ratio, shape2 && NSVG_PAINT_COLOR == shape2->stroke.type, cxform, blend_mode);
+            sw_emit(sw, NSVG_FILLRULE_NONZERO);
+        }
+    }
+}
+
+static int sw_cpu_count(void)
+{
+#if defined(EMSCRIPTEN)
+    return 1;
+#elif defined(_WIN32)
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? n : 1;
+#endif
+}
+
+static void sw_free_workers(SWRender *sw)
+{
+    int i;
+#ifndef EMSCRIPTEN
+    if (sw->num_threads > 1)
+    {
+        pthread_mutex_lock(&sw->lock);
+        sw->quit = 1;
+        pthread_cond_broadcast(&sw->start);
+        pthread_mutex_unlock(&sw->lock);
+        for (i = 1; i < sw->num_threads; i++)
+            pthread_join(sw->workers[i].thread, 0);
+        sw->quit = 0;
+    }
+#endif
+    for (i = 0; i < sw->num_threads; i++)
+    {
+        nsvgDeleteRasterizer(sw->workers[i].r);
+        free(sw->workers[i].cover);
+    }
+    free(sw->workers);
+    sw->workers = 0;
+    sw->num_threads = 0;
+}
+
+int sw_set_threads(void *render, int threads)
+{
+    SWRender *sw = render;
+    if (threads <= 0)
+        threads = sw_cpu_count();
+    if (threads > SW_MAX_THREADS)
+        threads = SW_MAX_THREADS;
+#ifdef EMSCRIPTEN
+    threads = 1;
+#endif
+    if (threads == sw->num_threads)
+        return threads;
+    sw_free_workers(sw);
+    sw->workers = calloc(threads, sizeof(SWWorker));
+    for (int i = 0; i < threads; i++)
+    {   // worker 0 runs on the thread that ends the frame
+        SWWorker *w = sw->workers + i;
+        w->sw = sw;
+        w->r  = nsvgCreateRasterizer();
+        w->cover = calloc(sw->width + 1, 1);
+#ifndef EMSCRIPTEN
+        w->generation = sw->generation;
+        if (i && pthread_create(&w->thread, 0, sw_worker, w))
+        {
+            nsvgDeleteRasterizer(w->r);
+            free(w->cover);
+            threads = i;
+            break;
+        }
+#endif
+    }
+    sw->num_threads = threads;
+    return threads;
+}
+
+static int sw_init(void **render, const platform *platform)
+{
+    SWRender *sw = calloc(1, sizeof(SWRender));
+    sw->r = nsvgCreateRasterizer();
+    sw->platform = platform;
+    sw->k = sw_select_kernels();
+    identity(sw->t);
+#ifndef EMSCRIPTEN
+    pthread_mutex_init(&sw->lock, 0);
+    pthread_cond_init(&sw->start, 0);
+    pthread_cond_init(&sw->done, 0);
+#endif
+    sw_set_threads(sw, 0);
+    *render = sw;
+    return 1;
+}
+
+static void sw_release(void *render)
+{
+    SWRender *sw = render;
+    if (sw->offscreen)
+    {
+        sw->offscreen->images = 0;
+        sw->offscreen->num_images = 0;
+        sw_release(sw->offscreen);
+    }
+    sw_free_workers(sw);
+#ifndef EMSCRIPTEN
+    pthread_mutex_destroy(&sw->lock);
+    pthread_cond_destroy(&sw->start);
+    pthread_cond_destroy(&sw->done);
+#endif
+    for (int i = 0; i < sw->num_images; i++)
+        if (sw->images[i].rgba)
+            free(sw->images[i].rgba);
+    if (sw->images)
+        free(sw->images);
+    if (sw->fb)
+        free(sw->fb);
+    free(sw->cmds);
+    free(sw->edges);
+    free(sw->tile_bins);
+    free(sw->tile_edges);
+    free(sw->tile_last);
+    free(sw->tile_damage);
+    free(sw->bins);
+    free(sw->bin_edges);
+    nsvgDeleteRasterizer(sw->r);
+    free(sw);
+}
+
+static void sw_begin_frame(void *render, int viewportWidth, int viewportHeight, int winWidth, int winHeight, int width, int height)
+{
+    SWRender *sw = render;
+    if (width <= 0 || height <= 0)
+    {   // headless: render at clip size
+        width  = viewportWidth;
+        height = viewportHeight;
+    }
+    if (width != sw->width || height != sw->height)
+    {
+        sw->width  = width;
+        sw->height = height;
+        sw->fb = realloc(sw->fb, width*height*4);
+        for (int i = 0; i < sw->num_threads; i++)
+        {
+            free(sw->workers[i].cover);
+            sw->workers[i].cover = calloc(width + 1, 1);
+        }
+        sw->num_tiles  = (height + SW_TILE_ROWS - 1)/SW_TILE_ROWS;
+        sw->tile_bins  = realloc(sw->tile_bins,  (sw->num_tiles + 1)*sizeof(int));
+        sw->tile_edges = realloc(sw->tile_edges, (sw->num_tiles + 1)*sizeof(int));
+        sw->tile_last  = realloc(sw->tile_last,  (sw->num_tiles + 1)*sizeof(int));
+        sw->tile_damage = realloc(sw->tile_damage, sw->num_tiles*4*sizeof(int));
+        sw->fb_valid = 0;
+    }
+    sw->num_cmds  = 0;
+    sw->num_edges = 0;
+    sw->full_damage = 1;
+    float scalex = (float)width/viewportWidth;
+    float scaley = (float)height/viewportHeight;
+    float s = scalex < scaley ? scalex : scaley;
+    Transform3x2 tr;
+    translate(sw->t, -(viewportWidth*s - width)/2, -(viewportHeight*s - height)/2);
+    scale(tr, s, s);
+    mul(sw->t, sw->t, tr);
+}
+
+static void sw_end_frame(void *render)
+{
+    SWRender *sw = render;
+    if (!sw->fb)
+        return;
+    sw_flush(sw);
+#ifndef EMSCRIPTEN
+    if (!sw->platform)
+        return;
+    // present over cleared background, framebuffer is premultiplied
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glWindowPos2i(0, sw->height);
+    glPixelZoom(1.0f, -1.0f);
+    glDrawPixels(sw->width, sw->height, GL_RGBA, GL_UNSIGNED_BYTE, sw->fb);
+    glPixelZoom(1.0f, 1.0f);
+#endif
+}
+
+static void sw_set_damage(void *render, const int *rects, int num_rects)
+{   // framebuffer keeps last frame, so only tiles touched by rects are cleared and rasterized again
+    SWRender *sw = render;
+    int i, t;
+    if (!sw->fb_valid || num_rects < 0)
+        return;
+    sw->full_damage = 0;
+    for (t = 0; t < sw->num_tiles; t++)
+    {
+        int *damage = sw->tile_damage + t*4;
+        damage[0] = sw->width;
+        damage[1] = sw->height;
+        damage[2] = damage[3] = 0;
+    }
+    for (i = 0; i < num_rects; i++)
+    {
+        const int *r = rects + i*4;
+        int x0 = r[0] > 0 ? r[0] : 0, y0 = r[1] > 0 ? r[1] : 0;
+        int x1 = r[2] < sw->width ? r[2] : sw->width, y1 = r[3] < sw->height ? r[3] : sw->height;
+        if (x0 >= x1 || y0 >= y1)
+            continue;
+        for (t = y0/SW_TILE_ROWS; t <= (y1 - 1)/SW_TILE_ROWS; t++)
+        {
+            int *damage = sw->tile_damage + t*4;
+            int ty0 = t*SW_TILE_ROWS > y0 ? t*SW_TILE_ROWS : y0, ty1 = (t + 1)*SW_TILE_ROWS < y1 ? (t + 1)*SW_TILE_ROWS : y1;
+            damage[0] = x0 < damage[0] ? x0 : damage[0];
+            damage[1] = ty0 < damage[1] ? ty0 : damage[1];
+            damage[2] = x1 > damage[2] ? x1 : damage[2];
+            damage[3] = ty1 > damage[3] ? ty1 : damage[3];
+        }
+    }
+}
+
+static int sw_cache_shape(void *render, NSVGshape *shape)
+{
+    return 1;
+}
+
+static int sw_cache_image(void *render, int width, int height, int flags, const void *rgba)
+{
+    SWRender *sw = render;
+    int i;
+    for (i = 0; i < sw->num_images; i++)
+        if (!sw->images[i].rgba)
+            break;
+    if (i == sw->num_images)
+    {
+        sw->num_images++;
+        sw->images = realloc(sw->images, sw->num_images*sizeof(SWImage));
+    }
+    SWImage *img = sw->images + i;
+    img->width  = width;
+    img->height = height;
+    img->flags  = flags;
+    img->rgba   = malloc((width > 0 && height > 0) ? width*height*4 : 4);
+    if (rgba)
+        memcpy(img->rgba, rgba, width*height*4);
+    else
+        memset(img->rgba, 0, width*height*4);
+    return i + 1;
+}
+
+static int sw_cache_gradient(void *render, NSVGpaint *fill)
+{   // radial gradients also use 256 entry ramp indexed by distance
+    int img = LinearGradientStops(&sw_render, render, fill->gradient, 0);
+    fill->gradient->cache = img;
+    return img;
+}
+
+static void sw_free_image(void *render, int image)
+{
+    SWRender *sw = render;
+    if (image <= 0 || image > sw->num_images || !sw->images[image - 1].rgba)
+        return;
+    free(sw->images[image - 1].rgba);
+    sw->images[image - 1].rgba = 0;
+}
+
+static void sw_update_image(void *render, int image, const void *rgba)
+{
+    SWRender *sw = render;
+    if (image <= 0 || image > sw->num_images || !sw->images[image - 1].rgba)
+        return;
+    SWImage *img = sw->images + image - 1;
+    memcpy(img->rgba, rgba, img->width*img->height*4);
+}
+
+static void sw_render_shape(void *render, LVGShapeCollection *shapecol, LVGColorTransform *cxform, float ratio, int blend_mode)
+{
+    SWRender *sw = render;
+    if (sw->offscreen_active)
+        sw = sw->offscreen;
+    if (sw->fb)
+        sw_draw_shape(sw, shapecol, cxform, ratio, blend_mode);
+}
+
+static void sw_render_image(void *render, int image)
+{
+    SWRender *sw = render;
+    if (sw->offscreen_active)
+        sw = sw->offscreen;
+    if (!sw->fb || image <= 0 || image > sw->num_images || !sw->images[image - 1].rgba)
+        return;
+    SWImage *img = sw->images + image - 1;
+    NSVGrasterizer *r = sw->r;
+    float rect[4][2] = { { 0, 0 }, { img->width, 0 }, { img->width, img->height }, { 0, img->height } }, p[4][2];
+    int i;
+    for (i = 0; i < 4; i++)
+        xform(p[i], sw->t, rect[i]);
+    r->nedges = 0;
+    for (i = 0; i < 4; i++)
+        nsvg__addEdge(r, p[i][0], p[i][1], p[(i + 1) & 3][0], p[(i + 1) & 3][1]);
+    SWPaint *paint = &sw->paint;
+    for (i = 0; i < 4; i++)
+    {
+        paint->cm[i] = 256;
+        paint->ca[i] = 0;
+    }
+    paint->type = NSVG_PAINT_IMAGE;
+    paint->image = image;
+    paint->repeat = 0;
+    paint->filtered = 1;
+    paint->blend_mode = BLEND_REPLACE;
+    inverse(paint->m, sw->t);
+    sw_emit(sw, NSVG_FILLRULE_NONZERO);
+}
+
+static void sw_set_transform(void *render, float *t, int reset)
+{
+    SWRender *sw = render;
+    if (sw->offscreen_active)
+        sw = sw->offscreen;
+    Transform3x2 tr;
+    if (reset)
+        identity(sw->t);
+    to_transform3x2(tr, t);
+    mul(sw->t, sw->t, tr);
+}
+
+static void sw_get_transform(void *render, float *t)
+{
+    SWRender *sw = render;
+    if (sw->offscreen_active)
+        sw = sw->offscreen;
+    from_transform3x2(t, sw->t);
+}
+
+static int sw_begin_offscreen(void *render, int image, int width, int height)
+{
+    SWRender *sw = render;
+    if (sw->offscreen_active || image <= 0 || image > sw->num_images || !sw->images[image - 1].rgba ||
+        sw->images[image - 1].width != width || sw->images[image - 1].height != height)
+        return 0;
+    if (!sw->offscreen)
+    {
+        sw_init((void **)&sw->offscreen, 0);
+        sw_set_threads(sw->offscreen, sw->num_threads);
+    }
+    sw_begin_frame(sw->offscreen, width, height, 0, 0, width, height);
+    sw->offscreen->images     = sw->images;
+    sw->offscreen->num_images = sw->num_images;
+    sw->offscreen_image  = image;
+    sw->offscreen_active = 1;
+    return 1;
+}
+
+static void sw_end_offscreen(void *render)
+{   // images are not premultiplied
+    SWRender *sw = render, *off = sw->offscreen;
+    if (!sw->offscreen_active)
+        return;
+    sw->offscreen_active = 0;
+    off->images     = sw->images;
+    off->num_images = sw->num_images;
+    sw_flush(off);
+    off->images     = 0;
+    off->num_images = 0;
+    SWImage *img = sw->images + sw->offscreen_image - 1;
+    unsigned char *dst = (unsigned char *)img->rgba;
+    for (int i = 0; i < off->width*off->height; i++)
+    {
+        const unsigned char *s = off->fb + i*4;
+        int a = s[3];
+        for (int c = 0; c < 3; c++)
+            dst[i*4 + c] = a ? sw_clamp255((s[c]*255 + a/2)/a) : 0;
+        dst[i*4 + 3] = a;
+    }
+}
+
+const unsigned char *sw_get_framebuffer(void *render, int *width, int *height)
+{
+    SWRender *sw = render;
+    *width  = sw->width;
+    *height = sw->height;
+    return sw->fb;
+}
+
+double sw_get_redrawn(void *render)
+{
+    SWRender *sw = render;
+    return sw->width > 0 && sw->height > 0 ? (double)sw->redrawn/((double)sw->width*sw->height) : 0.0;
+}
+
+const render sw_render =
+{
+    sw_init,
+    sw_release,
+    sw_begin_frame,
+    sw_end_frame,
+    sw_cache_shape,
+    sw_cache_image,
+    sw_cache_gradient,
+    sw_free_image,
+    sw_update_image,
+    sw_render_shape,
+    sw_render_image,
+    sw_set_transform,
+    sw_get_transform,
+    0,
+    0,
+    sw_set_damage,
+    sw_begin_offscreen,
+    sw_end_offscreen
+};
@@ -0,0 +1,670 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "render.h"
+#include "sw_kernels.h"
+#if defined(__x86_64__) || defined(__SSE2__)
+#define SW_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SW_NEON 1
+#include <arm_neon.h>
+#endif
+
+static inline int sw_div255(int x)
+{   // same as nsvg__div255
+    return ((x + 1)*257) >> 16;
+}
+
+static inline uint32_t sw_scale(uint32_t s, int c)
+{
+    return sw_div255((s & 0xff)*c) | (sw_div255(((s >> 8) & 0xff)*c) << 8) |
+        (sw_div255(((s >> 16) & 0xff)*c) << 16) | ((uint32_t)sw_div255((s >> 24)*c) << 24);
+}
+
+static inline void sw_over(unsigned char *dst, uint32_t s)
+{
+    int ia = 255 - (s >> 24);
+    dst[0] = (s & 0xff)         + sw_div255(ia*dst[0]);
+    dst[1] = ((s >> 8) & 0xff)  + sw_div255(ia*dst[1]);
+    dst[2] = ((s >> 16) & 0xff) + sw_div255(ia*dst[2]);
+    dst[3] = (s >> 24)          + sw_div255(ia*dst[3]);
+}
+
+static inline int sw_ramp_index(float t)
+{   // written as max/min so NaN goes to 0 like _mm_max_ps/_mm_min_ps
+    t = t > 0.0f ? t : 0.0f;
+    t = t < 255.0f ? t : 255.0f;
+    return (int)t;
+}
+
+static float sw_hardlight(float s, float b)
+{
+    return s <= 0.5f ? b*2.0f*s : b + (2.0f*s - 1.0f) - b*(2.0f*s - 1.0f);
+}
+
+static float sw_blend_alpha(float sa, float da, int blend_mode)
+{
+    switch (blend_mode)
+    {
+    case BLEND_ADD:      return fminf(sa + da, 1.0f);
+    case BLEND_SUBTRACT:
+    case BLEND_INVERT:   return da;
+    case BLEND_ALPHA:    return da*sa;
+    case BLEND_ERASE:    return da*(1.0f - sa);
+    }
+    return sa + da - sa*da;
+}
+
+static void sw_blend_mode(unsigned char *dst, uint32_t src, int blend_mode)
+{   // non separable by integer shortcut modes, premultiplied floats
+    float s[4], d[4], o[4];
+    int i;
+    for (i = 0; i < 4; i++)
+    {
+        s[i] = ((src >> (i*8)) & 0xff)/255.0f;
+        d[i] = dst[i]/255.0f;
+    }
+    float sa = s[3], da = d[3];
+    for (i = 0; i < 3; i++)
+    {
+        float cs = s[i], cb = d[i], su = sa > 0 ? cs/sa : 0, bu = da > 0 ? cb/da : 0, B;
+        switch (blend_mode)
+        {
+        case BLEND_MULTIPLY:   B = su*bu; break;
+        case BLEND_SCREEN:     B = su + bu - su*bu; break;
+        case BLEND_LIGHTEN:    B = su > bu ? su : bu; break;
+        case BLEND_DARKEN:     B = su < bu ? su : bu; break;
+        case BLEND_DIFFERENCE: B = fabsf(su - bu); break;
+        case BLEND_OVERLAY:    B = sw_hardlight(bu, su); break;
+        case BLEND_HARDLIGHT:  B = sw_hardlight(su, bu); break;
+        case BLEND_ADD:        o[i] = fminf(cs + cb, 1.0f); continue;
+        case BLEND_SUBTRACT:   o[i] = fmaxf(cb - cs, 0.0f); continue;
+        case BLEND_INVERT:     o[i] = (da - cb)*sa + cb*(1.0f - sa); continue;
+        case BLEND_ALPHA:      o[i] = cb*sa; continue;
+        case BLEND_ERASE:      o[i] = cb*(1.0f - sa); continue;
+        default:               B = su; break;
+        }
+        o[i] = cs*(1.0f - da) + cb*(1.0f - sa) + sa*da*B;
+    }
+    o[3] = sw_blend_alpha(sa, da, blend_mode);
+    for (i = 0; i < 4; i++)
+    {
+        float v = o[i] < 0.0f ? 0.0f : (o[i] > 1.0f ? 1.0f : o[i]);
+        dst[i] = (unsigned char)(v*255.0f + 0.5f);
+    }
+}
+
+static void fill_cover_c(unsigned char *cover, int count, int weight)
+{
+    for (int i = 0; i < count; i++)
+        cover[i] = (unsigned char)(cover[i] + weight);
+}
+
+static void span_solid_c(unsigned char *dst, const unsigned char *cover, int count, uint32_t color)
+{
+    for (int i = 0; i < count; i++)
+    {
+        int c = cover[i];
+        if (c)
+            sw_over(dst + i*4, c < 255 ? sw_scale(color, c) : color);
+    }
+}
+
+static void span_over_c(unsigned char *dst, const unsigned char *cover, const uint32_t *src, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        int c = cover[i];
+        if (c)
+            sw_over(dst + i*4, c < 255 ? sw_scale(src[i], c) : src[i]);
+    }
+}
+
+static void gradient_c(uint32_t *dst, const uint32_t *lut, const float *m, int x, int y, int count, int radial)
+{
+    float fy = y + 0.5f, uy = m[1]*fy, vy = m[4]*fy;
+    for (int i = 0; i < count; i++)
+    {
+        float fx = (float)(x + i) + 0.5f;
+        float u = m[0]*fx + uy + m[2];
+        if (radial)
+        {
+            float v = m[3]*fx + vy + m[5];
+            dst[i] = lut[sw_ramp_index(sqrtf(u*u + v*v)*255.0f)];
+        } else
+            dst[i] = lut[sw_ramp_index((u + 1.0f)*127.5f)];
+    }
+}
+
+static void span_blend_c(unsigned char *dst, const unsigned char *cover, const uint32_t *src, int count, int blend_mode)
+{
+    for (int i = 0; i < count; i++)
+    {
+        int c = cover[i];
+        if (c)
+            sw_blend_mode(dst + i*4, c < 255 ? sw_scale(src[i], c) : src[i], blend_mode);
+    }
+}
+
+static const sw_kernels sw_kernels_c =
+{
+    "scalar",
+    fill_cover_c,
+    span_solid_c,
+    span_over_c,
+    gradient_c,
+    span_blend_c
+};
+
+#if SW_X86
+static inline __m128i sw_div255_epi16(__m128i x)
+{   // ((x + 1)*257) >> 16 == (y + (y >> 8)) >> 8 with y = x + 1, stays in 16 bits
+    __m128i y = _mm_add_epi16(x, _mm_set1_epi16(1));
+    return _mm_srli_epi16(_mm_add_epi16(y, _mm_srli_epi16(y, 8)), 8);
+}
+
+static inline __m128i sw_over_epi16(__m128i d, __m128i s, __m128i c)
+{   // two pixels as 16 bit channels, coverage of 255 and 0 are exact identities
+    s = sw_div255_epi16(_mm_mullo_epi16(s, c));
+    __m128i a  = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+    __m128i ia = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    return _mm_add_epi16(s, sw_div255_epi16(_mm_mullo_epi16(ia, d)));
+}
+
+static inline __m128i sw_cover4(const unsigned char *cover)
+{   // 4 coverage bytes, each repeated for 4 channels
+    uint32_t c4;
+    memcpy(&c4, cover, 4);
+    __m128i c = _mm_cvtsi32_si128(c4);
+    c = _mm_unpacklo_epi8(c, c);
+    return _mm_unpacklo_epi16(c, c);
+}
+
+static void fill_cover_sse2(unsigned char *cover, int count, int weight)
+{
+    __m128i w = _mm_set1_epi8((char)weight);
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+        _mm_storeu_si128((__m128i *)(cover + i), _mm_add_epi8(_mm_loadu_si128((__m128i *)(cover + i)), w));
+    fill_cover_c(cover + i, count - i, weight);
+}
+
+static void span_solid_sse2(unsigned char *dst, const unsigned char *cover, int count, uint32_t color)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i s = _mm_unpacklo_epi8(_mm_set1_epi32(color), zero);
+    __m128i opaque = _mm_set1_epi32(color);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32_t c4;
+        memcpy(&c4, cover + i, 4);
+        if (!c4)
+            continue;
+        __m128i *p = (__m128i *)(dst + i*4);
+        if (0xffffffff == c4 && (color >> 24) == 255)
+        {
+            _mm_storeu_si128(p, opaque);
+            continue;
+        }
+        __m128i c = sw_cover4(cover + i);
+        __m128i d = _mm_loadu_si128(p);
+        __m128i lo = sw_over_epi16(_mm_unpacklo_epi8(d, zero), s, _mm_unpacklo_epi8(c, zero));
+        __m128i hi = sw_over_epi16(_mm_unpackhi_epi8(d, zero), s, _mm_unpackhi_epi8(c, zero));
+        _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+    }
+    span_solid_c(dst + i*4, cover + i, count - i, color);
+}
+
+static void span_over_sse2(unsigned char *dst, const unsigned char *cover, const uint32_t *src, int count)
+{
+    __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32_t c4;
+        memcpy(&c4, cover + i, 4);
+        if (!c4)
+            continue;
+        __m128i *p = (__m128i *)(dst + i*4);
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i c = sw_cover4(cover + i);
+        __m128i d = _mm_loadu_si128(p);
+        __m128i lo = sw_over_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(c, zero));
+        __m128i hi = sw_over_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(c, zero));
+        _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+    }
+    span_over_c(dst + i*4, cover + i, src + i, count - i);
+}
+
+static inline __m128i sw_ramp_index_ps(__m128 t)
+{
+    t = _mm_max_ps(t, _mm_setzero_ps());
+    t = _mm_min_ps(t, _mm_set1_ps(255.0f));
+    return _mm_cvttps_epi32(t);
+}
+
+static void gradient_sse2(uint32_t *dst, const uint32_t *lut, const float *m, int x, int y, int count, int radial)
+{
+    float fy = y + 0.5f;
+    __m128 m0 = _mm_set1_ps(m[0]), m2 = _mm_set1_ps(m[2]), uy = _mm_set1_ps(m[1]*fy);
+    __m128 m3 = _mm_set1_ps(m[3]), m5 = _mm_set1_ps(m[5]), vy = _mm_set1_ps(m[4]*fy);
+    __m128 half = _mm_set1_ps(0.5f), one = _mm_set1_ps(1.0f), k = _mm_set1_ps(radial ? 255.0f : 127.5f);
+    __m128i xi = _mm_add_epi32(_mm_set1_epi32(x), _mm_setr_epi32(0, 1, 2, 3)), four = _mm_set1_epi32(4);
+    int i = 0, idx[4];
+    for (; i + 4 <= count; i += 4, xi = _mm_add_epi32(xi, four))
+    {
+        __m128 fx = _mm_add_ps(_mm_cvtepi32_ps(xi), half);
+        __m128 u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, fx), uy), m2), t;
+        if (radial)
+        {
+            __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m3, fx), vy), m5);
+            t = _mm_mul_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(u, u), _mm_mul_ps(v, v))), k);
+        } else
+            t = _mm_mul_ps(_mm_add_ps(u, one), k);
+        _mm_storeu_si128((__m128i *)idx, sw_ramp_index_ps(t));
+        dst[i]     = lut[idx[0]];
+        dst[i + 1] = lut[idx[1]];
+        dst[i + 2] = lut[idx[2]];
+        dst[i + 3] = lut[idx[3]];
+    }
+    gradient_c(dst + i, lut, m, x + i, y, count - i, radial);
+}
+
+static inline __m128 sw_hardlight_ps(__m128 s, __m128 b)
+{
+    __m128 two = _mm_set1_ps(2.0f);
+    __m128 s2 = _mm_sub_ps(_mm_mul_ps(two, s), _mm_set1_ps(1.0f));
+    __m128 lo = _mm_mul_ps(_mm_mul_ps(b, two), s);
+    __m128 hi = _mm_sub_ps(_mm_add_ps(b, s2), _mm_mul_ps(b, s2));
+    __m128 mask = _mm_cmple_ps(s, _mm_set1_ps(0.5f));
+    return _mm_or_ps(_mm_and_ps(mask, lo), _mm_andnot_ps(mask, hi));
+}
+
+static void sw_blend_mode_sse2(unsigned char *dst, uint32_t src, int blend_mode)
+{   // one pixel per vector, same operations as sw_blend_mode on each channel
+    __m128i zero = _mm_setzero_si128();
+    __m128 k = _mm_set1_ps(255.0f), z = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    uint32_t d4;
+    memcpy(&d4, dst, 4);
+    __m128 s = _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(src), zero), zero)), k);
+    __m128 d = _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(d4), zero), zero)), k);
+    __m128 sa = _mm_shuffle_ps(s, s, 0xff), da = _mm_shuffle_ps(d, d, 0xff);
+    __m128 su = _mm_and_ps(_mm_div_ps(s, sa), _mm_cmpgt_ps(sa, z));
+    __m128 bu = _mm_and_ps(_mm_div_ps(d, da), _mm_cmpgt_ps(da, z));
+    __m128 B, o;
+    switch (blend_mode)
+    {
+    case BLEND_MULTIPLY:   B = _mm_mul_ps(su, bu); break;
+    case BLEND_SCREEN:     B = _mm_sub_ps(_mm_add_ps(su, bu), _mm_mul_ps(su, bu)); break;
+    case BLEND_LIGHTEN:    B = _mm_max_ps(su, bu); break;
+    case BLEND_DARKEN:     B = _mm_min_ps(su, bu); break;
+    case BLEND_DIFFERENCE: B = _mm_andnot_ps(_mm_set1_ps(-0.0f), _mm_sub_ps(su, bu)); break;
+    case BLEND_OVERLAY:    B = sw_hardlight_ps(bu, su); break;
+    case BLEND_HARDLIGHT:  B = sw_hardlight_ps(su, bu); break;
+    case BLEND_ADD:        o = _mm_min_ps(_mm_add_ps(s, d), one); goto alpha;
+    case BLEND_SUBTRACT:   o = _mm_max_ps(_mm_sub_ps(d, s), z); goto alpha;
+    case BLEND_INVERT:     o = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(da, d), sa), _mm_mul_ps(d, _mm_sub_ps(one, sa))); goto alpha;
+    case BLEND_ALPHA:      o = _mm_mul_ps(d, sa); goto alpha;
+    case BLEND_ERASE:      o = _mm_mul_ps(d, _mm_sub_ps(one, sa)); goto alpha;
+    default:               B = su; break;
+    }
+    o = _mm_add_ps(_mm_add_ps(_mm_mul_ps(s, _mm_sub_ps(one, da)), _mm_mul_ps(d, _mm_sub_ps(one, sa))), _mm_mul_ps(_mm_mul_ps(sa, da), B));
+alpha:;
+    // alpha lane from scalar formula
+    float a = sw_blend_alpha(_mm_cvtss_f32(sa), _mm_cvtss_f32(da), blend_mode);
+    __m128 av = _mm_set1_ps(a);
+    o = _mm_shuffle_ps(o, _mm_shuffle_ps(o, av, 0x02), 0x84);
+    o = _mm_min_ps(_mm_max_ps(o, z), one);
+    __m128i r = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(o, k), _mm_set1_ps(0.5f)));
+    r = _mm_packs_epi32(r, r);
+    d4 = _mm_cvtsi128_si32(_mm_packus_epi16(r, r));
+    memcpy(dst, &d4, 4);
+}
+
+static void span_blend_sse2(unsigned char *dst, const unsigned char *cover, const uint32_t *src, int count, int blend_mode)
+{
+    for (int i = 0; i < count; i++)
+    {
+        int c = cover[i];
+        if (c)
+            sw_blend_mode_sse2(dst + i*4, c < 255 ? sw_scale(src[i], c) : src[i], blend_mode);
+    }
+}
+
+static const sw_kernels sw_kernels_sse2 =
+{
+    "sse2",
+    fill_cover_sse2,
+    span_solid_sse2,
+    span_over_sse2,
+    gradient_sse2,
+    span_blend_sse2
+};
+
+#define SW_AVX2 __attribute__((target("avx2")))
+
+SW_AVX2 static inline __m256i sw_div255_epi16_avx2(__m256i x)
+{
+    __m256i y = _mm256_add_epi16(x, _mm256_set1_epi16(1));
+    return _mm256_srli_epi16(_mm256_add_epi16(y, _mm256_srli_epi16(y, 8)), 8);
+}
+
+SW_AVX2 static inline __m256i sw_over_epi16_avx2(__m256i d, __m256i s, __m256i c)
+{
+    s = sw_div255_epi16_avx2(_mm256_mullo_epi16(s, c));
+    __m256i a  = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xff), 0xff);
+    __m256i ia = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+    return _mm256_add_epi16(s, sw_div255_epi16_avx2(_mm256_mullo_epi16(ia, d)));
+}
+
+SW_AVX2 static inline __m256i sw_cover8(const unsigned char *cover)
+{   // pixels 0..3 in low lane, 4..7 in high lane, each byte repeated for 4 channels
+    __m128i c = _mm_loadl_epi64((const __m128i *)cover);
+    c = _mm_unpacklo_epi8(c, c);
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(c, c)), _mm_unpackhi_epi16(c, c), 1);
+}
+
+SW_AVX2 static void fill_cover_avx2(unsigned char *cover, int count, int weight)
+{
+    __m256i w = _mm256_set1_epi8((char)weight);
+    int i = 0;
+    for (; i + 32 <= count; i += 32)
+        _mm256_storeu_si256((__m256i *)(cover + i), _mm256_add_epi8(_mm256_loadu_si256((__m256i *)(cover + i)), w));
+    _mm256_zeroupper(); // not always inserted by compiler, sse tail would pay for dirty upper halves
+    fill_cover_sse2(cover + i, count - i, weight);
+}
+
+SW_AVX2 static void span_solid_avx2(unsigned char *dst, const unsigned char *cover, int count, uint32_t color)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i opaque = _mm256_set1_epi32(color);
+    __m256i s = _mm256_unpacklo_epi8(opaque, zero);
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        uint64_t c8;
+        memcpy(&c8, cover + i, 8);
+        if (!c8)
+            continue;
+        __m256i *p = (__m256i *)(dst + i*4);
+        if (~(uint64_t)0 == c8 && (color >> 24) == 255)
+        {
+            _mm256_storeu_si256(p, opaque);
+            continue;
+        }
+        __m256i c = sw_cover8(cover + i);
+        __m256i d = _mm256_loadu_si256(p);
+        __m256i lo = sw_over_epi16_avx2(_mm256_unpacklo_epi8(d, zero), s, _mm256_unpacklo_epi8(c, zero));
+        __m256i hi = sw_over_epi16_avx2(_mm256_unpackhi_epi8(d, zero), s, _mm256_unpackhi_epi8(c, zero));
+        _mm256_storeu_si256(p, _mm256_packus_epi16(lo, hi));
+    }
+    _mm256_zeroupper();
+    span_solid_sse2(dst + i*4, cover + i, count - i, color);
+}
+
+SW_AVX2 static void span_over_avx2(unsigned char *dst, const unsigned char *cover, const uint32_t *src, int count)
+{
+    __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        uint64_t c8;
+        memcpy(&c8, cover + i, 8);
+        if (!c8)
+            continue;
+        __m256i *p = (__m256i *)(dst + i*4);
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i c = sw_cover8(cover + i);
+        __m256i d = _mm256_loadu_si256(p);
+        __m256i lo = sw_over_epi16_avx2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(c, zero));
+        __m256i hi = sw_over_epi16_avx2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(c, zero));
+        _mm256_storeu_si256(p, _mm256_packus_epi16(lo, hi));
+    }
+    _mm256_zeroupper();
+    span_over_sse2(dst + i*4, cover + i, src + i, count - i);
+}
+
+SW_AVX2 static void gradient_avx2(uint32_t *dst, const uint32_t *lut, const float *m, int x, int y, int count, int radial)
+{
+    float fy = y + 0.5f;
+    __m256 m0 = _mm256_set1_ps(m[0]), m2 = _mm256_set1_ps(m[2]), uy = _mm256_set1_ps(m[1]*fy);
+    __m256 m3 = _mm256_set1_ps(m[3]), m5 = _mm256_set1_ps(m[5]), vy = _mm256_set1_ps(m[4]*fy);
+    __m256 half = _mm256_set1_ps(0.5f), one = _mm256_set1_ps(1.0f), k = _mm256_set1_ps(radial ? 255.0f : 127.5f);
+    __m256 z = _mm256_setzero_ps(), max = _mm256_set1_ps(255.0f);
+    __m256i xi = _mm256_add_epi32(_mm256_set1_epi32(x), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)), eight = _mm256_set1_epi32(8);
+    int i = 0;
+    for (; i + 8 <= count; i += 8, xi = _mm256_add_epi32(xi, eight))
+    {
+        __m256 fx = _mm256_add_ps(_mm256_cvtepi32_ps(xi), half);
+        __m256 u = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0, fx), uy), m2), t;
+        if (radial)
+        {
+            __m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m3, fx), vy), m5);
+            t = _mm256_mul_ps(_mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(u, u), _mm256_mul_ps(v, v))), k);
+        } else
+            t = _mm256_mul_ps(_mm256_add_ps(u, one), k);
+        __m256i idx = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(t, z), max));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_i32gather_epi32((const int *)lut, idx, 4));
+    }
+    _mm256_zeroupper();
+    gradient_sse2(dst + i, lut, m, x + i, y, count - i, radial);
+}
+
+static const sw_kernels sw_kernels_avx2 =
+{
+    "avx2",
+    fill_cover_avx2,
+    span_solid_avx2,
+    span_over_avx2,
+    gradient_avx2,
+    span_blend_sse2
+};
+#endif
+
+#if SW_NEON
+static inline uint16x8_t sw_div255_u16(uint16x8_t x)
+{
+    uint16x8_t y = vaddq_u16(x, vdupq_n_u16(1));
+    return vshrq_n_u16(vaddq_u16(y, vshrq_n_u16(y, 8)), 8);
+}
+
+static inline uint16x8_t sw_over_u16(uint16x8_t d, uint16x8_t s, uint16x8_t c)
+{   // two pixels as 16 bit channels
+    s = sw_div255_u16(vmulq_u16(s, c));
+    uint16x8_t ia = vsubq_u16(vdupq_n_u16(255), vcombine_u16(vdup_n_u16(vgetq_lane_u16(s, 3)), vdup_n_u16(vgetq_lane_u16(s, 7))));
+    return vaddq_u16(s, sw_div255_u16(vmulq_u16(ia, d)));
+}
+
+static inline uint16x8_t sw_cover2(const unsigned char *cover)
+{
+    return vcombine_u16(vdup_n_u16(cover[0]), vdup_n_u16(cover[1]));
+}
+
+static void fill_cover_neon(unsigned char *cover, int count, int weight)
+{
+    uint8x16_t w = vdupq_n_u8((uint8_t)weight);
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+        vst1q_u8(cover + i, vaddq_u8(vld1q_u8(cover + i), w));
+    fill_cover_c(cover + i, count - i, weight);
+}
+
+static void span_solid_neon(unsigned char *dst, const unsigned char *cover, int count, uint32_t color)
+{
+    uint16x8_t s = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(color)));
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32_t c4;
+        memcpy(&c4, cover + i, 4);
+        if (!c4)
+            continue;
+        uint8x16_t d = vld1q_u8(dst + i*4);
+        uint16x8_t lo = sw_over_u16(vmovl_u8(vget_low_u8(d)),  s, sw_cover2(cover + i));
+        uint16x8_t hi = sw_over_u16(vmovl_u8(vget_high_u8(d)), s, sw_cover2(cover + i + 2));
+        vst1q_u8(dst + i*4, vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi)));
+    }
+    span_solid_c(dst + i*4, cover + i, count - i, color);
+}
+
+static void span_over_neon(unsigned char *dst, const unsigned char *cover, const uint32_t *src, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32_t c4;
+        memcpy(&c4, cover + i, 4);
+        if (!c4)
+            continue;
+        uint8x16_t s = vreinterpretq_u8_u32(vld1q_u32(src + i));
+        uint8x16_t d = vld1q_u8(dst + i*4);
+        uint16x8_t lo = sw_over_u16(vmovl_u8(vget_low_u8(d)),  vmovl_u8(vget_low_u8(s)),  sw_cover2(cover + i));
+        uint16x8_t hi = sw_over_u16(vmovl_u8(vget_high_u8(d)), vmovl_u8(vget_high_u8(s)), sw_cover2(cover + i + 2));
+        vst1q_u8(dst + i*4, vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi)));
+    }
+    span_over_c(dst + i*4, cover + i, src + i, count - i);
+}
+
+static const sw_kernels sw_kernels_neon =
+{   // float kernels stay scalar, fused multiply-add contraction would change results
+    "neon",
+    fill_cover_neon,
+    span_solid_neon,
+    span_over_neon,
+    gradient_c,
+    span_blend_c
+};
+#endif
+
+static const sw_kernels *sw_available_kernels(int n)
+{   // n-th kernel set supported by this cpu, scalar first
+    const sw_kernels *k[4];
+    int num = 0;
+    k[num++] = &sw_kernels_c;
+#if SW_X86
+    __builtin_cpu_init();
+    k[num++] = &sw_kernels_sse2;
+    if (__builtin_cpu_supports("avx2"))
+        k[num++] = &sw_kernels_avx2;
+#endif
+#if SW_NEON
+    k[num++] = &sw_kernels_neon;
+#endif
+    return n < num ? k[n] : 0;
+}
+
+const sw_kernels *sw_select_kernels(void)
+{   // last available is the widest
+    const sw_kernels *k = &sw_kernels_c, *next;
+    for (int i = 0; (next = sw_available_kernels(i)); i++)
+        k = next;
+    return k;
+}
+
+#ifdef _TEST
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_PIXELS 4096
+#define BENCH_ITERATIONS 2000
+
+static uint32_t bench_rand(uint32_t *seed)
+{
+    *seed = *seed*1664525 + 1013904223;
+    return *seed >> 8;
+}
+
+static uint32_t bench_premultiplied(uint32_t *seed)
+{
+    uint32_t c = bench_rand(seed), a = c >> 24;
+    if (c & 1)
+        a = 255;
+    return (((c & 0xff)*a/255)) | ((((c >> 8) & 0xff)*a/255) << 8) | ((((c >> 16) & 0xff)*a/255) << 16) | (a << 24);
+}
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+typedef struct bench_data
+{
+    unsigned char cover[BENCH_PIXELS], dst[BENCH_PIXELS*4];
+    uint32_t src[BENCH_PIXELS], lut[256];
+    float m[6];
+} bench_data;
+
+static void bench_init(bench_data *b, uint32_t seed)
+{
+    int i;
+    for (i = 0; i < BENCH_PIXELS; i++)
+    {   // runs of empty, partial and full coverage like real spans
+        uint32_t r = bench_rand(&seed) & 7;
+        b->cover[i] = r < 2 ? 0 : (r < 5 ? 255 : bench_rand(&seed));
+        b->src[i] = bench_premultiplied(&seed);
+        uint32_t d = bench_premultiplied(&seed);
+        memcpy(b->dst + i*4, &d, 4);
+    }
+    for (i = 0; i < 256; i++)
+        b->lut[i] = bench_premultiplied(&seed);
+    b->m[0] = 0.00731f; b->m[1] = -0.0023f; b->m[2] = -1.1f;
+    b->m[3] = 0.0019f;  b->m[4] = 0.0061f;  b->m[5] = -0.7f;
+}
+
+static void bench_run(const sw_kernels *k, bench_data *b, int kernel, int blend_mode, int start, int count)
+{
+    switch (kernel)
+    {
+    case 0: k->fill_cover(b->cover + start, count, 51); break;
+    case 1: k->span_solid(b->dst + start*4, b->cover + start, count, b->src[7]); break;
+    case 2: k->span_over(b->dst + start*4, b->cover + start, b->src + start, count); break;
+    case 3: k->gradient(b->src + start, b->lut, b->m, start - 300, 77, count, 0); break;
+    case 4: k->gradient(b->src + start, b->lut, b->m, start - 300, 77, count, 1); break;
+    case 5: k->span_blend(b->dst + start*4, b->cover + start, b->src + start, count, blend_mode); break;
+    }
+}
+
+void sw_bench_kernels(void)
+{
+    static const char *names[] = { "fill cover", "solid", "over", "linear", "radial", "blend" };
+    static bench_data ref, test, work;
+    const sw_kernels *k;
+    for (int n = 0; (k = sw_available_kernels(n)); n++)
+    {
+        char mismatch[256] = "";
+        printf("bench: render sw kernels %s: ", k->name);
+        for (int kernel = 0; kernel < 6; kernel++)
+        {   // exactness on fresh data, blend checks every mode
+            int mode = BLEND_MULTIPLY, last = 5 == kernel ? BLEND_HARDLIGHT : BLEND_MULTIPLY;
+            for (; mode <= last; mode++)
+            {
+                bench_init(&ref, 12345 + kernel);
+                bench_init(&test, 12345 + kernel);
+                for (int i = 0; i < 33; i++)
+                {   // all tail lengths and unaligned starts
+                    bench_run(&sw_kernels_c, &ref, kernel, mode, i, BENCH_PIXELS - 2*i - i/3);
+                    bench_run(k, &test, kernel, mode, i, BENCH_PIXELS - 2*i - i/3);
+                }
+                if (memcmp(&ref, &test, sizeof(ref)))
+                {
+                    snprintf(mismatch + strlen(mismatch), sizeof(mismatch) - strlen(mismatch), ", MISMATCH %s", names[kernel]);
+                    break;
+                }
+            }
+            bench_init(&work, 777);
+            double t = bench_now();
+            for (int i = 0; i < BENCH_ITERATIONS; i++)
+                bench_run(k, &work, kernel, BLEND_SCREEN, 0, BENCH_PIXELS);
+            t = bench_now() - t;
+            printf("%s%s %.1fMpix/s", kernel ? ", " : "", names[kernel], (double)BENCH_PIXELS*BENCH_ITERATIONS/t*1e-6);
+        }
+        printf("%s\n", mismatch);
+    }
+}
+#endif
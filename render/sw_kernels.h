@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+
+// pixel kernels of software render, all produce same bytes as scalar versions
+typedef struct sw_kernels
+{
+    const char *name;
+    // cover[i] += weight, wraps like nsvg__fillScanline
+    void (*fill_cover)(unsigned char *cover, int count, int weight);
+    // premultiplied color over dst, scaled by coverage
+    void (*span_solid)(unsigned char *dst, const unsigned char *cover, int count, uint32_t color);
+    // premultiplied src pixels over dst, scaled by coverage
+    void (*span_over)(unsigned char *dst, const unsigned char *cover, const uint32_t *src, int count);
+    // ramp lookup for pixels x..x+count-1 of row y, m is 2x3 pixel center to gradient space transform
+    void (*gradient)(uint32_t *dst, const uint32_t *lut, const float *m, int x, int y, int count, int radial);
+    // BLEND_* modes other than normal, scaled by coverage
+    void (*span_blend)(unsigned char *dst, const unsigned char *cover, const uint32_t *src, int count, int blend_mode);
+} sw_kernels;
+
+const sw_kernels *sw_select_kernels(void);
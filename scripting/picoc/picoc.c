@@ -486,6 +486,34 @@ static void lib_lvgFree(struct ParseState *Parser, struct Value *ReturnValue, st
     lvgFree(Ptr(0));
 }
 
+static void lib_lvgGetFileView(struct ParseState *Parser, struct Value *ReturnValue, struct Value **Param, int NumArgs)
+{
+    if (2 != NumArgs)
+        return;
+    ReturnValue->Val->Pointer = (void *)lvgGetFileView(e, Ptr(0), Ptr(1));
+}
+
+static void lib_lvgReleaseFileView(struct ParseState *Parser, struct Value *ReturnValue, struct Value **Param, int NumArgs)
+{
+    if (1 != NumArgs)
+        return;
+    lvgReleaseFileView(e, Ptr(0));
+}
+
+static void lib_lvgGetNumFiles(struct ParseState *Parser, struct Value *ReturnValue, struct Value **Param, int NumArgs)
+{
+    if (0 != NumArgs)
+        return;
+    ReturnValue->Val->Integer = lvgGetNumFiles(e);
+}
+
+static void lib_lvgGetFileName(struct ParseState *Parser, struct Value *ReturnValue, struct Value **Param, int NumArgs)
+{
+    if (2 != NumArgs)
+        return;
+    ReturnValue->Val->Pointer = (void *)lvgGetFileName(e, Int(0), Ptr(1));
+}
+
 static void lib_lvgTranslate(struct ParseState *Parser, struct Value *ReturnValue, struct Value **Param, int NumArgs)
 {
     if (2 != NumArgs)
@@ -675,6 +703,10 @@ static const struct LibraryFunction g_lvgLib[] =
     { lib_lvgGetParams, "platform_params *lvgGetParams();" },
     { lib_lvgGetFileContents, "char *lvgGetFileContents(char *fname, int *size);" },
     { lib_lvgFree, "void lvgFree(void *buf);" },
+    { lib_lvgGetFileView, "char *lvgGetFileView(char *fname, int *size);" },
+    { lib_lvgReleaseFileView, "void lvgReleaseFileView(char *buf);" },
+    { lib_lvgGetNumFiles, "int lvgGetNumFiles();" },
+    { lib_lvgGetFileName, "char *lvgGetFileName(int idx, int *name_len);" },
     { lib_lvgTranslate, "void lvgTranslate(float x, float y);" },
     { lib_lvgScale, "void lvgScale(float x, float y);" },
     { lib_lvgViewport, "void lvgViewport(int w, int h);" },
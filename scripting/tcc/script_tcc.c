@@ -100,6 +100,8 @@ const struct SYM g_syms[] = {
     { "lvgLoadClip", lvgLoadClip },
     { "lvgGetFileContents", lvgGetFileContents },
     { "lvgFree", lvgFree },
+    { "lvgGetFileView", lvgGetFileView },
+    { "lvgReleaseFileView", lvgReleaseFileView },
     //{ "lvgStartAudio", lvgStartAudio },
     { "lvgPlaySound", lvgPlaySound },
     { "lvgLoadMP3", lvgLoadMP3 },
@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#ifndef EMSCRIPTEN
+#include <pthread.h>
+#endif
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#include "jobs.h"
+
+#define JOBS_MAX_THREADS 64
+
+typedef struct job
+{
+    job_func func;
+    void *arg;
+} job;
+
+struct job_pool
+{
+    job *jobs;
+    int num_jobs, max_jobs, next_job, done_jobs;
+    int num_threads, quit;
+#ifndef EMSCRIPTEN
+    pthread_t threads[JOBS_MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t start, done;
+#endif
+};
+
+int jobs_cpu_count(void)
+{
+#if defined(EMSCRIPTEN)
+    return 1;
+#elif defined(_WIN32)
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? n : 1;
+#endif
+}
+
+#ifndef EMSCRIPTEN
+static int jobs_run_next(job_pool *p)
+{   // called with lock held, lock is released while job runs
+    if (p->next_job >= p->num_jobs)
+        return 0;
+    job j = p->jobs[p->next_job++];
+    pthread_mutex_unlock(&p->lock);
+    j.func(j.arg);
+    pthread_mutex_lock(&p->lock);
+    if (++p->done_jobs == p->num_jobs)
+        pthread_cond_broadcast(&p->done);
+    return 1;
+}
+
+static void *jobs_worker(void *arg)
+{
+    job_pool *p = arg;
+    pthread_mutex_lock(&p->lock);
+    while (!p->quit)
+    {
+        if (!jobs_run_next(p))
+            pthread_cond_wait(&p->start, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return 0;
+}
+#endif
+
+job_pool *jobs_create(int threads)
+{
+    job_pool *p = calloc(1, sizeof(job_pool));
+    if (threads <= 0)
+        threads = jobs_cpu_count();
+    if (threads > JOBS_MAX_THREADS)
+        threads = JOBS_MAX_THREADS;
+#ifdef EMSCRIPTEN
+    p->num_threads = 1;
+#else
+    pthread_mutex_init(&p->lock, 0);
+    pthread_cond_init(&p->start, 0);
+    pthread_cond_init(&p->done, 0);
+    // thread 0 is the caller, it joins work in jobs_wait
+    for (p->num_threads = 1; p->num_threads < threads; p->num_threads++)
+        if (pthread_create(&p->threads[p->num_threads], 0, jobs_worker, p))
+            break;
+#endif
+    return p;
+}
+
+void jobs_add(job_pool *p, job_func func, void *arg)
+{
+    if (p->num_threads < 2)
+    {
+        func(arg);
+        return;
+    }
+#ifndef EMSCRIPTEN
+    pthread_mutex_lock(&p->lock);
+    if (p->num_jobs >= p->max_jobs)
+    {
+        p->max_jobs = p->max_jobs ? p->max_jobs*2 : 16;
+        p->jobs = realloc(p->jobs, p->max_jobs*sizeof(job));
+    }
+    p->jobs[p->num_jobs].func = func;
+    p->jobs[p->num_jobs++].arg = arg;
+    pthread_cond_signal(&p->start);
+    pthread_mutex_unlock(&p->lock);
+#endif
+}
+
+void jobs_wait(job_pool *p)
+{
+#ifndef EMSCRIPTEN
+    if (p->num_threads < 2)
+        return;
+    pthread_mutex_lock(&p->lock);
+    while (jobs_run_next(p))
+        ;
+    while (p->done_jobs < p->num_jobs)
+        pthread_cond_wait(&p->done, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+#endif
+}
+
+void jobs_free(job_pool *p)
+{
+    if (!p)
+        return;
+#ifndef EMSCRIPTEN
+    jobs_wait(p);
+    if (p->num_threads > 1)
+    {
+        pthread_mutex_lock(&p->lock);
+        p->quit = 1;
+        pthread_cond_broadcast(&p->start);
+        pthread_mutex_unlock(&p->lock);
+        for (int i = 1; i < p->num_threads; i++)
+            pthread_join(p->threads[i], 0);
+    }
+    pthread_cond_destroy(&p->done);
+    pthread_cond_destroy(&p->start);
+    pthread_mutex_destroy(&p->lock);
+#endif
+    free(p->jobs);
+    free(p);
+}
+
+int jobs_threads(job_pool *p)
+{
+    return p->num_threads;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// fire and forget job pool: jobs run on worker threads while caller continues, jobs_wait joins them
+typedef void (*job_func)(void *arg);
+typedef struct job_pool job_pool;
+
+int jobs_cpu_count(void);
+job_pool *jobs_create(int threads); // 0 - one per cpu, 1 - jobs run inside jobs_add
+void jobs_add(job_pool *p, job_func func, void *arg);
+void jobs_wait(job_pool *p);        // caller helps with queued jobs, returns when all finished
+void jobs_free(job_pool *p);        // waits for jobs
+int jobs_threads(job_pool *p);
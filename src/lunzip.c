@@ -31,6 +31,64 @@ char *lvgOpenMap(const char *fname, size_t *size)
     return m;
 }
 
+static uint32_t zip_hash(const char *name, uint32_t len)
+{   // FNV-1a
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; i < len; i++)
+        h = (h ^ (uint8_t)name[i])*16777619u;
+    return h;
+}
+
+static int zip_build_index(zip_t *zip)
+{
+    zipEndRecord_t *er = zip->endRecord;
+    uint32_t i, num = er->numEntries, hash_size = 16;
+    if (er->centralDirectoryOffset > zip->size || er->centralDirectorySize > (zip->size - er->centralDirectoryOffset))
+        return -1;
+    while (hash_size < num*2)
+        hash_size *= 2;
+    zip->entries = (zipEntry_t *)malloc((num ? num : 1)*sizeof(zipEntry_t));
+    zip->hash_table = (int32_t *)malloc(hash_size*sizeof(int32_t));
+    memset(zip->hash_table, -1, hash_size*sizeof(int32_t));
+    zip->hash_mask = hash_size - 1;
+    zip->num_entries = 0;
+    const char *cd_end = zip->buf + er->centralDirectoryOffset + er->centralDirectorySize;
+    zipGlobalFileHeader_t *fh = (zipGlobalFileHeader_t *)(zip->buf + er->centralDirectoryOffset);
+    for (i = 0; i < num; i++)
+    {
+        if ((const char *)(fh + 1) > cd_end || fh->signature != 0x02014B50)
+            return -1;
+        const char *name = (const char *)(fh + 1);
+        if (name + fh->fileNameLength > cd_end || fh->relativeOffsetOflocalHeader >= zip->size)
+            return -1;
+        zipEntry_t *ze = zip->entries + i;
+        ze->name = name;
+        ze->name_len  = fh->fileNameLength;
+        ze->hash      = zip_hash(name, ze->name_len);
+        ze->local_ofs = fh->relativeOffsetOflocalHeader;
+        ze->size      = fh->uncompressedSize;
+        uint32_t h = ze->hash & zip->hash_mask;
+        while (zip->hash_table[h] >= 0)
+            h = (h + 1) & zip->hash_mask;
+        zip->hash_table[h] = i;
+        zip->num_entries++;
+        fh = (zipGlobalFileHeader_t *)(name + fh->fileNameLength + fh->extraFieldLength + fh->fileCommentLength);
+    }
+    return 0;
+}
+
+static void zip_free_index(zip_t *zip)
+{
+    if (zip->entries)
+        free(zip->entries);
+    if (zip->hash_table)
+        free(zip->hash_table);
+    zip->entries = 0;
+    zip->hash_table = 0;
+    zip->num_entries = 0;
+    zip->hash_mask = 0;
+}
+
 int lvgZipOpen(const char *m, size_t size, zip_t *zip)
 {
     if (!m || *(int32_t*)m != 0x04034B50)
@@ -48,6 +106,13 @@ int lvgZipOpen(const char *m, size_t size, zip_t *zip)
     zip->buf = m;
     zip->endRecord = er;
     zip->size = size;
+    if (zip_build_index(zip))
+    {
+        zip_free_index(zip);
+        zip->buf = 0;
+        zip->endRecord = 0;
+        goto error;
+    }
     return 0;
 error:
     return -1;
@@ -55,6 +120,7 @@ error:
 
 void lvgZipClose(zip_t *zip)
 {
+    zip_free_index(zip);
     if (zip->buf)
     {
         munmap((void*)zip->buf, zip->size);
@@ -64,21 +130,36 @@ void lvgZipClose(zip_t *zip)
 
 uint32_t lvgZipNameLocate(zip_t *zip, const char *fname)
 {
-    if (!zip || zip->endRecord->centralDirectoryOffset > zip->size)
+    if (!zip || !zip->num_entries)
         return -1;
-    size_t flen = strlen(fname);
-    zipGlobalFileHeader_t *fh = (zipGlobalFileHeader_t *)(zip->buf + zip->endRecord->centralDirectoryOffset);
-    for (int i = 0; i < zip->endRecord->numEntries; i++)
+    uint32_t flen = strlen(fname);
+    uint32_t hash = zip_hash(fname, flen);
+    for (uint32_t h = hash & zip->hash_mask; zip->hash_table[h] >= 0; h = (h + 1) & zip->hash_mask)
     {
-        if (fh->signature != 0x02014B50)
-            return -1;
-        if (fh->fileNameLength == flen && !strncmp((char *)(fh + 1), fname, fh->fileNameLength))
-            return fh->relativeOffsetOflocalHeader;
-        fh = (zipGlobalFileHeader_t *)((char *)(fh + 1) + fh->fileNameLength + fh->extraFieldLength + fh->fileCommentLength);
+        zipEntry_t *ze = zip->entries + zip->hash_table[h];
+        if (ze->hash == hash && ze->name_len == flen && !memcmp(ze->name, fname, flen))
+            return ze->local_ofs;
     }
     return -1;
 }
 
+uint32_t lvgZipGetNumFiles(zip_t *zip)
+{
+    return zip ? zip->num_entries : 0;
+}
+
+const char *lvgZipGetFileName(zip_t *zip, uint32_t idx, uint32_t *name_len, uint32_t *size)
+{   // returned name is not zero-terminated
+    if (!zip || idx >= zip->num_entries)
+        return 0;
+    zipEntry_t *ze = zip->entries + idx;
+    if (name_len)
+        *name_len = ze->name_len;
+    if (size)
+        *size = ze->size;
+    return ze->name;
+}
+
 char *lvgZipDecompress(zip_t *zip, uint32_t file_ofs, uint32_t *size)
 {
     zipLocalFileHeader_t *fh = (zipLocalFileHeader_t *)(zip->buf + file_ofs);
@@ -96,9 +177,454 @@ char *lvgZipDecompress(zip_t *zip, uint32_t file_ofs, uint32_t *size)
         }
         memcpy(u_data, c_data, fh->uncompressedSize);
     } else
-        stbi_zlib_decode_noheader_buffer(u_data, fh->uncompressedSize, c_data, fh->compressedSize);
+    {   // inflate straight from mapped archive, only output and inflate window are allocated
+        zipInflate_t s;
+        int ret = -1;
+        if (!lvgZipInflateInit(zip, file_ofs, &s, 0))
+        {
+            ret = lvgInflatePull(&s, u_data, fh->uncompressedSize);
+            lvgInflateFree(&s);
+        }
+        if (ret != (int)fh->uncompressedSize)
+        {
+            free(u_data);
+            return 0;
+        }
+    }
     u_data[fh->uncompressedSize] = 0; // automatic zero-terminate
     if (size)
         *size = fh->uncompressedSize;
     return u_data;
 }
+
+const char *lvgZipView(zip_t *zip, uint32_t file_ofs, uint32_t *size)
+{   // stored entries are returned in-place (not zero-terminated), deflated ones are decompressed
+    zipLocalFileHeader_t *fh = (zipLocalFileHeader_t *)(zip->buf + file_ofs);
+    if (fh->signature != 0x04034B50)
+        return 0;
+    if (0 != fh->compressionMethod)
+        return lvgZipDecompress(zip, file_ofs, size);
+    const char *data = (const char *)(fh + 1) + fh->fileNameLength + fh->extraFieldLength;
+    if (fh->compressedSize != fh->uncompressedSize || data + fh->uncompressedSize > zip->buf + zip->size)
+        return 0;
+    if (size)
+        *size = fh->uncompressedSize;
+    return data;
+}
+
+void lvgZipViewRelease(zip_t *zip, const char *buf)
+{
+    if (buf && (!zip->buf || buf < zip->buf || buf >= zip->buf + zip->size))
+        free((void *)buf);
+}
+
+int lvgZipInflateInit(zip_t *zip, uint32_t file_ofs, zipInflate_t *s, uint32_t *size)
+{   // stream deflated entry directly from archive, stored entries should use lvgZipView()
+    zipLocalFileHeader_t *fh = (zipLocalFileHeader_t *)(zip->buf + file_ofs);
+    if (fh->signature != 0x04034B50 || 8 != fh->compressionMethod)
+        return -1;
+    const char *c_data = (const char *)(fh + 1) + fh->fileNameLength + fh->extraFieldLength;
+    if (c_data + fh->compressedSize > zip->buf + zip->size || lvgInflateInit(s, 0))
+        return -1;
+    lvgInflateFeed(s, c_data, fh->compressedSize, 1);
+    if (size)
+        *size = fh->uncompressedSize;
+    return 0;
+}
+
+/* Streaming inflate (RFC 1951). Decoding only starts a block header or symbol when enough input is
+   buffered to finish it (or input is complete), so state only needs to be kept between symbols. */
+
+#define INFLATE_OUT_SIZE   (INFLATE_WINDOW*2)
+#define INFLATE_MAX_MATCH  258
+#define INFLATE_MAX_HEADER 600  // dynamic block header upper bound in bytes
+#define INFLATE_MAX_SYMBOL 48   // lit/len code + extra + dist code + extra in bits
+
+enum { INFLATE_ZLIB_HEADER, INFLATE_BLOCK, INFLATE_STORED, INFLATE_HUFFMAN, INFLATE_DONE, INFLATE_ERROR };
+
+static const uint16_t inflate_length_base[31] = {
+    3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258,0,0 };
+static const uint8_t inflate_length_extra[31] = {
+    0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0,0,0 };
+static const uint16_t inflate_dist_base[32] = {
+    1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577,0,0 };
+static const uint8_t inflate_dist_extra[32] = {
+    0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13,0,0 };
+
+static int inflate_build_huffman(zipHuffman_t *h, const uint8_t *sizelist, int num)
+{
+    int i, k = 0, code = 0, next_code[16], sizes[17];
+    memset(sizes, 0, sizeof(sizes));
+    memset(h->fast, 0, sizeof(h->fast));
+    for (i = 0; i < num; i++)
+        sizes[sizelist[i]]++;
+    sizes[0] = 0;
+    for (i = 1; i < 16; i++)
+    {
+        if (sizes[i] > (1 << i))
+            return -1;
+        next_code[i] = code;
+        h->firstcode[i] = code;
+        h->firstsymbol[i] = k;
+        code += sizes[i];
+        if (sizes[i] && (code - 1) >= (1 << i))
+            return -1;
+        h->maxcode[i] = code << (16 - i);
+        code <<= 1;
+        k += sizes[i];
+    }
+    h->maxcode[16] = 0x10000;
+    for (i = 0; i < num; i++)
+    {
+        int len = sizelist[i];
+        if (!len)
+            continue;
+        int c = next_code[len] - h->firstcode[len] + h->firstsymbol[len];
+        h->size[c]  = len;
+        h->value[c] = i;
+        if (len <= INFLATE_FAST_BITS)
+        {
+            int j, r = 0;
+            for (j = 0; j < len; j++)
+                r |= ((next_code[len] >> j) & 1) << (len - 1 - j);
+            for (j = r; j < (1 << INFLATE_FAST_BITS); j += (1 << len))
+                h->fast[j] = (len << 9) | i;
+        }
+        next_code[len]++;
+    }
+    return 0;
+}
+
+static inline void inflate_refill(zipInflate_t *s)
+{
+    while (s->num_bits <= 56 && s->in_pos < s->in_size)
+    {
+        s->bits |= (uint64_t)s->in[s->in_pos++] << s->num_bits;
+        s->num_bits += 8;
+    }
+}
+
+static inline uint32_t inflate_bits(zipInflate_t *s, int n)
+{
+    if (s->num_bits < n)
+    {
+        inflate_refill(s);
+        if (s->num_bits < n)
+        {   // reading past end of input gives zeros
+            s->overrun += n - s->num_bits;
+            s->num_bits = n;
+        }
+    }
+    uint32_t v = (uint32_t)(s->bits & ((1ull << n) - 1));
+    s->bits >>= n;
+    s->num_bits -= n;
+    return v;
+}
+
+static inline int inflate_have(zipInflate_t *s, int nbits)
+{
+    return s->last_input || (s->num_bits + (int64_t)(s->in_size - s->in_pos)*8) >= nbits;
+}
+
+static int inflate_decode(zipInflate_t *s, zipHuffman_t *h)
+{
+    if (s->num_bits < 16)
+        inflate_refill(s);
+    int b = h->fast[s->bits & ((1 << INFLATE_FAST_BITS) - 1)];
+    if (b)
+    {
+        int len = b >> 9;
+        if (len > s->num_bits)
+            s->overrun += len - s->num_bits, s->num_bits = len;
+        s->bits >>= len;
+        s->num_bits -= len;
+        return b & 511;
+    }
+    int i, k = 0, r = s->bits & 0xffff;
+    for (i = 0; i < 16; i++)
+        k |= ((r >> i) & 1) << (15 - i);
+    for (i = INFLATE_FAST_BITS + 1; k >= h->maxcode[i]; i++);
+    if (16 == i)
+        return -1;
+    b = (k >> (16 - i)) - h->firstcode[i] + h->firstsymbol[i];
+    if (b >= 288 || h->size[b] != i)
+        return -1;
+    if (i > s->num_bits)
+        s->overrun += i - s->num_bits, s->num_bits = i;
+    s->bits >>= i;
+    s->num_bits -= i;
+    return h->value[b];
+}
+
+static int inflate_block_header(zipInflate_t *s)
+{
+    static const uint8_t order[19] = { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
+    uint8_t lens[286 + 32 + 137], codelens[19];
+    int i, n;
+    s->final = inflate_bits(s, 1);
+    int type = inflate_bits(s, 2);
+    if (0 == type)
+    {
+        int align = s->num_bits & 7;
+        inflate_bits(s, align);
+        int len  = inflate_bits(s, 16);
+        int nlen = inflate_bits(s, 16);
+        if ((len ^ 0xffff) != nlen)
+            return -1;
+        s->stored_left = len;
+        s->state = INFLATE_STORED;
+        return 0;
+    } else if (1 == type)
+    {
+        for (i = 0; i < 288; i++)
+            lens[i] = i < 144 ? 8 : (i < 256 ? 9 : (i < 280 ? 7 : 8));
+        if (inflate_build_huffman(&s->lit, lens, 288))
+            return -1;
+        memset(lens, 5, 32);
+        if (inflate_build_huffman(&s->dist, lens, 32))
+            return -1;
+    } else if (2 == type)
+    {
+        zipHuffman_t *codes = &s->dist; // temporary, rebuilt below
+        int hlit  = inflate_bits(s, 5) + 257;
+        int hdist = inflate_bits(s, 5) + 1;
+        int hclen = inflate_bits(s, 4) + 4;
+        memset(codelens, 0, sizeof(codelens));
+        for (i = 0; i < hclen; i++)
+            codelens[order[i]] = inflate_bits(s, 3);
+        if (inflate_build_huffman(codes, codelens, 19))
+            return -1;
+        n = 0;
+        while (n < hlit + hdist)
+        {
+            int c = inflate_decode(s, codes);
+            if (c < 0 || c >= 19)
+                return -1;
+            if (c < 16)
+                lens[n++] = c;
+            else
+            {
+                int fill = 0;
+                if (16 == c)
+                {
+                    if (!n)
+                        return -1;
+                    c = inflate_bits(s, 2) + 3;
+                    fill = lens[n - 1];
+                } else if (17 == c)
+                    c = inflate_bits(s, 3) + 3;
+                else
+                    c = inflate_bits(s, 7) + 11;
+                if (hlit + hdist - n < c)
+                    return -1;
+                memset(lens + n, fill, c);
+                n += c;
+            }
+        }
+        if (inflate_build_huffman(&s->lit, lens, hlit) || inflate_build_huffman(&s->dist, lens + hlit, hdist))
+            return -1;
+    } else
+        return -1;
+    s->state = INFLATE_HUFFMAN;
+    return 0;
+}
+
+static void inflate_run(zipInflate_t *s)
+{   // decode until output window is full or more input is needed
+    for (;;)
+    {
+        uint32_t room = INFLATE_OUT_SIZE - s->out_pos;
+        if (s->overrun > 64)
+            s->state = INFLATE_ERROR;
+        if (INFLATE_ZLIB_HEADER == s->state)
+        {
+            if (!inflate_have(s, 16))
+                return;
+            int cmf = inflate_bits(s, 8), flg = inflate_bits(s, 8);
+            if ((cmf*256 + flg) % 31 || (flg & 32) || (cmf & 15) != 8)
+                s->state = INFLATE_ERROR;
+            else
+                s->state = INFLATE_BLOCK;
+        } else if (INFLATE_BLOCK == s->state)
+        {
+            if (!inflate_have(s, INFLATE_MAX_HEADER*8))
+                return;
+            if (inflate_block_header(s))
+                s->state = INFLATE_ERROR;
+        } else if (INFLATE_STORED == s->state)
+        {
+            if (!s->stored_left)
+            {
+                s->state = s->final ? INFLATE_DONE : INFLATE_BLOCK;
+                continue;
+            }
+            if (!room)
+                return;
+            while (s->num_bits >= 8 && s->stored_left && room)
+            {   // drain bytes already in bit buffer
+                s->out[s->out_pos++] = inflate_bits(s, 8);
+                s->stored_left--, room--;
+            }
+            uint32_t n = s->stored_left < room ? s->stored_left : room;
+            if (n > s->in_size - s->in_pos)
+                n = s->in_size - s->in_pos;
+            if (!n && s->stored_left && room)
+            {
+                if (s->last_input)
+                    s->state = INFLATE_ERROR;
+                return;
+            }
+            memcpy(s->out + s->out_pos, s->in + s->in_pos, n);
+            s->in_pos += n;
+            s->out_pos += n;
+            s->stored_left -= n;
+        } else if (INFLATE_HUFFMAN == s->state)
+        {
+            uint8_t *out = s->out, *pout = out + s->out_pos, *end = out + INFLATE_OUT_SIZE - INFLATE_MAX_MATCH;
+            while (pout <= end)
+            {
+                if (!inflate_have(s, INFLATE_MAX_SYMBOL))
+                    break;
+                if (s->overrun > 64)
+                {   // truncated input
+                    s->state = INFLATE_ERROR;
+                    break;
+                }
+                int c = inflate_decode(s, &s->lit);
+                if (c < 256)
+                {
+                    if (c < 0)
+                    {
+                        s->state = INFLATE_ERROR;
+                        break;
+                    }
+                    *pout++ = c;
+                    continue;
+                }
+                if (256 == c)
+                {
+                    s->state = s->final ? INFLATE_DONE : INFLATE_BLOCK;
+                    break;
+                }
+                c -= 257;
+                if (c >= 29)
+                {
+                    s->state = INFLATE_ERROR;
+                    break;
+                }
+                int len = inflate_length_base[c];
+                if (inflate_length_extra[c])
+                    len += inflate_bits(s, inflate_length_extra[c]);
+                c = inflate_decode(s, &s->dist);
+                if (c < 0 || c >= 30)
+                {
+                    s->state = INFLATE_ERROR;
+                    break;
+                }
+                int dist = inflate_dist_base[c];
+                if (inflate_dist_extra[c])
+                    dist += inflate_bits(s, inflate_dist_extra[c]);
+                if (pout - out < dist)
+                {
+                    s->state = INFLATE_ERROR;
+                    break;
+                }
+                const uint8_t *src = pout - dist;
+                if (1 == dist)
+                {
+                    memset(pout, *src, len);
+                    pout += len;
+                } else
+                    while (len--)
+                        *pout++ = *src++;
+            }
+            s->out_pos = pout - out;
+            if (INFLATE_HUFFMAN == s->state)
+                return;
+        } else
+            return;
+    }
+}
+
+int lvgInflateInit(zipInflate_t *s, int zlib_header)
+{
+    memset(s, 0, sizeof(*s));
+    s->out = (uint8_t *)malloc(INFLATE_OUT_SIZE);
+    if (!s->out)
+        return -1;
+    s->state = zlib_header ? INFLATE_ZLIB_HEADER : INFLATE_BLOCK;
+    return 0;
+}
+
+void lvgInflateFeed(zipInflate_t *s, const void *data, size_t size, int last)
+{   // data must stay valid until consumed, unconsumed tail is copied on next feed
+    size_t left = s->in_size - s->in_pos;
+    if (!left)
+    {
+        s->in = (const uint8_t *)data;
+        s->in_pos = 0;
+        s->in_size = size;
+    } else
+    {
+        if (s->in_buf_size < left + size)
+        {
+            uint8_t *buf = (uint8_t *)malloc(left + size);
+            memcpy(buf, s->in + s->in_pos, left);
+            if (s->in_buf)
+                free(s->in_buf);
+            s->in_buf = buf;
+            s->in_buf_size = left + size;
+        } else
+            memmove(s->in_buf, s->in + s->in_pos, left);
+        memcpy(s->in_buf + left, data, size);
+        s->in = s->in_buf;
+        s->in_pos = 0;
+        s->in_size = left + size;
+    }
+    s->last_input |= last;
+}
+
+int lvgInflatePull(zipInflate_t *s, void *out, size_t size)
+{   // returns number of bytes decoded, 0 if more input needed or stream finished, -1 on error
+    uint8_t *pout = (uint8_t *)out;
+    while (size)
+    {
+        uint32_t avail = s->out_pos - s->out_read;
+        if (!avail)
+        {
+            if (s->out_pos > INFLATE_OUT_SIZE - INFLATE_WINDOW/2)
+            {   // keep last INFLATE_WINDOW bytes as history
+                memmove(s->out, s->out + s->out_pos - INFLATE_WINDOW, INFLATE_WINDOW);
+                s->out_pos = s->out_read = INFLATE_WINDOW;
+            }
+            inflate_run(s);
+            avail = s->out_pos - s->out_read;
+            if (!avail)
+                break;
+        }
+        if (avail > size)
+            avail = size;
+        memcpy(pout, s->out + s->out_read, avail);
+        s->out_read += avail;
+        pout += avail;
+        size -= avail;
+    }
+    if (pout == (uint8_t *)out && INFLATE_ERROR == s->state)
+        return -1;
+    return pout - (uint8_t *)out;
+}
+
+int lvgInflateFinished(zipInflate_t *s)
+{
+    return INFLATE_DONE == s->state && s->out_read == s->out_pos;
+}
+
+void lvgInflateFree(zipInflate_t *s)
+{
+    if (s->in_buf)
+        free(s->in_buf);
+    if (s->out)
+        free(s->out);
+    s->in_buf = 0;
+    s->out = 0;
+}
@@ -53,15 +53,60 @@ typedef struct __attribute__((__packed__)) zipEndRecord_t
     uint16_t zipCommentLength;
 } zipEndRecord_t;
 
+typedef struct zipEntry_t
+{
+    const char *name;   // points into central directory, not zero-terminated
+    uint32_t hash, name_len, local_ofs, size;
+} zipEntry_t;
+
 typedef struct zip_t
 {
     const char *buf;
     zipEndRecord_t *endRecord;
     size_t size;
+    zipEntry_t *entries;
+    int32_t *hash_table;    // open addressing, entry index or -1
+    uint32_t num_entries, hash_mask;
 } zip_t;
 
+#define INFLATE_FAST_BITS 9
+#define INFLATE_WINDOW    (32*1024)
+
+typedef struct zipHuffman_t
+{
+    uint16_t fast[1 << INFLATE_FAST_BITS];
+    uint16_t firstcode[16];
+    int maxcode[17];
+    uint16_t firstsymbol[16];
+    uint8_t size[288];
+    uint16_t value[288];
+} zipHuffman_t;
+
+typedef struct zipInflate_t
+{   // incremental deflate decoder, input is referenced in-place when possible
+    const uint8_t *in;
+    uint8_t *in_buf;        // owned copy of unconsumed input, used when feeding in chunks
+    size_t in_pos, in_size, in_buf_size;
+    uint64_t bits;
+    int num_bits, overrun, state, final, last_input, stored_left;
+    zipHuffman_t lit, dist;
+    uint8_t *out;           // INFLATE_WINDOW history + decoded data not yet pulled
+    uint32_t out_pos, out_read;
+} zipInflate_t;
+
 char *lvgOpenMap(const char *fname, size_t *size);
 int lvgZipOpen(const char *m, size_t size, zip_t *zip);
 void lvgZipClose(zip_t *zip);
 uint32_t lvgZipNameLocate(zip_t *zip, const char *fname);
+uint32_t lvgZipGetNumFiles(zip_t *zip);
+const char *lvgZipGetFileName(zip_t *zip, uint32_t idx, uint32_t *name_len, uint32_t *size);
 char *lvgZipDecompress(zip_t *zip, uint32_t file_ofs, uint32_t *size);
+const char *lvgZipView(zip_t *zip, uint32_t file_ofs, uint32_t *size);
+void lvgZipViewRelease(zip_t *zip, const char *buf);
+int lvgZipInflateInit(zip_t *zip, uint32_t file_ofs, zipInflate_t *s, uint32_t *size);
+
+int lvgInflateInit(zipInflate_t *s, int zlib_header);
+void lvgInflateFeed(zipInflate_t *s, const void *data, size_t size, int last);
+int lvgInflatePull(zipInflate_t *s, void *out, size_t size);
+int lvgInflateFinished(zipInflate_t *s);
+void lvgInflateFree(zipInflate_t *s);
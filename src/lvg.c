@@ -10,6 +10,7 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <math.h>
+#include <inttypes.h>
 #ifdef __MINGW32__
 #include <windows/mman.h>
 #else
@@ -22,8 +23,15 @@
 
 #define STBI_NO_STDIO
 #include <stb_image.h>
+#if RENDER_SW
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+#endif
 #include <lvg.h>
+#include <profile.h>
+#include <jobs.h>
 #include <swf/avm1.h>
+#include <swf/adpcm.h>
 #include <scripting/scripting.h>
 
 #if ENABLE_VIDEO && VIDEO_FFMPEG
@@ -35,6 +43,9 @@ extern const render nvg_render;
 #if RENDER_NVPR
 extern const render nvpr_render;
 #endif
+#if RENDER_SW
+extern const render sw_render;
+#endif
 extern const render null_render;
 
 #if AUDIO_SDL
@@ -95,6 +106,29 @@ void lvgFree(void *buf)
     free(buf);
 }
 
+const char *lvgGetFileView(LVGEngine *e, const char *fname, uint32_t *size)
+{   // read-only, points into archive for stored files, must be released with lvgReleaseFileView()
+    uint32_t idx;
+    if ((idx = lvgZipNameLocate(&e->zip, fname)) != (int32_t)-1)
+        return lvgZipView(&e->zip, idx, size);
+    return lvgGetFileContents(e, fname, size);
+}
+
+void lvgReleaseFileView(LVGEngine *e, const char *buf)
+{
+    lvgZipViewRelease(&e->zip, buf);
+}
+
+int lvgGetNumFiles(LVGEngine *e)
+{
+    return lvgZipGetNumFiles(&e->zip);
+}
+
+const char *lvgGetFileName(LVGEngine *e, int idx, uint32_t *name_len)
+{
+    return lvgZipGetFileName(&e->zip, idx, name_len, 0);
+}
+
 void lvgViewport(LVGEngine *e, int width, int heigth)
 {
     e->render->begin_frame(e->render_obj, width, heigth, e->params.winWidth, e->params.winHeight, e->params.width, e->params.height);
@@ -102,15 +136,15 @@ void lvgViewport(LVGEngine *e, int width, int heigth)
 
 int lvgImageLoad(LVGEngine *e, const char *file)
 {
-    char *buf;
+    const char *buf;
     uint32_t size;
-    if (!(buf = lvgGetFileContents(e, file, &size)))
+    if (!(buf = lvgGetFileView(e, file, &size)))
     {
         printf("error: could not open file: %s\n", file);
         return 0;
     }
-    int image = lvgImageLoadBuf(e, (unsigned char *)buf, size);
-    free(buf);
+    int image = lvgImageLoadBuf(e, (const unsigned char *)buf, size);
+    lvgReleaseFileView(e, buf);
     return image;
 }
 
@@ -128,20 +162,8 @@ void lvgImageFree(LVGEngine *e, int image)
     e->render->free_image(e->render_obj, image);
 }
 
-LVGShapeCollection *lvgShapeLoad(LVGEngine *e, const char *file)
-{
-    char *buf;
-    double time = e->platform->get_time(e->platform_obj);
-    if (!(buf = lvgGetFileContents(e, file, 0)))
-    {
-        printf("error: could not open file: %s\n", file);
-        return 0;
-    }
-    double time2 = e->platform->get_time(e->platform_obj);
-    printf("zip time: %fs\n", time2 - time);
-    NSVGimage *image = nsvgParse(buf, "px", 96.0f);
-    free(buf);
-    // convert to LVGShapeCollection
+static LVGShapeCollection *lvgShapeFromImage(LVGEngine *e, NSVGimage *image)
+{   // convert to LVGShapeCollection
     int i;
     LVGShapeCollection *col = calloc(1, sizeof(LVGShapeCollection));
     NSVGshape *shape = image->shapes;
@@ -166,8 +188,30 @@ LVGShapeCollection *lvgShapeLoad(LVGEngine *e, const char *file)
         shape = shape->next;
         free(to_free);
     }
+    return col;
+}
+
+static double lvgGetTime(LVGEngine *e)
+{
+    return e->platform ? e->platform->get_time(e->platform_obj) : e->params.time;
+}
+
+LVGShapeCollection *lvgShapeLoad(LVGEngine *e, const char *file)
+{
+    char *buf;
+    double time = lvgGetTime(e);
+    if (!(buf = lvgGetFileContents(e, file, 0)))
+    {
+        printf("error: could not open file: %s\n", file);
+        return 0;
+    }
+    double time2 = lvgGetTime(e);
+    printf("zip time: %fs\n", time2 - time);
+    NSVGimage *image = nsvgParse(buf, "px", 96.0f);
+    free(buf);
+    LVGShapeCollection *col = lvgShapeFromImage(e, image);
 
-    time = e->platform->get_time(e->platform_obj);
+    time = lvgGetTime(e);
     printf("svg load time: %fs\n", time - time2);
     return col;
 }
@@ -180,9 +224,210 @@ void lvgShapeGetBounds(LVGShapeCollection *col, double *bounds)
     bounds[3] = col->bounds[3];
 }
 
+static void lvgDamageAdd(LVGEngine *e, LVGShapeCollection *shapecol, int image, int frame, const float *bounds, float pad, LVGColorTransform *cxform, float ratio, int blend_mode)
+{   // record drawn item with its bounds in pixels, null bounds - item may cover whole frame
+    if (e->num_draw_items >= e->max_draw_items)
+    {
+        e->max_draw_items = e->max_draw_items ? e->max_draw_items*2 : 256;
+        e->draw_items = realloc(e->draw_items, e->max_draw_items*sizeof(LVGDrawItem));
+    }
+    LVGDrawItem *it = e->draw_items + e->num_draw_items++;
+    memset(it, 0, sizeof(*it));
+    it->shape = shapecol;
+    it->image = image;
+    it->frame = frame;
+    it->ratio = ratio;
+    it->blend_mode = blend_mode;
+    if (cxform)
+        it->cxform = *cxform;
+    if (shapecol && shapecol->num_shapes)
+        it->color = shapecol->shapes[0].fill.color; // text sets glyph colors before draw
+    e->render->get_transform(e->render_obj, it->t);
+    if (!bounds)
+    {
+        it->bounds[0] = it->bounds[1] = INT_MIN/2;
+        it->bounds[2] = it->bounds[3] = INT_MAX/2;
+        return;
+    }
+    if (bounds[0] > bounds[2] || bounds[1] > bounds[3])
+        return;
+    Transform3x2 tr;
+    tr[0][0] = it->t[0]; tr[1][0] = it->t[1];
+    tr[0][1] = it->t[2]; tr[1][1] = it->t[3];
+    tr[0][2] = it->t[4]; tr[1][2] = it->t[5];
+    float x0 = FLT_MAX, y0 = FLT_MAX, x1 = -FLT_MAX, y1 = -FLT_MAX;
+    for (int i = 0; i < 4; i++)
+    {
+        float p[2] = { bounds[(i & 1) ? 2 : 0], bounds[(i & 2) ? 3 : 1] };
+        xform(p, tr, p);
+        x0 = fminf(x0, p[0]); y0 = fminf(y0, p[1]);
+        x1 = fmaxf(x1, p[0]); y1 = fmaxf(y1, p[1]);
+    }
+    // strokes and antialiasing go outside of geometry bounds
+    pad = pad*sqrtf(fmaxf(it->t[0]*it->t[0] + it->t[1]*it->t[1], it->t[2]*it->t[2] + it->t[3]*it->t[3])) + 2.0f;
+    if (!(x0 - pad > INT_MIN/2 && y0 - pad > INT_MIN/2 && x1 + pad < INT_MAX/2 && y1 + pad < INT_MAX/2))
+    {
+        it->bounds[0] = it->bounds[1] = INT_MIN/2;
+        it->bounds[2] = it->bounds[3] = INT_MAX/2;
+        return;
+    }
+    it->bounds[0] = (int)floorf(x0 - pad);
+    it->bounds[1] = (int)floorf(y0 - pad);
+    it->bounds[2] = (int)ceilf(x1 + pad);
+    it->bounds[3] = (int)ceilf(y1 + pad);
+}
+
+static void lvgDamageRect(LVGEngine *e, const int *r)
+{   // merge into overlapping rect, or into one that grows least when list is full
+    int i, best = -1;
+    int64_t best_growth = INT64_MAX;
+    if (r[0] >= r[2] || r[1] >= r[3])
+        return;
+    for (i = 0; i < e->num_damage; i++)
+    {
+        int *d = e->damage[i];
+        int u[4] = { r[0] < d[0] ? r[0] : d[0], r[1] < d[1] ? r[1] : d[1], r[2] > d[2] ? r[2] : d[2], r[3] > d[3] ? r[3] : d[3] };
+        int64_t growth = (int64_t)(u[2] - u[0])*(u[3] - u[1]) - (int64_t)(d[2] - d[0])*(d[3] - d[1]) - (int64_t)(r[2] - r[0])*(r[3] - r[1]);
+        if (growth < best_growth)
+        {
+            best_growth = growth;
+            best = i;
+        }
+    }
+    if (best < 0 || (best_growth > 0 && e->num_damage < LVG_MAX_DAMAGE))
+    {
+        memcpy(e->damage[e->num_damage++], r, sizeof(e->damage[0]));
+        return;
+    }
+    int *d = e->damage[best];
+    d[0] = r[0] < d[0] ? r[0] : d[0];
+    d[1] = r[1] < d[1] ? r[1] : d[1];
+    d[2] = r[2] > d[2] ? r[2] : d[2];
+    d[3] = r[3] > d[3] ? r[3] : d[3];
+}
+
+static void lvgDamageBegin(LVGEngine *e)
+{
+    LVGDrawItem *items = e->prev_items;
+    int max_items = e->max_prev_items;
+    e->prev_items = e->draw_items;
+    e->max_prev_items = e->max_draw_items;
+    e->num_prev_items = e->num_draw_items;
+    e->draw_items = items;
+    e->max_draw_items = max_items;
+    e->num_draw_items = 0;
+    e->b_damage_track = 1;
+}
+
+#define LVG_DAMAGE_LOOKAHEAD 8
+
+static void lvgDamageEnd(LVGEngine *e)
+{   // walk both frames in draw order: equal items keep their pixels, bounds of added, removed and changed items are damaged
+    LVGDrawItem *prev = e->prev_items, *cur = e->draw_items;
+    int i = 0, j = 0, k, n = e->num_prev_items, m = e->num_draw_items;
+    e->b_damage_track = 0;
+    e->num_damage = 0;
+    while (i < n || j < m)
+    {
+        if (i < n && j < m && !memcmp(prev + i, cur + j, sizeof(LVGDrawItem)))
+        {
+            i++, j++;
+            continue;
+        }
+        for (k = 1; k <= LVG_DAMAGE_LOOKAHEAD; k++)
+        {
+            if (j < m && i + k < n && !memcmp(prev + i + k, cur + j, sizeof(LVGDrawItem)))
+            {   // removed items
+                for (; k; k--)
+                    lvgDamageRect(e, prev[i++].bounds);
+                break;
+            }
+            if (i < n && j + k < m && !memcmp(prev + i, cur + j + k, sizeof(LVGDrawItem)))
+            {   // added items
+                for (; k; k--)
+                    lvgDamageRect(e, cur[j++].bounds);
+                break;
+            }
+        }
+        if (k <= LVG_DAMAGE_LOOKAHEAD)
+            continue;
+        if (i < n)
+            lvgDamageRect(e, prev[i++].bounds);
+        if (j < m)
+            lvgDamageRect(e, cur[j++].bounds);
+    }
+    if (e->b_profile_overlay)
+    {
+        int r[4] = { 0, 0, PROF_OVERLAY_W, PROF_OVERLAY_H };
+        lvgDamageRect(e, r);
+    }
+    e->render->set_damage(e->render_obj, e->damage[0], e->num_damage);
+}
+
+static void lvgDrawItem(LVGEngine *e, LVGDrawItem *it, float dx, float dy)
+{   // draw recorded item again, moved by dx, dy pixels
+    float t[6] = { it->t[0], it->t[1], it->t[2], it->t[3], it->t[4] + dx, it->t[5] + dy };
+    e->render->set_transform(e->render_obj, t, 1);
+    if (!it->shape)
+    {
+        e->render->render_image(e->render_obj, it->image);
+        return;
+    }
+    if (it->shape->num_shapes && it->shape->shapes[0].fill.color != it->color)
+        for (int j = 0; j < it->shape->num_shapes; j++)
+            it->shape->shapes[j].fill.color = it->color;
+    e->render->render_shape(e->render_obj, it->shape, &it->cxform, it->ratio, it->blend_mode);
+}
+
+#if defined(_TEST) && RENDER_SW
+static int lvgDamageCheck(LVGEngine *e, int width, int height)
+{   // draw items of last frame again without damage and bitmap cache, returns max channel difference with incremental frame
+    int w, h, i, ret = 0;
+    const unsigned char *fb = sw_get_framebuffer(e->render_obj, &w, &h);
+    unsigned char *inc = malloc(w*h*4 + 1);
+    memcpy(inc, fb, w*h*4);
+    e->render->begin_frame(e->render_obj, width, height, 0, 0, 0, 0);
+    for (i = 0; i < e->num_draw_items; i++)
+    {
+        LVGDrawItem *it = e->draw_items + i;
+        if (it->shape || LVG_CACHE_MARKER != it->frame)
+            lvgDrawItem(e, it, 0.0f, 0.0f);
+    }
+    e->render->end_frame(e->render_obj);
+    fb = sw_get_framebuffer(e->render_obj, &w, &h);
+    for (i = 0; i < w*h*4; i++)
+        ret = abs(inc[i] - fb[i]) > ret ? abs(inc[i] - fb[i]) : ret;
+    free(inc);
+    return ret;
+}
+#endif
+
 static void lvgShapeDrawCol(LVGEngine *e, LVGShapeCollection *shapecol, LVGColorTransform *cxform, float ratio, int blend_mode)
 {
-    e->render->render_shape(e->render_obj, shapecol, cxform, ratio, blend_mode);
+    if (e->b_damage_track || e->capture_depth)
+    {
+        float bounds[4], pad = 0.0f;
+        memcpy(bounds, shapecol->bounds, sizeof(bounds));
+        for (int i = 0; i < shapecol->num_shapes; i++)
+        {
+            NSVGshape *shape = shapecol->shapes + i, *shape2 = shapecol->morph ? shapecol->morph->shapes + i : 0;
+            float width = shape2 ? fmaxf(shape->strokeWidth, shape2->strokeWidth) : shape->strokeWidth;
+            if (NSVG_PAINT_NONE != shape->stroke.type)
+                pad = fmaxf(pad, width*0.5f*fmaxf(shape->miterLimit, 1.0f));
+        }
+        if (shapecol->morph)
+        {
+            float *b = shapecol->morph->bounds;
+            bounds[0] = fminf(bounds[0], b[0]); bounds[1] = fminf(bounds[1], b[1]);
+            bounds[2] = fmaxf(bounds[2], b[2]); bounds[3] = fmaxf(bounds[3], b[3]);
+        }
+        lvgDamageAdd(e, shapecol, 0, 0, bounds, pad, cxform, ratio, blend_mode);
+    }
+    if (!e->capture_depth)
+    {
+        PROF_SCOPE(PROF_SHAPE);
+        e->render->render_shape(e->render_obj, shapecol, cxform, ratio, blend_mode);
+    }
 }
 
 void lvgShapeDraw(LVGEngine *e, LVGShapeCollection *svg)
@@ -192,6 +437,7 @@ void lvgShapeDraw(LVGEngine *e, LVGShapeCollection *svg)
 
 int lvgVideoDecodeToFrame(LVGEngine *e, LVGVideo *video, int frame)
 {
+    PROF_SCOPE(PROF_VIDEO);
 #if ENABLE_VIDEO && VIDEO_FFMPEG
     if ((!frame || frame != video->cur_frame) && frame < video->num_frames)
     {
@@ -275,21 +521,286 @@ static void combine_cxform(LVGColorTransform *newcxform, LVGColorTransform *cxfo
     newcxform->mul[0] *= cxform->mul[0]; newcxform->mul[1] *= cxform->mul[1]; newcxform->mul[2] *= cxform->mul[2]; newcxform->mul[3] *= cxform->mul[3]*alpha;
 }
 
+static LVGGroupCache *lvgCacheFind(LVGEngine *e, LVGMovieClipGroupState *groupstate)
+{
+    int i;
+    for (i = 0; i < e->num_caches; i++)
+        if (e->caches[i].groupstate == groupstate)
+            return e->caches + i;
+    e->caches = realloc(e->caches, (e->num_caches + 1)*sizeof(LVGGroupCache));
+    LVGGroupCache *c = e->caches + e->num_caches++;
+    memset(c, 0, sizeof(*c));
+    c->groupstate = groupstate;
+    return c;
+}
+
+static void lvgCacheFreeImage(LVGEngine *e, LVGGroupCache *c)
+{
+    if (c->image)
+    {
+        e->render->free_image(e->render_obj, c->image);
+        e->cache_bytes -= (size_t)c->width*c->height*4;
+    }
+    c->image = c->valid = 0;
+}
+
+static int lvgCacheSameItem(const LVGDrawItem *it, const LVGDrawItem *cached, const float *t)
+{   // cached translation is relative to group, subpixel moves of whole group reuse image
+    return it->shape == cached->shape && it->image == cached->image && it->frame == cached->frame &&
+        it->color == cached->color && it->blend_mode == cached->blend_mode && it->ratio == cached->ratio &&
+        !memcmp(&it->cxform, &cached->cxform, sizeof(it->cxform)) && !memcmp(it->t, cached->t, 4*sizeof(float)) &&
+        fabsf(it->t[4] - t[4] - cached->t[4]) < 0.01f && fabsf(it->t[5] - t[5] - cached->t[5]) < 0.01f;
+}
+
+static void lvgCacheDrawImage(LVGEngine *e, LVGGroupCache *c, float *t)
+{   // image pixels are device pixels, follow group translation snapped to whole pixels
+    float it[6] = { 1.0f, 0.0f, 0.0f, 1.0f, c->x + roundf(t[4] - c->t[4]), c->y + roundf(t[5] - c->t[5]) };
+    e->render->set_transform(e->render_obj, it, 1);
+    e->render->render_image(e->render_obj, c->image);
+    e->render->set_transform(e->render_obj, t, 1);
+    e->cache_draws++;
+    if (e->b_damage_track)
+    {   // changes between cached and direct draw of same items must damage too
+        float bounds[4] = { 0.0f, 0.0f, c->width, c->height };
+        lvgDamageAdd(e, 0, c->image, LVG_CACHE_MARKER, bounds, 0.0f, 0, 0.0f, 0);
+    }
+}
+
+static void lvgCacheEvict(LVGEngine *e, LVGGroupCache *keep, size_t bytes)
+{   // free least recently used images until new one fits in budget
+    while (e->cache_bytes + bytes > LVG_CACHE_BUDGET)
+    {
+        LVGGroupCache *lru = 0;
+        for (int i = 0; i < e->num_caches; i++)
+        {
+            LVGGroupCache *c = e->caches + i;
+            if (c != keep && c->image && (!lru || c->last_used < lru->last_used))
+                lru = c;
+        }
+        if (!lru)
+            return;
+        lvgCacheFreeImage(e, lru);
+        e->cache_evictions++;
+    }
+}
+
+static void lvgCacheDraw(LVGEngine *e, LVGMovieClipGroupState *groupstate, float *t, int first, int forced)
+{   // group contents captured to draw_items from first: draw cached image, rasterize new one, or draw items directly
+    LVGDrawItem *items = e->draw_items + first;
+    LVGGroupCache *c = lvgCacheFind(e, groupstate);
+    int i, n = e->num_draw_items - first, shapes = 0, ok = n > 0;
+    int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+    int same = c->num_items == n && !memcmp(c->t, t, 4*sizeof(float));
+    for (i = 0; i < n && same; i++)
+        same = lvgCacheSameItem(items + i, c->items + i, t);
+    c->last_used = e->cache_frame;
+    if (same && c->valid)
+    {
+        e->cache_hits++;
+        lvgCacheDrawImage(e, c, t);
+        return;
+    }
+    if (!same)
+    {
+        c->items = realloc(c->items, (n ? n : 1)*sizeof(LVGDrawItem));
+        if (n)
+            memcpy(c->items, items, n*sizeof(LVGDrawItem));
+        for (i = 0; i < n; i++)
+        {
+            c->items[i].t[4] -= t[4];
+            c->items[i].t[5] -= t[5];
+        }
+        c->num_items = n;
+        c->valid = 0;
+    }
+    memcpy(c->t, t, sizeof(c->t));
+    for (i = 0; i < n; i++)
+    {   // only normal blending composes same way through intermediate image
+        LVGDrawItem *it = items + i;
+        ok &= it->blend_mode <= BLEND_LAYER && it->bounds[0] > INT_MIN/2 && it->bounds[2] < INT_MAX/2;
+        shapes += it->shape ? it->shape->num_shapes : 1;
+        if (it->bounds[0] >= it->bounds[2] || it->bounds[1] >= it->bounds[3])
+            continue;
+        x0 = it->bounds[0] < x0 ? it->bounds[0] : x0;
+        y0 = it->bounds[1] < y0 ? it->bounds[1] : y0;
+        x1 = it->bounds[2] > x1 ? it->bounds[2] : x1;
+        y1 = it->bounds[3] > y1 ? it->bounds[3] : y1;
+    }
+    // automatic cache only for complex groups that stayed same for a frame
+    ok &= x0 < x1 && y0 < y1 && (forced || (same && shapes >= LVG_CACHE_MIN_SHAPES));
+    int w = x1 - x0, h = y1 - y0;
+    size_t bytes = (size_t)w*h*4;
+    ok = ok && w <= 4096 && h <= 4096 && bytes <= LVG_CACHE_BUDGET/4;
+    if (ok && c->image && (c->width != w || c->height != h))
+        lvgCacheFreeImage(e, c);
+    if (ok && !c->image)
+    {
+        lvgCacheEvict(e, c, bytes);
+        if (e->cache_bytes + bytes <= LVG_CACHE_BUDGET && (c->image = e->render->cache_image(e->render_obj, w, h, 0, 0)))
+        {
+            c->width = w, c->height = h;
+            e->cache_bytes += bytes;
+        }
+    }
+    if (ok && c->image && e->render->begin_offscreen(e->render_obj, c->image, w, h))
+    {
+        for (i = 0; i < n; i++)
+            lvgDrawItem(e, items + i, -x0, -y0);
+        e->render->end_offscreen(e->render_obj);
+        c->x = x0, c->y = y0, c->valid = 1;
+        e->cache_misses++;
+        lvgCacheDrawImage(e, c, t);
+        return;
+    }
+    for (i = 0; i < n; i++)
+        lvgDrawItem(e, items + i, 0.0f, 0.0f);
+    e->render->set_transform(e->render_obj, t, 1);
+}
+
+static void lvgApplyDelta(LVGMovieClipGroupState *gs, LVGMovieClipFrame *frame)
+{
+    LVGObject *o = gs->objects;
+    int i, j, k, n = 0, added = 0;
+    if (frame->keyframe)
+    {
+        if (frame->num_objects > gs->max_objects)
+        {
+            gs->max_objects = frame->num_objects;
+            gs->objects = realloc(gs->objects, gs->max_objects*sizeof(LVGObject));
+        }
+        if (frame->num_objects)
+            memcpy(gs->objects, frame->objects, frame->num_objects*sizeof(LVGObject));
+        gs->num_objects = frame->num_objects;
+        return;
+    }
+    for (i = 0, j = 0; i < gs->num_objects; i++)
+    {   // drop removed depths and place flags of previous frame
+        while (j < frame->num_removed && frame->removed[j] < o[i].depth)
+            j++;
+        if (j < frame->num_removed && frame->removed[j] == o[i].depth)
+            continue;
+        o[n] = o[i];
+        o[n++].flags &= ~1;
+    }
+    for (i = 0, j = 0; i < frame->num_changes; i++)
+    {
+        while (j < n && o[j].depth < frame->changes[i].depth)
+            j++;
+        added += j == n || o[j].depth != frame->changes[i].depth;
+    }
+    if (n + added > gs->max_objects)
+    {
+        gs->max_objects = (n + added)*2;
+        o = gs->objects = realloc(gs->objects, gs->max_objects*sizeof(LVGObject));
+    }
+    i = n - 1, j = frame->num_changes - 1, k = n + added - 1;
+    while (j >= 0 && k >= 0)
+    {   // merge changes from the end, unchanged head stays in place
+        if (i >= 0 && o[i].depth > frame->changes[j].depth)
+            o[k--] = o[i--];
+        else
+        {
+            if (i >= 0 && o[i].depth == frame->changes[j].depth)
+                i--;
+            o[k--] = frame->changes[j--];
+        }
+    }
+    gs->num_objects = n + added;
+}
+
+static void lvgResolveFrame(LVGMovieClipGroup *group, LVGMovieClipGroupState *gs, int frame_num)
+{   // display list of frame: apply following deltas or seek from nearest keyframe
+    int f = frame_num;
+    if (gs->objects_frame == frame_num + 1)
+        return;
+    while (f > 0 && !group->frames[f].keyframe && f != gs->objects_frame)
+        f--;
+    for (; f <= frame_num; f++)
+        lvgApplyDelta(gs, group->frames + f);
+    gs->objects_frame = frame_num + 1;
+}
+
+#ifdef _TEST
+static void lvgBenchDisplayList(LVGMovieClip *clip)
+{   // stored deltas against full list per frame, seek from no resolved frame (gotoAndPlay) against playback
+    LVGMovieClipGroupState play, seek;
+    int64_t mem = 0, full = 0;
+    double seek_time = 0, max_seek = 0;
+    int i, f, frames = 0, mismatch = 0;
+    memset(&play, 0, sizeof(play));
+    memset(&seek, 0, sizeof(seek));
+    for (i = 0; i < clip->num_groups; i++)
+    {
+        LVGMovieClipGroup *group = clip->groups + i;
+        play.objects_frame = 0;
+        for (f = 0; f < group->num_frames; f++)
+        {
+            LVGMovieClipFrame *frame = group->frames + f;
+            struct timespec ts0, ts1;
+            mem += (frame->num_objects + frame->num_changes)*sizeof(LVGObject) + frame->num_removed*sizeof(int);
+            lvgResolveFrame(group, &play, f);
+            full += play.num_objects*sizeof(LVGObject);
+            seek.objects_frame = 0;
+            clock_gettime(CLOCK_MONOTONIC, &ts0);
+            lvgResolveFrame(group, &seek, f);
+            clock_gettime(CLOCK_MONOTONIC, &ts1);
+            double t = (ts1.tv_sec - ts0.tv_sec)*1e6 + (ts1.tv_nsec - ts0.tv_nsec)*1e-3;
+            seek_time += t;
+            max_seek = t > max_seek ? t : max_seek;
+            mismatch |= play.num_objects != seek.num_objects || (play.num_objects && memcmp(play.objects, seek.objects, play.num_objects*sizeof(LVGObject)));
+        }
+        frames += group->num_frames;
+    }
+    printf("bench: display list: groups %d, frames %d, memory %dKB, full lists %dKB, seek avg %.2fus, max seek %.2fus%s\n", clip->num_groups,
+        frames, (int)(mem >> 10), (int)(full >> 10), frames ? seek_time/frames : 0, max_seek, mismatch ? ", MISMATCH" : "");
+    free(play.objects);
+    free(seek.objects);
+}
+#endif
+
+#ifdef LVG_INTERPOLATE
+static LVGObject *lvgInterpolateTarget(LVGMovieClipGroup *group, int frame_num, LVGObject *o)
+{   // same object moving in next frame
+    if (frame_num + 1 >= group->num_frames)
+        return 0;
+    LVGMovieClipFrame *next = group->frames + frame_num + 1;
+    LVGObject *objects = next->keyframe ? next->objects : next->changes;
+    int n = next->keyframe ? next->num_objects : next->num_changes;
+    for (int k = 0; k < n; k++)
+    {
+        LVGObject *next_o = objects + k;
+        if (next_o->depth != o->depth)
+            continue;
+        if (next_o->id != o->id || (next_o->ratio == o->ratio && !memcmp(next_o->t, o->t, sizeof(o->t))))
+            return 0;
+        if (abs(next_o->ratio - o->ratio) > 16384 ||
+           (fabs(next_o->t[4] - o->t[4]) > 200) || (fabs(next_o->t[5] - o->t[5]) > 200) ||
+           (fabs(next_o->t[0] - o->t[0]) > 0.3) || (fabs(next_o->t[3] - o->t[3]) > 0.3))
+            return 0;
+        return next_o;
+    }
+    return 0;
+}
+#endif
+
 static void lvgClipDrawGroup(LVGEngine *e, LVGMovieClip *clip, LVGMovieClipGroupState *groupstate, LVGColorTransform *cxform, double r, int next_frame, int blend_mode)
 {
+    PROF_SCOPE(PROF_GROUP);
     LVGMovieClipGroup *group = clip->groups + groupstate->group_num;
     LVGMovieClipFrame *frame = group->frames + groupstate->cur_frame;
     if (!group->num_frames)
         return;
+    lvgResolveFrame(group, groupstate, groupstate->cur_frame);
+    LVGObject *objects = groupstate->objects;
     double alpha = 1.0;
-    int i, j, cur_frame = groupstate->cur_frame, visible = 1;
+    int i, j, cur_frame = groupstate->cur_frame, num_objects = groupstate->num_objects, visible = 1, cache_as_bitmap = 0, cache_first = -1;
     int do_action = (groupstate->cur_frame + 1) != groupstate->last_acton_frame;
     if (do_action)
     {
         groupstate->last_acton_frame = groupstate->cur_frame + 1;
-        for (i = 0; i < frame->num_objects; i++)
+        for (i = 0; i < num_objects; i++)
         {
-            LVGObject *o = frame->objects + i;
+            LVGObject *o = objects + i;
             if (LVG_OBJ_GROUP == o->type && (o->flags & 1))
             {   // sprite place position - reset sprite
                 LVGMovieClipGroupState *gs = clip->groupstates + o->id;
@@ -301,6 +812,8 @@ static void lvgClipDrawGroup(LVGEngine *e, LVGMovieClip *clip, LVGMovieClipGroup
                     if (gs->timers)
                         free(gs->timers);
                 }
+                if (gs->objects)
+                    free(gs->objects);
                 memset(gs, 0, sizeof(LVGMovieClipGroupState));
                 if (!e->b_no_actionscript)
                 {
@@ -332,15 +845,15 @@ static void lvgClipDrawGroup(LVGEngine *e, LVGMovieClip *clip, LVGMovieClipGroup
         g_properties[0].val.cls = groupstate->movieclip;        // this
         g_properties[1].val.cls = clip->groupstates->movieclip; // _root
         g_properties[2].val.cls = clip->groupstates->movieclip; // _level0
-        ASVal *val = find_class_member(clip->vm, THIS, "_totalframes"); SET_INT(val, group->num_frames);
-        val = find_class_member(clip->vm, THIS, "_framesloaded"); SET_INT(val, group->num_frames);
+        ASVal *val = find_class_member_atom(clip->vm, THIS, g_atoms[ATOM_TOTALFRAMES]); SET_INT(val, group->num_frames);
+        val = find_class_member_atom(clip->vm, THIS, g_atoms[ATOM_FRAMESLOADED]); SET_INT(val, group->num_frames);
 
         if (frame->obj_labels)
         {
             for (i = 0; i < frame->num_labels; i++)
             {
                 LVGObjectLabel *l = frame->obj_labels + i;
-                ASVal *v = create_local(clip->vm, THIS, l->name);
+                ASVal *v = create_local_atom(clip->vm, THIS, l->atom);
                 if (LVG_OBJ_GROUP == l->type)
                     SET_CLASS(v, (clip->groupstates + l->id)->movieclip)
                 else if (LVG_OBJ_BUTTON == l->type)
@@ -363,7 +876,7 @@ static void lvgClipDrawGroup(LVGEngine *e, LVGMovieClip *clip, LVGMovieClipGroup
         {   // call frame actions only once
             lvgExecuteActions(clip->vm, frame->actions, groupstate, 0);
         }
-        ASVal *onEnterFrame = find_class_member(clip->vm, THIS, "onEnterFrame");
+        ASVal *onEnterFrame = find_class_member_atom(clip->vm, THIS, g_atoms[ATOM_ONENTERFRAME]);
         if (onEnterFrame && onEnterFrame->str)
             lvgExecuteActions(clip->vm, (uint8_t*)onEnterFrame->str, groupstate, 1);
         for (i = 0; i < groupstate->num_timers; i++)
@@ -376,8 +889,9 @@ static void lvgClipDrawGroup(LVGEngine *e, LVGMovieClip *clip, LVGMovieClipGroup
                 lvgExecuteActions(clip->vm, t->func, groupstate, 1);
             }
         }
-        val = find_class_member(clip->vm, THIS, "_visible"); visible = to_int(val);
-        val = find_class_member(clip->vm, THIS, "_alpha"); alpha = to_double(clip->vm, val);
+        val = find_class_member_atom(clip->vm, THIS, g_atoms[ATOM_VISIBLE]); visible = to_int(val);
+        val = find_class_member_atom(clip->vm, THIS, g_atoms[ATOM_ALPHA]); alpha = to_double(clip->vm, val);
+        val = find_class_member_atom(clip->vm, THIS, g_atoms[ATOM_CACHEASBITMAP]); cache_as_bitmap = val && to_int(val);
         /*val = find_class_member(clip->vm, THIS, "blendMode");
         if (val && ASVAL_STRING == val->type)
         {
@@ -396,17 +910,23 @@ static void lvgClipDrawGroup(LVGEngine *e, LVGMovieClip *clip, LVGMovieClipGroup
         }*/
     }
 
-    float save_transform[6];
-    for (i = 0; i < frame->num_objects; i++)
+    float save_transform[6], group_t[6];
+    if (groupstate != clip->groupstates && visible && !e->capture_depth && e->render->begin_offscreen && (cache_as_bitmap || e->b_auto_cache))
+    {   // record contents instead of drawing, lvgCacheDraw decides how to draw them
+        e->render->get_transform(e->render_obj, group_t);
+        cache_first = e->num_draw_items;
+        e->capture_depth++;
+    }
+    for (i = 0; i < num_objects; i++)
     {
-        LVGObject *o = frame->objects + i;
+        LVGObject *o = objects + i;
         e->render->get_transform(e->render_obj, save_transform);
         int ratio = o->ratio;
 #ifdef LVG_INTERPOLATE
         float o_t[6];
-        if (e->b_interpolate && o->interpolate_obj)
+        LVGObject *inter = e->b_interpolate ? lvgInterpolateTarget(group, cur_frame, o) : 0;
+        if (inter)
         {
-            LVGObject *inter = o->interpolate_obj;
             double omr = 1.0 - r;
             ratio = round((double)ratio*omr + (double)inter->ratio*r);
             for (int idx = 0; idx < 6; idx++)
@@ -423,13 +943,22 @@ static void lvgClipDrawGroup(LVGEngine *e, LVGMovieClip *clip, LVGMovieClipGroup
         } else
         if (LVG_OBJ_IMAGE == o->type && visible)
         {
-            e->render->render_image(e->render_obj, clip->images[o->id]);
+            if (e->b_damage_track || e->capture_depth)
+                lvgDamageAdd(e, 0, clip->images[o->id], 0, 0, 0.0f, 0, 0.0f, 0);
+            if (!e->capture_depth)
+                e->render->render_image(e->render_obj, clip->images[o->id]);
         } else
         if (LVG_OBJ_VIDEO == o->type && visible)
         {
             LVGVideo *video = &clip->videos[o->id];
             lvgVideoDecodeToFrame(e, video, o->ratio);
-            e->render->render_image(e->render_obj, video->image);
+            if (e->b_damage_track || e->capture_depth)
+            {
+                float bounds[4] = { 0.0f, 0.0f, video->width, video->height };
+                lvgDamageAdd(e, 0, video->image, video->cur_frame, bounds, 0.0f, 0, 0.0f, 0);
+            }
+            if (!e->capture_depth)
+                e->render->render_image(e->render_obj, video->image);
         } else
         if (LVG_OBJ_GROUP == o->type)
         {
@@ -445,9 +974,9 @@ static void lvgClipDrawGroup(LVGEngine *e, LVGMovieClip *clip, LVGMovieClipGroup
             int btn_visible = 1;
             if (b->button_obj)
             {
-                ASVal *val = find_class_member(clip->vm, b->button_obj, "_alpha");
+                ASVal *val = find_class_member_atom(clip->vm, b->button_obj, g_atoms[ATOM_ALPHA]);
                 btn_alpha = to_double(clip->vm, val);
-                val = find_class_member(clip->vm, b->button_obj, "_visible");
+                val = find_class_member_atom(clip->vm, b->button_obj, g_atoms[ATOM_VISIBLE]);
                 btn_visible = to_int(val);
             }
             int mouse_hit = 0;
@@ -545,7 +1074,7 @@ static void lvgClipDrawGroup(LVGEngine *e, LVGMovieClip *clip, LVGMovieClipGroup
                 LVGFont *f = clip->fonts + str->font_id;
                 e->render->set_transform(e->render_obj, save_transform, 1);
 #ifdef LVG_INTERPOLATE
-                if (e->b_interpolate && o->interpolate_obj)
+                if (inter)
                     e->render->set_transform(e->render_obj, o_t, 0);
                 else
 #endif
@@ -572,11 +1101,18 @@ static void lvgClipDrawGroup(LVGEngine *e, LVGMovieClip *clip, LVGMovieClipGroup
         }
         e->render->set_transform(e->render_obj, save_transform, 1);
     }
+    if (cache_first >= 0)
+    {
+        e->capture_depth--;
+        lvgCacheDraw(e, groupstate, group_t, cache_first, cache_as_bitmap);
+        if (!e->b_damage_track)
+            e->num_draw_items = cache_first;
+    }
     if (next_frame && LVG_PLAYING == groupstate->play_state && cur_frame == groupstate->cur_frame/*not changed by as*/)
         groupstate->cur_frame = (groupstate->cur_frame + 1) % group->num_frames;
     if (!e->b_no_actionscript)
     {   // execute sprite events after frame advance
-        ASVal *_currentframe = find_class_member(clip->vm, groupstate->movieclip, "_currentframe");
+        ASVal *_currentframe = find_class_member_atom(clip->vm, groupstate->movieclip, g_atoms[ATOM_CURRENTFRAME]);
         SET_INT(_currentframe, groupstate->cur_frame + 1);
         if (!groupstate->events_initialized && group->events[0])
         {
@@ -605,30 +1141,49 @@ static void lvgClipDrawGroup(LVGEngine *e, LVGMovieClip *clip, LVGMovieClipGroup
     }
 }*/
 
+static void lvgClipJoin(LVGMovieClip *clip)
+{   // sounds are decoded by jobs while rest of clip loads
+    jobs_free(clip->jobs);
+    clip->jobs = 0;
+}
+
 void lvgClipDraw(LVGEngine *e, LVGMovieClip *clip)
 {
-#ifndef _TEST
-    int next_frame = 0;
-    double r, diff = e->params.time - clip->last_time;
-    if (diff > 1.0/clip->fps)
-    {
-        next_frame = 1;
-        clip->last_time += 1.0/clip->fps;
-        if ((e->params.time - clip->last_time) > 1.0/clip->fps)
-            r = 0.0;
-        else
-            r = 1.0;
-    } else
-        r = diff/(1.0/clip->fps);
-#else
     double r = 1;
     int next_frame = 1;
+    if (clip->jobs)
+        lvgClipJoin(clip);
+#ifndef _TEST
+    if (!e->out_file)
+    {   // realtime: follow clock, offline render advances one frame per call
+        double diff = e->params.time - clip->last_time;
+        next_frame = 0;
+        if (diff > 1.0/clip->fps)
+        {
+            next_frame = 1;
+            clip->last_time += 1.0/clip->fps;
+            if ((e->params.time - clip->last_time) > 1.0/clip->fps)
+                r = 0.0;
+            else
+                r = 1.0;
+        } else
+            r = diff/(1.0/clip->fps);
+    }
 #endif
     LVGColorTransform startcxform;
     memset(&startcxform, 0, sizeof(startcxform));
     startcxform.mul[0] = startcxform.mul[1] = startcxform.mul[2] = startcxform.mul[3] = 1.0f;
     //printf_frames(clip, clip->groupstates); printf("\n"); fflush(stdout);
+    int track = e->render->set_damage && !e->b_full_redraw;
+    e->cache_frame++;
+    e->cache_draws = 0;
+    if (track)
+        lvgDamageBegin(e);
     lvgClipDrawGroup(e, clip, clip->groupstates, &startcxform, r, next_frame, BLEND_REPLACE);
+    if (track)
+        lvgDamageEnd(e);
+    if (clip->vm)
+        lvgGCStep(clip->vm);
 }
 
 static void deletePaint(LVGEngine *e, NSVGpaint *paint)
@@ -642,6 +1197,8 @@ static void deletePaint(LVGEngine *e, NSVGpaint *paint)
 
 static void lvgFreeNSVGShape(LVGEngine *e, NSVGshape *shape)
 {
+    if (e->render->free_shape)
+        e->render->free_shape(e->render_obj, shape);
     NSVGpath *path = shape->paths;
     while (path)
     {
@@ -682,6 +1239,19 @@ void lvgClipFree(LVGEngine *e, LVGMovieClip *clip)
     int i, j;
     if (!clip)
         return;
+    lvgClipJoin(clip);
+    free(e->draw_items);
+    free(e->prev_items);
+    e->draw_items = e->prev_items = 0;
+    e->num_draw_items = e->max_draw_items = e->num_prev_items = e->max_prev_items = 0;
+    for (i = 0; i < e->num_caches; i++)
+    {
+        lvgCacheFreeImage(e, e->caches + i);
+        free(e->caches[i].items);
+    }
+    free(e->caches);
+    e->caches = 0;
+    e->num_caches = 0;
     for (i = 0; i < clip->num_shapes; i++)
     {
         lvgShapeFree_internal(e, clip->shapes + i);
@@ -698,6 +1268,10 @@ void lvgClipFree(LVGEngine *e, LVGMovieClip *clip)
             LVGMovieClipFrame *frame = group->frames + j;
             if (frame->objects)
                 free(frame->objects);
+            if (frame->changes)
+                free(frame->changes);
+            if (frame->removed)
+                free(frame->removed);
             if (frame->actions)
                 free(frame->actions);
             if (frame->obj_labels)
@@ -727,6 +1301,8 @@ void lvgClipFree(LVGEngine *e, LVGMovieClip *clip)
             free_instance(groupstate->movieclip);
         if (groupstate->timers)
             free(groupstate->timers);
+        if (groupstate->objects)
+            free(groupstate->objects);
     }
     for (i = 0; i < clip->num_fonts; i++)
     {
@@ -751,6 +1327,10 @@ void lvgClipFree(LVGEngine *e, LVGMovieClip *clip)
         LVGSound *sound = clip->sounds + i;
         if (sound->samples)
             free(sound->samples);
+        if (sound->mp3)
+            free(sound->mp3);
+        if (sound->mp3_frames)
+            free(sound->mp3_frames);
     }
     for (i = 0; i < clip->num_videos; i++)
     {
@@ -820,8 +1400,24 @@ void lvgScale(LVGEngine *e, float x, float y)
     e->render->set_transform(e->render_obj, t, 0);
 }
 
+static void lvgProfileOverlay(LVGEngine *e)
+{   // window pixels at top left, over everything drawn in frame
+    float t[6] = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+    unsigned char *rgba = malloc(PROF_OVERLAY_W*PROF_OVERLAY_H*4);
+    prof_overlay(rgba);
+    if (!e->profile_image)
+        e->profile_image = e->render->cache_image(e->render_obj, PROF_OVERLAY_W, PROF_OVERLAY_H, 0, rgba);
+    else
+        e->render->update_image(e->render_obj, e->profile_image, rgba);
+    free(rgba);
+    e->render->set_transform(e->render_obj, t, 1);
+    e->render->render_image(e->render_obj, e->profile_image);
+}
+
 void drawframe(LVGEngine *e)
 {
+    prof_next_frame();
+    PROF_SCOPE(PROF_FRAME);
     e->platform->pull_events(e->platform_obj);
     glViewport(0, 0, e->params.width, e->params.height);
     glClearColor(e->bgColor.r, e->bgColor.g, e->bgColor.b, 1.0f);
@@ -857,8 +1453,12 @@ change_fullscreen:
             if (SCRIPT_ENGINE.run_function(e->script, "onFrame"))
                 e->platform->set_exit(e->platform_obj);
     }
-
-    e->render->end_frame(e->render_obj);
+    if (e->b_profile_overlay)
+        lvgProfileOverlay(e);
+    {
+        PROF_SCOPE(PROF_END_FRAME);
+        e->render->end_frame(e->render_obj);
+    }
     e->platform->swap_buffers(e->platform_obj);
     e->params.last_mkeys = e->params.mkeys;
 }
@@ -901,32 +1501,44 @@ int lvg_init(LVGEngine *e)
     if (e->b_fullscreen)
         e->platform->fullscreen(e->platform_obj, e->b_fullscreen);
 
-#ifndef EMSCRIPTEN
-    e->render = &nvpr_render;
-    if (!e->render->init(&e->render_obj, e->platform))
+#if RENDER_SW
+    if (e->b_software_render)
+    {
+        e->render = &sw_render;
+        e->render->init(&e->render_obj, e->platform);
+        sw_set_threads(e->render_obj, e->sw_threads);
+    } else
 #endif
     {
-        e->render = &nvg_render;
+#ifndef EMSCRIPTEN
+        e->render = &nvpr_render;
         if (!e->render->init(&e->render_obj, e->platform))
+#endif
         {
-            printf("error: could not open render\n");
-            return -1;
+            e->render = &nvg_render;
+            if (!e->render->init(&e->render_obj, e->platform))
+            {
+                printf("error: could not open render\n");
+                return -1;
+            }
         }
     }
 
 #if ENABLE_AUDIO && AUDIO_SDL
     e->audio_render = &sdl_audio_render;
     if (!e->audio_render->init(&e->audio_render_obj, 44100, 2, 0, 0, 0))
-        e->audio_render = &null_audio_render;
-#else
-    e->audio_render = &null_audio_render;
 #endif
+    {
+        e->audio_render = &null_audio_render;
+        e->audio_render->init(&e->audio_render_obj, 44100, 2, 0, 0, 0);
+    }
     return 0;
 }
 
 void lvg_close(LVGEngine *e)
 {
     e->audio_render->release(e->audio_render_obj);
+    prof_release();
     if (e->clip)
         lvgClipFree(e, e->clip);
     e->render->release(e->render_obj);
@@ -977,6 +1589,184 @@ int lvg_open(LVGEngine *e, const char *file_name)
     return -1;
 }
 
+#ifdef _TEST
+static void lvgBenchClipLoad(LVGEngine *e, const char *file_name)
+{   // load time with serial and parallel sound decoding, decoded sounds must match loaded clip
+    int threads[2] = { 1, e->load_threads > 0 ? e->load_threads : jobs_cpu_count() }, i, j, n, mismatch = 0;
+    double load_time[2], join_time[2];
+    size_t size;
+    char *map = lvgOpenMap(file_name, &size);
+    if (!map)
+        return;
+    n = threads[1] > 1 ? 2 : 1;
+    e->b_benchmark = 0;
+    for (i = 0; i < n; i++)
+    {
+        struct timespec ts0, ts1, ts2;
+        e->load_threads = threads[i];
+        clock_gettime(CLOCK_MONOTONIC, &ts0);
+        LVGMovieClip *clip = lvgClipLoadBuf(e, map, size, 0);
+        clock_gettime(CLOCK_MONOTONIC, &ts1);
+        if (!clip)
+            break;
+        lvgClipJoin(clip);
+        clock_gettime(CLOCK_MONOTONIC, &ts2);
+        load_time[i] = (ts1.tv_sec - ts0.tv_sec)*1e3 + (ts1.tv_nsec - ts0.tv_nsec)*1e-6;
+        join_time[i] = (ts2.tv_sec - ts1.tv_sec)*1e3 + (ts2.tv_nsec - ts1.tv_nsec)*1e-6;
+        mismatch |= clip->num_sounds != e->clip->num_sounds;
+        for (j = 0; !mismatch && j < clip->num_sounds; j++)
+        {
+            LVGSound *a = clip->sounds + j, *b = e->clip->sounds + j;
+            mismatch |= a->num_samples != b->num_samples || a->channels != b->channels || !a->samples != !b->samples ||
+                (a->samples && !b->mp3 && memcmp(a->samples, b->samples, a->num_samples*a->channels*2));
+        }
+        lvgClipFree(e, clip);
+    }
+    e->b_benchmark = 1;
+    e->load_threads = threads[1];
+    munmap(map, size);
+    if (i < n)
+        return;
+    printf("bench: clip load: sound jobs %d", e->clip->num_sound_jobs);
+    for (i = 0; i < n; i++)
+        printf(", threads %d load %.2fms join %.2fms", threads[i], load_time[i], join_time[i]);
+    printf("%s\n", mismatch ? ", MISMATCH" : "");
+}
+#endif
+
+#if RENDER_SW
+static int lvg_out_pattern_ok(const char *p)
+{   // pattern is used as printf format: exactly one %d or %0Nd, %% for literal %
+    int conversions = 0;
+    for (; *p; p++)
+    {
+        if ('%' != *p || '%' == *++p)
+            continue;
+        while (*p >= '0' && *p <= '9')
+            p++;
+        if ('d' != *p)
+            return 0;
+        conversions++;
+    }
+    return 1 == conversions;
+}
+
+static int lvg_render_file(LVGEngine *e, const char *file_name)
+{   // offline render: fixed timestep, no platform, software render to png sequence or raw rgba
+    FILE *raw = 0;
+    if (!strcmp(e->out_file, "-"))
+    {   // keep stdout for pixels, messages go to stderr
+        fflush(stdout);
+        raw = fdopen(dup(1), "wb");
+        dup2(2, 1);
+        if (!raw)
+        {
+            printf("error: could not open output\n");
+            return -1;
+        }
+    }
+    e->render = &sw_render;
+    e->render->init(&e->render_obj, 0);
+    int threads = sw_set_threads(e->render_obj, e->sw_threads);
+    e->audio_render = &null_audio_render;
+    e->audio_render->init(&e->audio_render_obj, 44100, 2, 0, 0, 0);
+    if (lvg_open(e, file_name))
+    {
+        printf("error: could not open lvg or swf file\n");
+        return -1;
+    }
+    int vw = 800, vh = 600, frames = 1;
+    double fps = 60.0;
+    if (e->clip)
+    {
+        vw  = e->clip->bounds[2] - e->clip->bounds[0];
+        vh  = e->clip->bounds[3] - e->clip->bounds[1];
+        fps = e->clip->fps > 0 ? e->clip->fps : 12.0;
+        frames = e->clip->groups->num_frames > 1 ? e->clip->groups->num_frames : 1;
+    }
+    int first = e->out_first > 0 ? e->out_first : 0;
+    int last  = e->out_frames > 0 ? first + e->out_frames - 1 : frames - 1;
+    int width  = e->out_width  > 0 ? e->out_width  : vw;
+    int height = e->out_height > 0 ? e->out_height : vh;
+    e->params.winWidth  = e->params.width  = width;
+    e->params.winHeight = e->params.height = height;
+    unsigned char *rgba = malloc(width*height*4);
+    short *audio = malloc(((int)(44100/fps) + 1)*2*sizeof(short));
+    int64_t audio_pos = 0;
+    int bg[3] = { e->bgColor.r*255.0f + 0.5f, e->bgColor.g*255.0f + 0.5f, e->bgColor.b*255.0f + 0.5f };
+    struct timespec ts0, ts1;
+    clock_gettime(CLOCK_MONOTONIC, &ts0);
+    int ret = 0, written = 0;
+    double redrawn = 0;
+    for (int frame = 0; frame <= last && !ret; frame++)
+    {   // frames before range still play to keep clip state deterministic
+        prof_next_frame();
+        PROF_SCOPE(PROF_FRAME);
+        e->params.time = frame/fps;
+        e->render->begin_frame(e->render_obj, vw, vh, width, height, width, height);
+        if (e->clip)
+            lvgClipDraw(e, e->clip);
+#if ENABLE_SCRIPT
+        else if (e->script)
+            SCRIPT_ENGINE.run_function(e->script, "onFrame");
+#endif
+        if (e->b_profile_overlay)
+            lvgProfileOverlay(e);
+        {
+            PROF_SCOPE(PROF_END_FRAME);
+            e->render->end_frame(e->render_obj);
+        }
+        redrawn += sw_get_redrawn(e->render_obj);
+        int64_t audio_end = (int64_t)((frame + 1)*44100/fps);
+        e->audio_render->mix(e->audio_render_obj, audio, audio_end - audio_pos); // sounds advance with frames, output is dropped
+        audio_pos = audio_end;
+        if (frame < first)
+            continue;
+        int w, h;
+        const unsigned char *fb = sw_get_framebuffer(e->render_obj, &w, &h);
+        for (int i = 0; i < width*height; i++)
+        {   // framebuffer is premultiplied, put it over background
+            const unsigned char *s = fb + i*4;
+            unsigned char *d = rgba + i*4;
+            for (int c = 0; c < 3; c++)
+                d[c] = s[c] + (bg[c]*(255 - s[3]) + 127)/255;
+            d[3] = 255;
+        }
+        if (raw)
+            ret = fwrite(rgba, width*height*4, 1, raw) != 1;
+        else
+        {
+            char name[1024];
+            snprintf(name, sizeof(name), e->out_file, frame);
+            ret = !stbi_write_png(name, width, height, 4, rgba, width*4);
+        }
+        if (ret)
+            printf("error: could not write frame %d\n", frame);
+        else
+            written++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts1);
+    double time = (ts1.tv_sec - ts0.tv_sec) + (ts1.tv_nsec - ts0.tv_nsec)*1e-9;
+    printf("render: frames %d, written %d, %dx%d, %d threads, time %.2fs, %.2f frames/sec, redrawn %.1f%%\n", last + 1, written,
+        width, height, threads, time, time > 0 ? (last + 1)/time : 0, redrawn*100.0/(last + 1));
+    free(rgba);
+    free(audio);
+    if (raw)
+        fclose(raw);
+    e->audio_render->release(e->audio_render_obj);
+    prof_release();
+    if (e->clip)
+        lvgClipFree(e, e->clip);
+#if ENABLE_SCRIPT
+    if (e->script)
+        SCRIPT_ENGINE.release(e->script);
+#endif
+    e->render->release(e->render_obj);
+    lvgZipClose(&e->zip);
+    return ret ? -1 : 0;
+}
+#endif
+
 #ifdef __MINGW32__
 #include <windows.h>
 #include <shellapi.h>
@@ -1011,6 +1801,42 @@ int main(int argc, char **argv)
         case 'n': e->b_no_actionscript = 1; break;
         case 'f': e->b_fullscreen = 1; break;
         case 'i': e->b_interpolate = 1; break;
+        case 'b': e->b_benchmark = 1; break;
+        case 'o': e->b_no_avm1_optimize = 1; break;
+        case 's': e->b_software_render = 1; break;
+        case 't': e->sw_threads = atoi(argv[i] + 2); break;
+        case 'j': e->load_threads = atoi(argv[i] + 2); break;
+        case 'a': e->b_full_redraw = 1; break;
+        case 'c': e->b_auto_cache = 1; break;
+        case 'p': e->b_profile_overlay = 1; break;
+        case 'P': e->profile_file = argv[i] + 2; break;
+#if RENDER_SW
+        case 'w': sscanf(argv[i] + 2, "%dx%d", &e->out_width, &e->out_height); break;
+        case 'd':
+            e->out_file = argv[i] + 2;
+            if (strcmp(e->out_file, "-") && !lvg_out_pattern_ok(e->out_file))
+            {
+                printf("error: output name must have one %%d frame number, use %%%% for %%\n");
+                return 1;
+            }
+            break;
+        case 'r':
+        {
+            int last = -1;
+            if (sscanf(argv[i] + 2, "%d-%d", &e->out_first, &last) == 2 && last >= e->out_first)
+                e->out_frames = last - e->out_first + 1;
+            break;
+        }
+#endif
+#ifdef _TEST
+        case 'k':
+#if RENDER_SW
+            sw_bench_kernels();
+#endif
+            audio_bench_mixer();
+            adpcm_bench();
+            return 0;
+#endif
         default:
             printf("error: unrecognized option\n");
             return 1;
@@ -1027,17 +1853,168 @@ int main(int argc, char **argv)
 #endif
     } else
         file_name = argv[i];
+    if (e->b_profile_overlay || e->profile_file)
+        prof_init(e->profile_file);
+#if RENDER_SW
+    if (e->out_file && *e->out_file)
+        return lvg_render_file(e, file_name);
+#endif
 #ifdef _TEST
     e->render = &null_render;
+#if RENDER_SW
+    if (e->b_software_render)
+        e->render = &sw_render;
+#endif
+    e->render->init(&e->render_obj, 0);
+#if RENDER_SW
+    int sw_threads = e->b_software_render ? sw_set_threads(e->render_obj, e->sw_threads) : 0;
+#endif
     e->audio_render = &null_audio_render;
-    if (lvg_open(e, file_name))
+    e->audio_render->init(&e->audio_render_obj, 44100, 2, 0, 0, 0);
+    struct timespec ts0, ts1, ts2;
+    double raster_time = 0;
+    LVGShapeCollection *svg = 0;
+    int width = 0, height = 0;
+    size_t len = strlen(file_name);
+    if (len > 4 && !strcasecmp(file_name + len - 4, ".svg"))
+    {   // draw svg shape directly to benchmark rasterizer
+        size_t size;
+        char *buf, *map = lvgOpenMap(file_name, &size);
+        if (!map)
+        {
+            printf("error: could not open svg file\n");
+            return -1;
+        }
+        buf = malloc(size + 1);
+        memcpy(buf, map, size);
+        buf[size] = 0;
+        munmap(map, size);
+        NSVGimage *image = nsvgParse(buf, "px", 96.0f);
+        free(buf);
+        if (!image || !image->shapes)
+        {
+            printf("error: could not parse svg file\n");
+            return -1;
+        }
+        width  = image->width;
+        height = image->height;
+        if (width <= 1 || height <= 1)
+        {   // no document size, use extents of shapes
+            for (NSVGshape *shape = image->shapes; shape; shape = shape->next)
+            {
+                width  = shape->bounds[2] > width  ? ceilf(shape->bounds[2]) : width;
+                height = shape->bounds[3] > height ? ceilf(shape->bounds[3]) : height;
+            }
+        }
+        svg = lvgShapeFromImage(e, image);
+        free(image);
+    } else if (lvg_open(e, file_name))
     {
         printf("error: could not open swf file\n");
         return -1;
+    } else
+    {
+        width  = e->clip->bounds[2] - e->clip->bounds[0];
+        height = e->clip->bounds[3] - e->clip->bounds[1];
     }
+    double check_time = 0, redrawn = 0;
+    int damage_mismatch = 0, cache_error = 0;
+    clock_gettime(CLOCK_MONOTONIC, &ts0);
     for (int i = 0; i < 10; i++)
-        lvgClipDraw(e, e->clip);
+    {
+        prof_next_frame();
+        {
+            PROF_SCOPE(PROF_FRAME);
+            e->render->begin_frame(e->render_obj, width, height, 0, 0, 0, 0);
+            if (svg)
+                lvgShapeDraw(e, svg);
+            else
+                lvgClipDraw(e, e->clip);
+            clock_gettime(CLOCK_MONOTONIC, &ts2);
+            PROF_SCOPE(PROF_END_FRAME);
+            e->render->end_frame(e->render_obj);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &ts1);
+        raster_time += (ts1.tv_sec - ts2.tv_sec)*1e6 + (ts1.tv_nsec - ts2.tv_nsec)*1e-3;
+#if RENDER_SW
+        if (e->b_benchmark && sw_threads && !svg && !e->b_full_redraw)
+        {   // not timed: check incremental frame against full redraw
+            redrawn += sw_get_redrawn(e->render_obj);
+            int diff = lvgDamageCheck(e, width, height);
+            if (e->cache_draws) // cached images are resampled, only measure
+                cache_error = diff > cache_error ? diff : cache_error;
+            else
+                damage_mismatch |= diff != 0;
+            clock_gettime(CLOCK_MONOTONIC, &ts2);
+            check_time += (ts2.tv_sec - ts1.tv_sec)*1e6 + (ts2.tv_nsec - ts1.tv_nsec)*1e-3;
+        }
+#endif
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts1);
+#if RENDER_SW
+    if (e->b_benchmark && sw_threads)
+        printf("bench: render sw %d threads: frame time %.2fus, raster time %.2fus\n", sw_threads,
+            ((ts1.tv_sec - ts0.tv_sec)*1e6 + (ts1.tv_nsec - ts0.tv_nsec)*1e-3 - check_time)/10, raster_time/10);
+    if (e->b_benchmark && sw_threads && !svg && !e->b_full_redraw)
+        printf("bench: render damage: frames 10, redrawn %.1f%%%s\n", redrawn*10.0, damage_mismatch ? ", MISMATCH" : "");
+    if (e->b_benchmark && sw_threads && !svg && e->b_auto_cache)
+        printf("bench: render cache: hits %d, misses %d, evictions %d, memory %dKB, max error %d\n", (int)e->cache_hits,
+            (int)e->cache_misses, (int)e->cache_evictions, (int)(e->cache_bytes >> 10), cache_error);
+#endif
+    prof_next_frame();
+    if (e->b_benchmark && g_prof_enabled)
+    {   // self time of zones per frame
+        double self[PROF_NUM_ZONES] = { 0 };
+        int events = 0;
+        for (int i = 0; i < 10; i++)
+        {
+            const prof_frame *f = prof_get_frame(i);
+            for (int z = 0; z < PROF_NUM_ZONES; z++)
+                self[z] += f->self[z]*1e-4;
+            events += f->num_events;
+        }
+        printf("bench: profile: frames 10, events %d, clip group %.2fus, actions %.2fus, video %.2fus, render shape %.2fus, end frame %.2fus, other %.2fus\n",
+            events, self[PROF_GROUP], self[PROF_ACTIONS], self[PROF_VIDEO], self[PROF_SHAPE], self[PROF_END_FRAME], self[PROF_FRAME]);
+    }
+    prof_release();
+    if (svg)
+    {
+#if RENDER_NANOVG
+        if (e->b_benchmark && !e->b_software_render)
+        {
+            nvg_bench_cache(svg, width, height);
+            nvg_bench_batch(svg, width, height);
+        }
+#endif
+        lvgShapeFree(e, svg);
+        e->audio_render->release(e->audio_render_obj);
+        e->render->release(e->render_obj);
+        return 0;
+    }
+    if (e->b_benchmark)
+    {
+        lvgBenchDisplayList(e->clip);
+        audio_bench_mp3(e->clip->sounds, e->clip->num_sounds);
+        lvgBenchClipLoad(e, file_name);
+    }
+    if (e->b_benchmark && e->clip->vm)
+        printf("bench: avm1 lookups: frames 10, lookups %"PRId64", frame time %.2fus\n", e->clip->vm->num_lookups,
+            ((ts1.tv_sec - ts0.tv_sec)*1e6 + (ts1.tv_nsec - ts0.tv_nsec)*1e-3)/10);
+    if (e->b_benchmark && e->clip->vm && e->clip->vm->num_actions)
+        printf("bench: avm1 translate: actions %"PRId64", insns %"PRId64"\n", e->clip->vm->num_actions, e->clip->vm->num_insns);
+    if (e->b_benchmark && e->clip->vm && e->clip->vm->exec_time)
+        printf("bench: avm1 dispatch: ops %"PRId64", exec time %.2fus, ops/sec %.0f\n", e->clip->vm->num_ops,
+            e->clip->vm->exec_time*1e-3, e->clip->vm->num_ops*1e9/e->clip->vm->exec_time);
+    if (e->b_benchmark && e->clip->vm && e->clip->vm->strings.num_allocs)
+        printf("bench: avm1 strings: allocs %"PRId64", heap allocs %"PRId64"\n", e->clip->vm->strings.num_allocs,
+            e->clip->vm->strings.num_heap_allocs);
+    if (e->b_benchmark && e->clip->vm && e->clip->vm->gc.peak_objects)
+        printf("bench: avm1 gc: objects %d, peak objects %"PRId64", cycles %"PRId64", freed %"PRId64", pause time %.2fus, max pause %.2fus\n",
+            e->clip->vm->num_allocated_calsses, e->clip->vm->gc.peak_objects, e->clip->vm->gc.num_cycles, e->clip->vm->gc.num_freed,
+            e->clip->vm->gc.pause_time*1e-3, e->clip->vm->gc.max_pause*1e-3);
+    e->audio_render->release(e->audio_render_obj);
     lvgClipFree(e, e->clip);
+    e->render->release(e->render_obj);
     lvgZipClose(&e->zip);
     return 0;
 #else
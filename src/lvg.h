@@ -8,6 +8,31 @@
 #include <platform/platform.h>
 #include <lunzip.h>
 
+#define LVG_MAX_DAMAGE 16
+
+typedef struct LVGDrawItem
+{   // shape or image drawn by clip, compared with previous frame to find changed area
+    LVGShapeCollection *shape;
+    float t[6];
+    LVGColorTransform cxform;
+    float ratio;
+    int image, frame, blend_mode;
+    unsigned int color;
+    int bounds[4];          // pixels: x0, y0, x1, y1, exclusive end
+} LVGDrawItem;
+
+#define LVG_CACHE_BUDGET     (64 << 20) // bytes of group bitmap cache images
+#define LVG_CACHE_MIN_SHAPES 16         // automatic bitmap cache: groups drawing at least this many shapes
+#define LVG_CACHE_MARKER     -1         // LVGDrawItem frame: cache image drawn instead of group items before it
+
+typedef struct LVGGroupCache
+{   // group contents rasterized to image, drawn instead while contents and scale are unchanged
+    LVGMovieClipGroupState *groupstate;
+    LVGDrawItem *items;     // contents when last seen, translation relative to group
+    float t[6];             // group transform when last seen
+    int num_items, image, x, y, width, height, valid, last_used;
+} LVGGroupCache;
+
 struct LVGEngine
 {
     const render *render;
@@ -25,6 +50,20 @@ struct LVGEngine
     LVGColorf bgColor;
     platform_params params;
     double last_click;
-    int b_no_actionscript, b_fullscreen, b_interpolate, b_gles3;
+    int b_no_actionscript, b_fullscreen, b_interpolate, b_gles3, b_benchmark, b_no_avm1_optimize, b_software_render;
     int last_enter;
+    int sw_threads, load_threads;
+    const char *out_file;   // offline render: png name pattern or - for raw rgba to stdout
+    int out_width, out_height, out_first, out_frames;
+    // dirty rectangles: items drawn by current and previous clip frame, damaged area between them
+    LVGDrawItem *draw_items, *prev_items;
+    int num_draw_items, max_draw_items, num_prev_items, max_prev_items, b_damage_track, b_full_redraw;
+    int damage[LVG_MAX_DAMAGE][4], num_damage;
+    // group bitmap cache: cacheAsBitmap or automatic (b_auto_cache) for complex static groups
+    LVGGroupCache *caches;
+    int num_caches, b_auto_cache, capture_depth, cache_frame, cache_draws;
+    size_t cache_bytes;
+    int64_t cache_hits, cache_misses, cache_evictions;
+    const char *profile_file; // chrome trace json
+    int b_profile_overlay, profile_image;
 };
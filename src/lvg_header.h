@@ -37,25 +37,25 @@ typedef struct LVGColorTransform
 typedef struct LVGObjectLabel
 {
     const char *name;
+    struct ASAtom *atom;
     int type, id;
 } LVGObjectLabel;
 
 typedef struct LVGObject
 {
-#ifdef LVG_INTERPOLATE
-    struct LVGObject *interpolate_obj;
-#endif
     int id, type, depth, ratio, flags, blend_mode;
     float t[6];
     LVGColorTransform cxform;
 } LVGObject;
 
 typedef struct LVGMovieClipFrame
-{
-    LVGObject *objects;
+{   // display list is stored on keyframes, other frames store changes from previous frame, all sorted by depth
+    LVGObject *objects;         // keyframe: all objects
+    LVGObject *changes;         // objects placed or modified
+    int *removed;               // depths of removed objects
     unsigned char *actions;
     LVGObjectLabel *obj_labels; // to access objects from action script
-    int num_objects, num_labels;
+    int num_objects, num_changes, num_removed, num_labels, keyframe;
 } LVGMovieClipFrame;
 
 typedef struct LVGFrameLabel
@@ -91,7 +91,9 @@ typedef struct LVGMovieClipGroupState
 {
     LVGTimer *timers;     // action script timers
     void *movieclip;      // MovieClip class instance
+    LVGObject *objects;   // display list resolved for objects_frame - 1
     int group_num, cur_frame, last_acton_frame, play_state, num_timers, events_initialized;
+    int num_objects, max_objects, objects_frame;
 } LVGMovieClipGroupState;
 
 typedef struct LVGShapeCollection LVGShapeCollection;
@@ -135,8 +137,11 @@ typedef struct LVGText
 
 typedef struct LVGSound
 {
-    short *samples;
+    short *samples;           // 0 for mp3 sound
+    unsigned char *mp3;       // compressed frames, decoded while playing
+    uint32_t *mp3_frames;     // byte offset of each frame
     int num_samples, orig_rate, rate, channels;
+    int mp3_size, num_mp3_frames, mp3_frame_samples;
 } LVGSound;
 
 typedef struct LVGVideoFrame
@@ -202,9 +207,10 @@ typedef struct LVGMovieClip
     LVGVideo *videos;
     LVGButton *buttons;
     LVGActionCtx *vm;        // action script vm
+    struct job_pool *jobs;   // sound decoding started by load, joined before first draw
     float bounds[4];
     LVGColorf bgColor;
-    int num_shapes, num_images, num_groups, num_groupstates, num_fonts, num_texts, num_sounds, num_videos, num_buttons, as_version;
+    int num_shapes, num_images, num_groups, num_groupstates, num_fonts, num_texts, num_sounds, num_videos, num_buttons, as_version, num_sound_jobs;
     float fps;
     double last_time;
 } LVGMovieClip;
@@ -221,6 +227,10 @@ typedef struct LVGEngine LVGEngine;
 platform_params *lvgGetParams(LVGEngine *e);
 char *lvgGetFileContents(LVGEngine *e, const char *fname, uint32_t *size);
 void lvgFree(void *buf);
+const char *lvgGetFileView(LVGEngine *e, const char *fname, uint32_t *size);
+void lvgReleaseFileView(LVGEngine *e, const char *buf);
+int lvgGetNumFiles(LVGEngine *e);
+const char *lvgGetFileName(LVGEngine *e, int idx, uint32_t *name_len);
 void lvgTranslate(LVGEngine *e, float x, float y);
 void lvgScale(LVGEngine *e, float x, float y);
 void lvgViewport(LVGEngine *e, int width, int heigth);
@@ -252,12 +262,14 @@ void lvgClipFree(LVGEngine *e, LVGMovieClip *clip);
 int lvgStartAudio(int samplerate, int channels, int format, int buffer, int is_capture, void (*callback)(void *userdata, char *stream, int len), void *userdata);
 short *lvgLoadMP3(LVGEngine *e, const char *file_name, int *rate, int *channels, int *num_samples);
 short *lvgLoadMP3Buf(const unsigned char *buf, uint32_t buf_size, int *rate, int *channels, int *nsamples);
+int lvgLoadMP3Sound(LVGSound *sound, unsigned char *buf, uint32_t buf_size); // takes malloced buf
 void lvgPlaySound(LVGEngine *e, LVGSound *sound, int flags, int start_sample, int end_sample, int loops);
 void lvgStopAudio(LVGEngine *e);
 // action block begins with 32bit size, functions begins with 16bit size
 void lvgExecuteActions(LVGActionCtx *ctx, uint8_t *actions, LVGMovieClipGroupState *groupstate, int is_function);
 void lvgInitVM(LVGActionCtx *ctx, LVGEngine *e, LVGMovieClip *clip);
 void lvgFreeVM(LVGActionCtx *ctx);
+void lvgGCStep(LVGActionCtx *ctx); // bounded incremental garbage collection work, called once per frame
 
 extern LVGColorf g_bgColor;
 
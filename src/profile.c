@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <profile.h>
+
+typedef struct prof_event
+{
+    uint64_t start, end, self;
+    int zone, depth;
+} prof_event;
+
+typedef struct prof_thread
+{   // written only by owner thread, head is published for prof_next_frame
+    prof_event events[PROF_MAX_EVENTS];
+    uint32_t open[PROF_MAX_DEPTH];
+    uint64_t child[PROF_MAX_DEPTH];
+    uint32_t next, head, flushed;
+    int depth, tid;
+    struct prof_thread *link;
+} prof_thread;
+
+static const char *g_zone_names[PROF_NUM_ZONES] = { "frame", "clip group", "actions", "video decode", "render shape", "end frame", "audio" };
+static const char *g_zone_labels[PROF_NUM_ZONES] = { "FRAME", "CLIP", "AS", "VIDEO", "SHAPE", "FLUSH", "AUDIO" };
+static const unsigned char g_zone_colors[PROF_NUM_ZONES][3] =
+{
+    { 140, 140, 140 }, { 80, 200, 80 }, { 240, 150, 40 }, { 180, 90, 220 }, { 70, 130, 240 }, { 230, 60, 60 }, { 230, 220, 60 }
+};
+
+int g_prof_enabled;
+static __thread prof_thread *t_thread;
+static prof_thread *g_threads;
+static int g_num_threads;
+static prof_frame g_frames[PROF_MAX_FRAMES];
+static int64_t g_num_frames;
+static uint64_t g_time0, g_frame_start;
+static int g_started;
+static FILE *g_trace;
+static int64_t g_trace_events;
+
+static uint64_t prof_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+void prof_init(const char *trace_file)
+{
+    g_time0 = g_frame_start = prof_time();
+    if (trace_file && !(g_trace = fopen(trace_file, "w")))
+        printf("error: could not open trace file %s\n", trace_file);
+    if (g_trace)
+        fprintf(g_trace, "{\"traceEvents\":[\n");
+    g_prof_enabled = 1;
+}
+
+void prof_release(void)
+{   // other threads must be stopped
+    prof_next_frame();
+    g_prof_enabled = 0;
+    if (g_trace)
+    {
+        fprintf(g_trace, "\n]}\n");
+        fclose(g_trace);
+        g_trace = 0;
+    }
+    while (g_threads)
+    {
+        prof_thread *t = g_threads;
+        g_threads = t->link;
+        free(t);
+    }
+    t_thread = 0;
+    g_started = 0;
+    g_num_frames = 0;
+}
+
+static prof_thread *prof_thread_init(void)
+{
+    prof_thread *t = calloc(1, sizeof(prof_thread));
+    t->tid = __sync_add_and_fetch(&g_num_threads, 1);
+    do
+        t->link = g_threads;
+    while (!__sync_bool_compare_and_swap(&g_threads, t->link, t));
+    return t_thread = t;
+}
+
+int prof_begin(int zone)
+{
+    prof_thread *t = t_thread ? t_thread : prof_thread_init();
+    if (t->depth >= PROF_MAX_DEPTH)
+        return -1;
+    prof_event *ev = t->events + t->next % PROF_MAX_EVENTS;
+    ev->zone  = zone;
+    ev->depth = t->depth;
+    ev->start = prof_time();
+    t->open[t->depth]  = t->next++;
+    t->child[t->depth] = 0;
+    return t->depth++;
+}
+
+void prof_end(int *scope)
+{
+    int d = *scope;
+    if (d < 0)
+        return;
+    prof_thread *t = t_thread;
+    prof_event *ev = t->events + t->open[d] % PROF_MAX_EVENTS;
+    ev->end  = prof_time();
+    ev->self = ev->end - ev->start - t->child[d];
+    t->depth = d;
+    if (d)
+        t->child[d - 1] += ev->end - ev->start;
+    // events are published in start order, so nested ones wait for outermost
+    __atomic_store_n(&t->head, d ? t->open[0] : t->next, __ATOMIC_RELEASE);
+}
+
+void prof_next_frame(void)
+{   // summarize events finished since previous call, append them to trace
+    if (!g_prof_enabled)
+        return;
+    if (!g_started)
+    {   // loading is not a frame
+        g_started = 1;
+        g_frame_start = prof_time();
+        return;
+    }
+    prof_frame *f = g_frames + g_num_frames++ % PROF_MAX_FRAMES;
+    memset(f, 0, sizeof(*f));
+    f->start = g_frame_start;
+    f->end = g_frame_start = prof_time();
+    for (prof_thread *t = __atomic_load_n(&g_threads, __ATOMIC_ACQUIRE); t; t = t->link)
+    {
+        uint32_t head = __atomic_load_n(&t->head, __ATOMIC_ACQUIRE), i = t->flushed;
+        if (head - i > PROF_MAX_EVENTS) // ring overrun, oldest events are lost
+            i = head - PROF_MAX_EVENTS;
+        for (; i != head; i++)
+        {
+            prof_event *ev = t->events + i % PROF_MAX_EVENTS;
+            f->self[ev->zone] += ev->self;
+            f->num_events++;
+            if (g_trace)
+                fprintf(g_trace, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}", g_trace_events++ ? ",\n" : "",
+                    g_zone_names[ev->zone], (ev->start - g_time0)*1e-3, (ev->end - ev->start)*1e-3, t->tid);
+        }
+        t->flushed = head;
+    }
+}
+
+const prof_frame *prof_get_frame(int back)
+{
+    if (back < 0 || back >= g_num_frames || back >= PROF_MAX_FRAMES)
+        return 0;
+    return g_frames + (g_num_frames - 1 - back) % PROF_MAX_FRAMES;
+}
+
+static void overlay_rect(unsigned char *rgba, int x0, int y0, int x1, int y1, const unsigned char *c, int a)
+{
+    x0 = x0 < 0 ? 0 : x0; y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 > PROF_OVERLAY_W ? PROF_OVERLAY_W : x1; y1 = y1 > PROF_OVERLAY_H ? PROF_OVERLAY_H : y1;
+    for (int y = y0; y < y1; y++)
+        for (int x = x0; x < x1; x++)
+        {
+            unsigned char *p = rgba + (y*PROF_OVERLAY_W + x)*4;
+            p[0] = c[0]; p[1] = c[1]; p[2] = c[2]; p[3] = a;
+        }
+}
+
+static int overlay_text(unsigned char *rgba, int x, int y, int scale, const char *str)
+{   // 3x5 font: digits, capitals and dot
+    static const uint16_t font[] =
+    {
+        0x7b6f, 0x2c97, 0x73e7, 0x73cf, 0x5bc9, 0x79cf, 0x79ef, 0x7249, 0x7bef, 0x7bcf, 0x2bed, 0x6bae, 0x3923, 0x6b6e, 0x79a7, 0x79a4,
+        0x396b, 0x5bed, 0x7497, 0x126a, 0x5bad, 0x4927, 0x5fed, 0x6b6d, 0x2b6a, 0x6ba4, 0x2b73, 0x6bad, 0x388e, 0x7492, 0x5b6f, 0x5b6a,
+        0x5bfd, 0x5aad, 0x5a92, 0x72a7, 0x0002
+    };
+    static const unsigned char white[3] = { 255, 255, 255 };
+    for (; *str; str++, x += 4*scale)
+    {
+        int c = *str, g;
+        if (c >= '0' && c <= '9')
+            g = font[c - '0'];
+        else if (c >= 'A' && c <= 'Z')
+            g = font[c - 'A' + 10];
+        else if ('.' == c)
+            g = font[36];
+        else
+            continue;
+        for (int i = 0; i < 15; i++)
+            if (g & (0x4000 >> i))
+                overlay_rect(rgba, x + (i % 3)*scale, y + (i/3)*scale, x + (i % 3 + 1)*scale, y + (i/3 + 1)*scale, white, 255);
+    }
+    return x;
+}
+
+void prof_overlay(unsigned char *rgba)
+{   // frame times of last frames stacked by zone, 0.5ms per pixel
+    static const unsigned char black[3] = { 0, 0, 0 }, white[3] = { 255, 255, 255 };
+    const int graph_y = 16, graph_h = 64;
+    char buf[64];
+    int i, z, n = 0;
+    double total = 0;
+    overlay_rect(rgba, 0, 0, PROF_OVERLAY_W, PROF_OVERLAY_H, black, 170);
+    for (i = 0; i < PROF_MAX_FRAMES; i++)
+    {
+        const prof_frame *f = prof_get_frame(i);
+        if (!f)
+            break;
+        int x = PROF_OVERLAY_W - (i + 1)*2, y = graph_y + graph_h;
+        for (z = 0; z < PROF_NUM_ZONES; z++)
+        {
+            int h = (int)(f->self[z]/500000);
+            h = y - h < graph_y ? y - graph_y : h;
+            overlay_rect(rgba, x, y - h, x + 2, y, g_zone_colors[z], 255);
+            y -= h;
+        }
+        total += (f->end - f->start)*1e-6;
+        n++;
+    }
+    for (i = 0; i < PROF_OVERLAY_W; i += 4) // 60 fps frame budget
+        overlay_rect(rgba, i, graph_y + graph_h - 33, i + 2, graph_y + graph_h - 32, white, 120);
+    const prof_frame *last = prof_get_frame(0);
+    snprintf(buf, sizeof(buf), "FRAME %.1f MS AVG %.1f MS", last ? (last->end - last->start)*1e-6 : 0.0, n ? total/n : 0.0);
+    overlay_text(rgba, 2, 2, 2, buf);
+    int x = 2;
+    for (z = 0; z < PROF_NUM_ZONES; z++)
+    {
+        overlay_rect(rgba, x, graph_y + graph_h + 6, x + 5, graph_y + graph_h + 11, g_zone_colors[z], 255);
+        x = overlay_text(rgba, x + 7, graph_y + graph_h + 6, 1, g_zone_labels[z]) + 4;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+
+// scoped timers: each thread records events to own ring buffer, frame summaries go to ring of frames
+enum PROF_ZONE { PROF_FRAME = 0, PROF_GROUP, PROF_ACTIONS, PROF_VIDEO, PROF_SHAPE, PROF_END_FRAME, PROF_AUDIO, PROF_NUM_ZONES };
+
+#define PROF_MAX_EVENTS 65536 // per thread, must hold events of one frame
+#define PROF_MAX_FRAMES 128
+#define PROF_MAX_DEPTH  64
+#define PROF_OVERLAY_W  (PROF_MAX_FRAMES*2)
+#define PROF_OVERLAY_H  96
+
+typedef struct prof_frame
+{
+    uint64_t start, end;            // ns
+    uint64_t self[PROF_NUM_ZONES];  // time in zone without nested zones, all threads
+    int num_events;
+} prof_frame;
+
+extern int g_prof_enabled;
+
+void prof_init(const char *trace_file);
+void prof_release(void);
+int prof_begin(int zone);
+void prof_end(int *scope);
+void prof_next_frame(void);
+const prof_frame *prof_get_frame(int back); // 0 - last finished frame
+void prof_overlay(unsigned char *rgba);     // PROF_OVERLAY_W x PROF_OVERLAY_H
+
+#define PROF_SCOPE(zone) __attribute__((cleanup(prof_end))) int prof_scope_##zone = g_prof_enabled ? prof_begin(zone) : -1
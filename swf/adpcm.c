@@ -1,5 +1,11 @@
 #include <stdint.h>
+#include <string.h>
 #include <rfxswf.h>
+#include "adpcm.h"
+#if defined(__x86_64__) || defined(__SSE2__)
+#define ADPCM_X86 1
+#include <emmintrin.h>
+#endif
 
 static const char index_tables[4][16] = {
     { -1, 2 },
@@ -110,3 +116,242 @@ int adpcm_decode(TAG *tag, int buf_size, int channels, int16_t *samples, int max
     return samples_num;
 }
 
+
+int adpcm_samples(const uint8_t *buf, int buf_size, int channels)
+{   // number of samples adpcm_decode returns for buffer, without decoding
+    int size = buf_size*8, bitpos = 2, samples_num = 0;
+    if (buf_size <= 0)
+        return 0;
+    int bits = ((buf[0] >> 6) + 2)*channels;
+    while (bitpos <= (size - 22*channels))
+    {
+        bitpos += 22*channels;
+        int count = bitpos <= (size - bits) ? (size - bits - bitpos)/bits + 1 : 0;
+        count = count < 4095 ? count : 4095;
+        bitpos += count*bits;
+        samples_num += (count + 1)*channels;
+    }
+    return samples_num;
+}
+
+typedef struct adpcm_reader
+{   // msb first bit reader with 64-bit cache, bits past end of buffer read as zeros
+    const uint8_t *buf;
+    uint64_t cache;
+    int pos, size, bits;
+} adpcm_reader;
+
+static inline void adpcm_refill(adpcm_reader *r)
+{
+    if (r->pos + 8 <= r->size)
+    {
+        uint64_t v;
+        memcpy(&v, r->buf + r->pos, 8);
+        r->cache |= __builtin_bswap64(v) >> r->bits;
+        r->pos  += (63 - r->bits) >> 3;
+        r->bits |= 56;
+        return;
+    }
+    for (; r->bits <= 56; r->bits += 8)
+        r->cache |= (uint64_t)(r->pos < r->size ? r->buf[r->pos++] : 0) << (56 - r->bits);
+}
+
+static inline uint32_t adpcm_get(adpcm_reader *r, int n)
+{   // n <= 32
+    if (r->bits < n)
+        adpcm_refill(r);
+    uint32_t v = r->cache >> (64 - n);
+    r->cache <<= n;
+    r->bits -= n;
+    return v;
+}
+
+static void adpcm_seek(adpcm_reader *r, const uint8_t *buf, int size, int bitpos)
+{
+    r->buf = buf;
+    r->size = size;
+    r->pos = bitpos >> 3;
+    r->cache = 0;
+    r->bits = 0;
+    adpcm_refill(r);
+    adpcm_get(r, bitpos & 7);
+}
+
+static void adpcm_init_table(int32_t *tab, int nbits)
+{   // step_index << nbits | delta -> vpdiff*128 + next step_index, same arithmetic as adpcm_decode
+    const char *table = index_tables[nbits - 2];
+    int signmask = 1 << (nbits - 1);
+    for (int index = 0; index < 89; index++)
+        for (int delta = 0; delta < (1 << nbits); delta++)
+        {
+            int step = adpcm_step_table[index], vpdiff = 0, k = 1 << (nbits - 2);
+            do {
+                if (delta & k)
+                    vpdiff += step;
+                step >>= 1;
+                k >>= 1;
+            } while (k);
+            vpdiff += step;
+            if (delta & signmask)
+                vpdiff = -vpdiff;
+            tab[index << nbits | delta] = vpdiff*128 + clip(index + table[delta & ~signmask], 0, 88);
+        }
+}
+
+static void adpcm_packet_mono(adpcm_reader *r, const int32_t *tab, int nbits, int16_t *samples, int codes)
+{
+    int predictor = (int16_t)adpcm_get(r, 16), index = adpcm_get(r, 6);
+    *samples++ = predictor;
+    for (int i = 0; i < codes; i++)
+    {
+        int t = tab[index << nbits | adpcm_get(r, nbits)];
+        predictor = clip16(predictor + (t >> 7));
+        index = t & 127;
+        *samples++ = predictor;
+    }
+}
+
+static void adpcm_packet_stereo(adpcm_reader *r, const int32_t *tab, int nbits, int16_t *samples, int codes)
+{   // both channels step together: one read for codes of a frame, one saturating pack for predictors
+    int mask = (1 << nbits) - 1, i;
+    int left = (int16_t)adpcm_get(r, 16), li = adpcm_get(r, 6);
+    int right = (int16_t)adpcm_get(r, 16), ri = adpcm_get(r, 6);
+    samples[0] = left;
+    samples[1] = right;
+    samples += 2;
+#if ADPCM_X86
+    __m128i p = _mm_set_epi32(0, 0, right, left);
+    for (i = 0; i < codes; i++, samples += 2)
+    {
+        int c = adpcm_get(r, 2*nbits);
+        int tl = tab[li << nbits | c >> nbits], tr = tab[ri << nbits | (c & mask)];
+        li = tl & 127;
+        ri = tr & 127;
+        p = _mm_packs_epi32(_mm_add_epi32(p, _mm_srai_epi32(_mm_set_epi32(0, 0, tr, tl), 7)), _mm_setzero_si128());
+        int32_t lr = _mm_cvtsi128_si32(p);
+        memcpy(samples, &lr, 4);
+        p = _mm_srai_epi32(_mm_unpacklo_epi16(p, p), 16);
+    }
+#else
+    for (i = 0; i < codes; i++, samples += 2)
+    {
+        int c = adpcm_get(r, 2*nbits);
+        int tl = tab[li << nbits | c >> nbits], tr = tab[ri << nbits | (c & mask)];
+        samples[0] = left  = clip16(left + (tl >> 7));
+        samples[1] = right = clip16(right + (tr >> 7));
+        li = tl & 127;
+        ri = tr & 127;
+    }
+#endif
+}
+
+int adpcm_num_packets(const uint8_t *buf, int buf_size, int channels)
+{
+    if (buf_size <= 0)
+        return 0;
+    int size = buf_size*8, bits = ((buf[0] >> 6) + 2)*channels, packet_bits = 22*channels + 4095*bits;
+    return size - 22*channels < 2 ? 0 : (size - 22*channels - 2)/packet_bits + 1;
+}
+
+int adpcm_decode_packets(const uint8_t *buf, int buf_size, int channels, int16_t *samples, int max_samples, int first, int count)
+{   // packets restart predictors, so any range decodes alone; samples of packet k go to samples + k*4096*channels
+    int size = buf_size*8, samples_num = 0;
+    if (buf_size <= 0 || first < 0)
+        return 0;
+    int nbits = (buf[0] >> 6) + 2, bits = nbits*channels, packet_bits = 22*channels + 4095*bits;
+    int32_t tab[89 << 5];
+    int16_t tmp[4096*2];
+    adpcm_reader r;
+    adpcm_init_table(tab, nbits);
+    adpcm_seek(&r, buf, buf_size, 2 + first*packet_bits);
+    for (int k = first; k < first + count; k++)
+    {
+        int bitpos = 2 + k*packet_bits, out = k*4096*channels;
+        if (bitpos > size - 22*channels || out >= max_samples)
+            break;
+        bitpos += 22*channels;
+        int codes = bitpos <= (size - bits) ? (size - bits - bitpos)/bits + 1 : 0;
+        codes = codes < 4095 ? codes : 4095;
+        int n = (codes + 1)*channels, store = n < max_samples - out ? n : max_samples - out;
+        int16_t *dst = store < n ? tmp : samples + out; // last stored packet can end inside a frame
+        if (2 == channels)
+            adpcm_packet_stereo(&r, tab, nbits, dst, codes);
+        else
+            adpcm_packet_mono(&r, tab, nbits, dst, codes);
+        if (dst == tmp)
+            memcpy(samples + out, tmp, store*sizeof(int16_t));
+        samples_num += store;
+    }
+    return samples_num;
+}
+
+int adpcm_decode_buf(const uint8_t *buf, int buf_size, int channels, int16_t *samples, int max_samples)
+{
+    return adpcm_decode_packets(buf, buf_size, channels, samples, max_samples, 0, adpcm_num_packets(buf, buf_size, channels));
+}
+
+#ifdef _TEST
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static int adpcm_reference(const uint8_t *buf, int buf_size, int channels, int16_t *samples, int max_samples)
+{
+    TAG tag;
+    memset(&tag, 0, sizeof(tag));
+    tag.data = (uint8_t *)buf;
+    tag.len = buf_size;
+    return adpcm_decode(&tag, buf_size, channels, samples, max_samples);
+}
+
+static double adpcm_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+void adpcm_bench(void)
+{   // bit exact against tag reader decoder on random streams, whole and packet by packet, then speed of both
+    static uint8_t buf[64*1024];
+    static int16_t ref[64*1024*4 + 64], dec[64*1024*4 + 64], part[64*1024*4 + 64];
+    int i, j, mismatch = 0, tests = 0;
+    srand(1);
+    for (i = 0; i < 3000; i++)
+    {
+        int channels = 1 + (i & 1), size = 1 + (i < 1000 ? rand() % 63 : rand() % (sizeof(buf) - 1)); // reference reader needs a byte
+        for (j = 0; j < size; j++)
+            buf[j] = rand();
+        int total = adpcm_samples(buf, size, channels);
+        int max_samples = (i % 3) ? total : rand() % (total + 2);
+        int n_ref = adpcm_reference(buf, size, channels, ref, max_samples);
+        int n_dec = adpcm_decode_buf(buf, size, channels, dec, max_samples);
+        int packets = adpcm_num_packets(buf, size, channels), n_part = 0;
+        for (j = packets - 1; j >= 0; j--)
+            n_part += adpcm_decode_packets(buf, size, channels, part, max_samples, j, 1);
+        mismatch |= n_ref != n_dec || n_ref != n_part || n_ref > total || memcmp(ref, dec, n_ref*2) || memcmp(ref, part, n_ref*2);
+        tests++;
+    }
+    double t_ref[2] = { 0 }, t_dec[2] = { 0 };
+    int64_t samples[2] = { 0 };
+    for (i = 0; i < 16; i++)
+    {   // every code size, one full buffer of packets
+        int channels = 1 + (i & 1), size = sizeof(buf);
+        for (j = 0; j < size; j++)
+            buf[j] = rand();
+        buf[0] = (buf[0] & 0x3f) | ((i >> 1) & 3) << 6;
+        int total = adpcm_samples(buf, size, channels);
+        double t0 = adpcm_time();
+        adpcm_reference(buf, size, channels, ref, total);
+        double t1 = adpcm_time();
+        adpcm_decode_buf(buf, size, channels, dec, total);
+        double t2 = adpcm_time();
+        t_ref[channels - 1] += t1 - t0;
+        t_dec[channels - 1] += t2 - t1;
+        samples[channels - 1] += total;
+        mismatch |= memcmp(ref, dec, total*2);
+    }
+    printf("bench: adpcm: tests %d, mono %.1f Msamples/s %.1fx, stereo %.1f Msamples/s %.1fx%s\n", tests, samples[0]/t_dec[0]*1e-6, t_ref[0]/t_dec[0],
+        samples[1]/t_dec[1]*1e-6, t_ref[1]/t_dec[1], mismatch ? ", MISMATCH" : "");
+}
+#endif
@@ -1,3 +1,14 @@
 #pragma once
+#include <stdint.h>
 
-int adpcm_decode(TAG *tag, int buf_size, int channels, int16_t *samples, int max_samples);
+struct _TAG;
+
+int adpcm_decode(struct _TAG *tag, int buf_size, int channels, int16_t *samples, int max_samples);
+int adpcm_samples(const uint8_t *buf, int buf_size, int channels);
+// cached bit reader decoder, same output as adpcm_decode
+int adpcm_num_packets(const uint8_t *buf, int buf_size, int channels);
+int adpcm_decode_packets(const uint8_t *buf, int buf_size, int channels, int16_t *samples, int max_samples, int first, int count);
+int adpcm_decode_buf(const uint8_t *buf, int buf_size, int channels, int16_t *samples, int max_samples);
+#ifdef _TEST
+void adpcm_bench(void);
+#endif
@@ -1,4 +1,5 @@
 #include "avm1.h"
+#include <profile.h>
 #include <signal.h>
 #include <assert.h>
 #include <string.h>
@@ -7,6 +8,7 @@
 #include <strings.h>
 #include <math.h>
 #include <inttypes.h>
+#include <time.h>
 #include <platform/platform.h>
 #include <audio/audio.h>
 
@@ -21,6 +23,98 @@
 #define DBG_BREAK
 #endif
 
+typedef struct ASStringHeader
+{
+    uint32_t ref_count, size_class;
+} ASStringHeader;
+
+#define STRING_HEAP STRING_CLASSES
+
+static char *string_alloc(LVGActionCtx *ctx, size_t len)
+{   // returns buffer for len characters plus terminator, holding one reference
+    ASStringArena *ar = &ctx->strings;
+    size_t size = sizeof(ASStringHeader) + len + 1;
+    ASStringHeader *h;
+    int cls = 0;
+    while (cls < STRING_CLASSES && ((size_t)16 << cls) < size)
+        cls++;
+#ifdef _TEST
+    ar->num_allocs++;
+#endif
+    if (STRING_HEAP == cls)
+    {
+        h = malloc(size);
+#ifdef _TEST
+        ar->num_heap_allocs++;
+#endif
+    } else if (ar->free_blocks[cls])
+    {
+        h = (ASStringHeader *)ar->free_blocks[cls];
+        ar->free_blocks[cls] = *(char **)(h + 1);
+    } else
+    {
+        if ((ar->end - ar->cur) < (16 << cls))
+        {   // chunks are linked through their first 16 bytes
+            char *chunk = malloc(STRING_CHUNK_SIZE);
+            *(void **)chunk = ar->chunks;
+            ar->chunks = chunk;
+            ar->cur = chunk + 16;
+            ar->end = chunk + STRING_CHUNK_SIZE;
+#ifdef _TEST
+            ar->num_heap_allocs++;
+#endif
+        }
+        h = (ASStringHeader *)ar->cur;
+        ar->cur += 16 << cls;
+    }
+    h->ref_count  = 1;
+    h->size_class = cls;
+    return (char *)(h + 1);
+}
+
+static inline void string_retain(const char *str)
+{
+    ((ASStringHeader *)str - 1)->ref_count++;
+}
+
+static void string_release(LVGActionCtx *ctx, const char *str)
+{
+    ASStringHeader *h = (ASStringHeader *)str - 1;
+    if (--h->ref_count)
+        return;
+    if (STRING_HEAP == h->size_class)
+    {
+        free(h);
+        return;
+    }
+    *(char **)(h + 1) = ctx->strings.free_blocks[h->size_class];
+    ctx->strings.free_blocks[h->size_class] = (char *)h;
+}
+
+static void string_arena_free(ASStringArena *ar)
+{
+    while (ar->chunks)
+    {
+        void *next = *(void **)ar->chunks;
+        free(ar->chunks);
+        ar->chunks = next;
+    }
+    memset(ar->free_blocks, 0, sizeof(ar->free_blocks));
+    ar->cur = ar->end = 0;
+}
+
+static inline void val_retain(const ASVal *v)
+{
+    if (v->is_dynamic && ASVAL_STRING == v->type)
+        string_retain(v->str);
+}
+
+static inline void val_release(LVGActionCtx *ctx, const ASVal *v)
+{   // SET_INT and friends leave stale is_dynamic flag, only strings own storage
+    if (v->is_dynamic && ASVAL_STRING == v->type)
+        string_release(ctx, v->str);
+}
+
 void stack_push(LVGActionCtx *ctx)
 {
     assert(ctx->stack_ptr > 0);
@@ -45,8 +139,7 @@ void stack_pop(LVGActionCtx *ctx, int n)
     for (; n; n--)
     {
         ASVal *val = &ctx->stack[ctx->stack_ptr];
-        if (val->is_dynamic)
-            free((char*)val->str);
+        val_release(ctx, val);
         memset(val, 0, sizeof(*val));
         ctx->stack_ptr++;
     }
@@ -214,6 +307,7 @@ ASClass *to_object(LVGActionCtx *ctx, ASVal *v)
         base = &g_string;
         res = create_instance(ctx, base);
         res->priv = strdup(v->str);
+        res->gc_free_priv = 1;
     } else if (ASVAL_DOUBLE == v->type || ASVAL_FLOAT == v->type || ASVAL_INT == v->type)
     {
 
@@ -326,57 +420,374 @@ int strcmp_identifier(LVGActionCtx *ctx, const char *s1, const char *s2)
         return strcasecmp(s1, s2);
 }
 
-ASVal *search_var(LVGActionCtx *ctx, const char *name)
+static ASAtom **g_atom_table;
+static uint32_t g_atom_table_size, g_num_atoms;
+ASAtom *g_atoms[NUM_ATOMS];
+
+static const char *g_atom_names[NUM_ATOMS] =
 {
-    int i;
-    for (i = 0; i < g_num_properties; i++)
-        if (0 == strcmp_identifier(ctx, g_properties[i].name, name))
-            return &g_properties[i].val;
+    "_root", "_currentframe", "_totalframes", "_framesloaded", "_visible", "_alpha", "onEnterFrame", "cacheAsBitmap"
+};
+
+static uint32_t atom_hash(const char *str)
+{   // FNV-1a
+    uint32_t h = 2166136261u;
+    for (; *str; str++)
+        h = (h ^ (uint8_t)*str)*16777619u;
+    return h;
+}
+
+static void atom_table_grow(void)
+{
+    uint32_t i, new_size = g_atom_table_size ? g_atom_table_size*2 : 1024;
+    ASAtom **table = (ASAtom **)calloc(new_size, sizeof(ASAtom *));
+    for (i = 0; i < g_atom_table_size; i++)
+    {
+        ASAtom *a = g_atom_table[i];
+        while (a)
+        {
+            ASAtom *next = a->next;
+            a->next = table[a->hash & (new_size - 1)];
+            table[a->hash & (new_size - 1)] = a;
+            a = next;
+        }
+    }
+    if (g_atom_table)
+        free(g_atom_table);
+    g_atom_table = table;
+    g_atom_table_size = new_size;
+}
+
+static ASAtom *atom_find(const char *str, uint32_t hash)
+{
+    if (g_atom_table)
+        for (ASAtom *a = g_atom_table[hash & (g_atom_table_size - 1)]; a; a = a->next)
+            if (a->hash == hash && !strcmp(a->str, str))
+                return a;
+    return 0;
+}
+
+ASAtom *atom_intern(const char *str)
+{   // atoms live for the process lifetime: only literal, constant pool and engine names are interned
+    uint32_t hash = atom_hash(str);
+    ASAtom *found = atom_find(str, hash);
+    if (found)
+        return found;
+    if (g_num_atoms >= g_atom_table_size)
+        atom_table_grow();
+    size_t len = strlen(str);
+    ASAtom *a = (ASAtom *)malloc(sizeof(ASAtom) + len + 1);
+    char *s = (char *)(a + 1);
+    memcpy(s, str, len + 1);
+    a->str  = s;
+    a->hash = hash;
+    a->fold = a;
+    a->dynamic = 0;
+    a->next = g_atom_table[hash & (g_atom_table_size - 1)];
+    g_atom_table[hash & (g_atom_table_size - 1)] = a;
+    g_num_atoms++;
+    size_t i;
+    for (i = 0; i < len; i++)
+        if (s[i] >= 'A' && s[i] <= 'Z')
+            break;
+    if (i < len)
+    {
+        char *lower = (char *)malloc(len + 1);
+        for (i = 0; i <= len; i++)
+            lower[i] = (s[i] >= 'A' && s[i] <= 'Z') ? s[i] + ('a' - 'A') : s[i];
+        a->fold = atom_intern(lower);
+        free(lower);
+    }
+    return a;
+}
+
+static inline ASAtom *atom_key(LVGActionCtx *ctx, ASAtom *a)
+{   // identifiers are case insensitive before SWF 7
+    return ctx->version >= 7 ? a : a->fold;
+}
+
+static inline ASAtom *member_atom(ASMember *m)
+{
+    if (!m->atom)
+        m->atom = atom_intern(m->name);
+    return m->atom;
+}
+
+static inline ASAtom *name_atom(const char *str, ASAtom *tmp)
+{   // lookup only: unknown runtime names get tmp atom, valid while str is
+    ASAtom *a = atom_find(str, atom_hash(str));
+    if (a)
+        return a;
+    memset(tmp, 0, sizeof(*tmp));
+    tmp->str = str;
+    tmp->fold = tmp;
+    tmp->dynamic = 1;
+    return tmp;
+}
+
+static inline ASAtom *val_atom(ASVal *v, ASAtom *tmp)
+{   // literal and constant pool strings come with atom, runtime strings are not interned
+    if (v->atom)
+        return v->atom;
+    ASAtom *a = name_atom(v->str, tmp);
+    if (a != tmp)
+        v->atom = a;
+    return a;
+}
+
+static inline int atom_equal(LVGActionCtx *ctx, ASAtom *a, ASAtom *b)
+{
+    if (a->dynamic || b->dynamic)
+        return !strcmp_identifier(ctx, a->str, b->str);
+    return atom_key(ctx, a) == atom_key(ctx, b);
+}
+
+static inline ASAtom *class_atom(ASClass *c)
+{
+    if (!c->atom)
+        c->atom = atom_intern(c->name);
+    return c->atom;
+}
+
+static ASMember *find_member(LVGActionCtx *ctx, ASMember *members, int num_members, ASAtom *atom)
+{
+#ifdef _TEST
+    ctx->num_lookups++;
+#endif
+    ASAtom *key = atom_key(ctx, atom);
+    for (int i = 0; i < num_members; i++)
+    {
+        ASAtom *m = member_atom(members + i);
+        if (atom_key(ctx, m) == key || ((atom->dynamic || m->dynamic) && !strcmp_identifier(ctx, m->str, atom->str)))
+            return members + i;
+    }
+    return 0;
+}
+
+ASVal *search_var_atom(LVGActionCtx *ctx, ASAtom *atom)
+{
+    ASMember *m = find_member(ctx, g_properties, g_num_properties, atom);
+    if (m)
+        return &m->val;
     ASClass *pthis = THIS;
-    if (pthis)
-        for (i = 0; i < pthis->num_members; i++)
-            if (0 == strcmp_identifier(ctx, pthis->members[i].name, name))
-                return &pthis->members[i].val;
-    for (i = 0; i < g_num_classes; i++)
-        if (0 == strcmp_identifier(ctx, g_classes[i].cls->name, name))
+    if (pthis && (m = find_member(ctx, pthis->members, pthis->num_members, atom)))
+        return &m->val;
+    for (int i = 0; i < g_num_classes; i++)
+        if (atom_equal(ctx, class_atom(g_classes[i].cls), atom))
             return &g_classes[i];
     return 0;
 }
 
-ASVal *find_class_member(LVGActionCtx *ctx, ASClass *c, const char *name)
+ASVal *search_var(LVGActionCtx *ctx, const char *name)
 {
-    for (int i = 0; i < c->num_members; i++)
-        if (0 == strcmp_identifier(ctx, c->members[i].name, name))
-            return &c->members[i].val;
-    return 0;
+    return search_var_atom(ctx, atom_intern(name));
 }
 
-ASVal *create_local(LVGActionCtx *ctx, ASClass *c, const char *name)
+ASVal *find_class_member_atom(LVGActionCtx *ctx, ASClass *c, ASAtom *atom)
 {
-    for (int i = 0; i < c->num_members; i++)
-        if (0 == strcmp_identifier(ctx, c->members[i].name, name))
-            return &c->members[i].val;
+    ASMember *m = find_member(ctx, c->members, c->num_members, atom);
+    return m ? &m->val : 0;
+}
+
+ASVal *find_class_member(LVGActionCtx *ctx, ASClass *c, const char *name)
+{
+    return find_class_member_atom(ctx, c, atom_intern(name));
+}
+
+ASVal *create_local_atom(LVGActionCtx *ctx, ASClass *c, ASAtom *atom)
+{
+    ASMember *m = find_member(ctx, c->members, c->num_members, atom);
+    if (m)
+        return &m->val;
+    if (atom->dynamic)
+    {   // member name built at runtime, atom copy lives until vm is freed
+        size_t len = strlen(atom->str);
+        ASAtom *a = (ASAtom *)malloc(sizeof(ASAtom) + len + 1);
+        memcpy(a + 1, atom->str, len + 1);
+        a->str  = (const char *)(a + 1);
+        a->fold = a;
+        a->hash = 0;
+        a->dynamic = 1;
+        a->next = ctx->dynamic_atoms;
+        ctx->dynamic_atoms = atom = a;
+    }
     c->members = realloc(c->members, (c->num_members + 1)*sizeof(c->members[0]));
     ASMember *res = c->members + c->num_members++;
     memset(res, 0, sizeof(*res));
-    res->name = name;
+    res->name = atom->str;
+    res->atom = atom;
     return &res->val;
 }
 
+ASVal *create_local(LVGActionCtx *ctx, ASClass *c, const char *name)
+{
+    ASAtom tmp;
+    return create_local_atom(ctx, c, name_atom(name, &tmp));
+}
+
+static void gc_shade(LVGActionCtx *ctx, ASClass *cls)
+{
+    ASCollector *gc = &ctx->gc;
+    if (!cls || gc->epoch == cls->gc_mark)
+        return;
+    cls->gc_mark = gc->epoch;
+    if (gc->num_gray == gc->max_gray)
+    {
+        gc->max_gray = gc->max_gray ? gc->max_gray*2 : 256;
+        gc->gray = realloc(gc->gray, sizeof(ASClass*)*gc->max_gray);
+    }
+    gc->gray[gc->num_gray++] = cls;
+}
+
+static inline void gc_shade_val(LVGActionCtx *ctx, const ASVal *v)
+{
+    if (ASVAL_CLASS == v->type)
+        gc_shade(ctx, v->cls);
+}
+
+static inline void gc_barrier(LVGActionCtx *ctx, const ASVal *v)
+{   // value stored into object member while marking may only be reachable from already traced object
+    if (GC_MARK == ctx->gc.phase)
+        gc_shade_val(ctx, v);
+}
+
+static void gc_shade_roots(LVGActionCtx *ctx)
+{
+    int i;
+    for (i = ctx->stack_ptr + 1; i < STACK_SIZE; i++)
+        gc_shade_val(ctx, &ctx->stack[i]);
+    for (i = 0; i < sizeof(ctx->regs)/sizeof(ctx->regs[0]); i++)
+        gc_shade_val(ctx, &ctx->regs[i]);
+    for (i = 0; i < ctx->call_depth; i++)
+        gc_shade(ctx, ctx->calls[i].save_this);
+    for (i = 0; i < g_num_properties; i++)
+        gc_shade_val(ctx, &g_properties[i].val);
+    for (i = 0; i < g_num_classes; i++)
+        gc_shade_val(ctx, &g_classes[i]);
+    for (i = 0; i < ctx->clip->num_groupstates; i++)
+        gc_shade(ctx, ctx->clip->groupstates[i].movieclip);
+    for (i = 0; i < ctx->clip->num_buttons; i++)
+        gc_shade(ctx, ctx->clip->buttons[i].button_obj);
+}
+
+static int gc_trace(LVGActionCtx *ctx, int work)
+{
+    ASCollector *gc = &ctx->gc;
+    while (gc->num_gray && work > 0)
+    {
+        ASClass *cls = gc->gray[--gc->num_gray];
+        for (int i = 0; i < cls->num_members; i++)
+            gc_shade_val(ctx, &cls->members[i].val);
+        work -= cls->num_members + 1;
+    }
+    return work;
+}
+
+static void gc_free_object(LVGActionCtx *ctx, ASClass *cls)
+{
+    for (int i = 0; i < cls->num_members; i++)
+        val_release(ctx, &cls->members[i].val);
+    if (cls->gc_free_priv)
+        free(cls->priv);
+    free(cls->members);
+    free(cls);
+}
+
+void lvgGCStep(LVGActionCtx *ctx)
+{
+    ASCollector *gc = &ctx->gc;
+    int work = GC_STEP_WORK;
+    if (GC_IDLE == gc->phase && ctx->num_allocated_calsses < (gc->threshold ? gc->threshold : GC_MIN_THRESHOLD))
+        return;
+#ifdef _TEST
+    struct timespec ts0, ts1;
+    clock_gettime(CLOCK_MONOTONIC, &ts0);
+#endif
+    if (GC_IDLE == gc->phase)
+    {   // new epoch makes all objects white without touching them
+        gc->epoch++;
+        gc->phase = GC_MARK;
+        gc_shade_roots(ctx);
+#ifdef _TEST
+        gc->num_cycles++;
+#endif
+    }
+    if (GC_MARK == gc->phase)
+    {
+        work = gc_trace(ctx, work);
+        if (gc->num_gray)
+            goto done;
+        // stack and registers are not guarded by barrier, rescan them and finish marking atomically
+        gc_shade_roots(ctx);
+        gc_trace(ctx, INT32_MAX);
+        gc->phase = GC_SWEEP;
+        gc->sweep_pos = gc->sweep_live = 0;
+        gc->sweep_end = ctx->num_allocated_calsses;
+    }
+    for (; gc->sweep_pos < gc->sweep_end && work > 0; work--)
+    {   // objects allocated during sweep are appended after sweep_end and survive this cycle
+        ASClass *cls = ctx->allocated_calsses[gc->sweep_pos++];
+        if (gc->epoch == cls->gc_mark)
+            ctx->allocated_calsses[gc->sweep_live++] = cls;
+        else
+        {
+            gc_free_object(ctx, cls);
+#ifdef _TEST
+            gc->num_freed++;
+#endif
+        }
+    }
+    if (gc->sweep_pos == gc->sweep_end)
+    {
+        int num_new = ctx->num_allocated_calsses - gc->sweep_end;
+        memmove(ctx->allocated_calsses + gc->sweep_live, ctx->allocated_calsses + gc->sweep_end, num_new*sizeof(ASClass*));
+        ctx->num_allocated_calsses = gc->sweep_live + num_new;
+        gc->threshold = ctx->num_allocated_calsses*2;
+        if (gc->threshold < GC_MIN_THRESHOLD)
+            gc->threshold = GC_MIN_THRESHOLD;
+        gc->phase = GC_IDLE;
+    }
+done:;
+#ifdef _TEST
+    clock_gettime(CLOCK_MONOTONIC, &ts1);
+    int64_t pause = (ts1.tv_sec - ts0.tv_sec)*1000000000LL + (ts1.tv_nsec - ts0.tv_nsec);
+    gc->pause_time += pause;
+    if (gc->max_pause < pause)
+        gc->max_pause = pause;
+#endif
+}
+
 ASClass *create_instance(LVGActionCtx *ctx, ASClass *base)
 {
+    for (int i = 0; i < base->num_members; i++)
+    {
+        member_atom(base->members + i);
+        val_retain(&base->members[i].val);
+    }
     ASClass *cls = malloc(sizeof(ASClass));
     memcpy(cls, base, sizeof(ASClass));
     cls->members = malloc(cls->num_members*sizeof(ASMember));
     memcpy(cls->members, base->members, cls->num_members*sizeof(ASMember));
     cls->priv = 0;
     cls->ref_count = 1;
-    // track class allocation (currently no GC)
+    cls->gc_mark = 0;
+    cls->gc_free_priv = 0;
+    // instances created by scripts are owned by collector, engine ones (ctx == 0) use ref_count
     if (ctx)
     {
-        ctx->num_allocated_calsses++;
-        ctx->allocated_calsses = realloc(ctx->allocated_calsses, sizeof(ASClass*)*ctx->num_allocated_calsses);
-        ctx->allocated_calsses[ctx->num_allocated_calsses - 1] = cls;
+        ASCollector *gc = &ctx->gc;
+        if (ctx->num_allocated_calsses == gc->max_objects)
+        {
+            gc->max_objects = gc->max_objects ? gc->max_objects*2 : 64;
+            ctx->allocated_calsses = realloc(ctx->allocated_calsses, sizeof(ASClass*)*gc->max_objects);
+        }
+        ctx->allocated_calsses[ctx->num_allocated_calsses++] = cls;
+        if (GC_MARK == gc->phase)
+            gc_shade(ctx, cls); // allocated during marking: trace it, it may be stored anywhere already scanned
+#ifdef _TEST
+        if (gc->peak_objects < ctx->num_allocated_calsses)
+            gc->peak_objects = ctx->num_allocated_calsses;
+#endif
     }
     return cls;
 }
@@ -390,13 +801,16 @@ void free_instance(ASClass *cls)
     free(cls);
 }
 
+static ASCode *get_code(LVGActionCtx *ctx, const uint8_t *src, int is_function);
+
 static void do_call(LVGActionCtx *ctx, ASClass *c, ASVal *var, uint8_t *a, uint32_t nargs)
 {
     if (!var->str)
         return;
     if (ASVAL_FUNCTION == var->type)
     {
-        uint8_t *func = (uint8_t *)var->str;
+        ASCode *code = get_code(ctx, (uint8_t *)var->str, 1);
+        ctx->calls[ctx->call_depth].save_code = ctx->code;
         ctx->calls[ctx->call_depth].save_pc   = ctx->pc;
         ctx->calls[ctx->call_depth].save_size = ctx->size;
         ctx->calls[ctx->call_depth].save_this = THIS;
@@ -405,8 +819,9 @@ static void do_call(LVGActionCtx *ctx, ASClass *c, ASVal *var, uint8_t *a, uint3
         THIS = c;
         if (!c)
             g_properties[0].val.type = ASVAL_UNDEFINED;
-        ctx->pc = func - ctx->actions + 2;
-        ctx->size = ctx->pc + *(uint16_t*)func;
+        ctx->code = code;
+        ctx->pc   = 0;
+        ctx->size = code->num_insns;
     } else
     if (ASVAL_NATIVE_FN == var->type)
     {
@@ -424,7 +839,7 @@ static void do_call(LVGActionCtx *ctx, ASClass *c, ASVal *var, uint8_t *a, uint3
 
 void handle_frame_change(LVGActionCtx *ctx, LVGMovieClipGroupState *groupstate)
 {
-    ASVal *_currentframe = find_class_member(ctx, groupstate->movieclip, "_currentframe");
+    ASVal *_currentframe = find_class_member_atom(ctx, groupstate->movieclip, g_atoms[ATOM_CURRENTFRAME]);
     SET_INT(_currentframe, groupstate->cur_frame + 1);
     LVGMovieClipGroup *group = ctx->clip->groups + groupstate->group_num;
     for (int i = 0; i < group->num_ssounds; i++)
@@ -637,7 +1052,7 @@ static void action_string_extract(LVGActionCtx *ctx, uint8_t *a)
 #endif
     uint32_t idx = to_int(se_index);
     uint32_t cnt = to_int(se_count);
-    char *str = malloc(cnt + 1);
+    char *str = string_alloc(ctx, cnt);
     memcpy(str, se_str->str + idx, cnt);
     str[cnt] = 0;
     ASVal *res = result_val(ctx, 3);
@@ -660,6 +1075,7 @@ static void action_to_integer(LVGActionCtx *ctx, uint8_t *a)
 
 static void action_get_variable(LVGActionCtx *ctx, uint8_t *a)
 {
+    ASAtom tmp;
     ASVal *se = &ctx->stack[ctx->stack_ptr];
     assert(ASVAL_STRING == se->type && se->str);
     if (ASVAL_STRING != se->type || !se->str)
@@ -667,25 +1083,27 @@ static void action_get_variable(LVGActionCtx *ctx, uint8_t *a)
         SET_UNDEF(se);
         return;
     }
-    ASVal *var = search_var(ctx, se->str);
+    ASVal *var = search_var_atom(ctx, val_atom(se, &tmp));
     ASVal *res = result_val(ctx, 1);
     if (var)
     {
         *res = *var;
-        if (res->is_dynamic)
-            res->str = strdup(res->str);
+        val_retain(res);
     } else
         SET_UNDEF(res);
 }
 
 static void action_set_variable(LVGActionCtx *ctx, uint8_t *a)
 {
+    ASAtom tmp;
     ASVal *se_val = &ctx->stack[ctx->stack_ptr];
     ASVal *se_var = se_val + 1;
     assert(ASVAL_STRING == se_var->type && se_var->str);
     if (ASVAL_STRING == se_var->type || se_var->str)
     {
-        ASVal *res = create_local(ctx, THIS, se_var->str);
+        ASVal *res = create_local_atom(ctx, THIS, val_atom(se_var, &tmp));
+        val_release(ctx, res);
+        gc_barrier(ctx, se_val);
         *res = *se_val;
         se_val->is_dynamic = 0;
     }
@@ -701,7 +1119,7 @@ static void action_string_add(LVGActionCtx *ctx, uint8_t *a)
 
     size_t len_b = strlen(se_b->str);
     size_t len_a = strlen(se_a->str);
-    char *str = malloc(len_b + len_a + 1);
+    char *str = string_alloc(ctx, len_b + len_a);
     memcpy(str, se_b->str, len_b);
     memcpy(str + len_b, se_a->str, len_a);
     str[len_b + len_a] = 0;
@@ -718,6 +1136,14 @@ static const char *props[] =
     "_url", "_highquality", "_focusrect", "_soundbuftime", "_quality", "_xmouse", "_ymouse"
 };
 
+static ASAtom *prop_atom(uint32_t idx)
+{
+    static ASAtom *atoms[sizeof(props)/sizeof(props[0])];
+    if (!atoms[idx])
+        atoms[idx] = atom_intern(props[idx]);
+    return atoms[idx];
+}
+
 static void action_get_property(LVGActionCtx *ctx, uint8_t *a)
 {
     ASVal *se_idx = &ctx->stack[ctx->stack_ptr];
@@ -732,15 +1158,13 @@ static void action_get_property(LVGActionCtx *ctx, uint8_t *a)
         idx = 0;
     ASClass *c = ctx->groupstate->movieclip; // TODO: use target
     ASVal *res = result_val(ctx, 2);
-    const char *prop = props[idx];
-    for (int i = 0; i < c->num_members; i++)
-        if (0 == strcmp_identifier(ctx, c->members[i].name, prop))
-        {
-            *res = c->members[i].val;
-            if (res->is_dynamic)
-                res->str = strdup(res->str);
-            return;
-        }
+    ASVal *val = find_class_member_atom(ctx, c, prop_atom(idx));
+    if (val)
+    {
+        *res = *val;
+        val_retain(res);
+        return;
+    }
     assert(0); ctx->do_exit = 1;
 }
 
@@ -758,15 +1182,16 @@ static void action_set_property(LVGActionCtx *ctx, uint8_t *a)
     if (idx > 21)
         idx = 0;
     ASClass *c = ctx->groupstate->movieclip; // TODO: use target
-    const char *prop = props[idx];
-    for (int i = 0; i < c->num_members; i++)
-        if (0 == strcmp_identifier(ctx, c->members[i].name, prop))
-        {
-            c->members[i].val = *se_val;
-            se_val->is_dynamic = 0;
-            stack_pop(ctx, 3);
-            return;
-        }
+    ASVal *val = find_class_member_atom(ctx, c, prop_atom(idx));
+    if (val)
+    {
+        val_release(ctx, val);
+        gc_barrier(ctx, se_val);
+        *val = *se_val;
+        se_val->is_dynamic = 0;
+        stack_pop(ctx, 3);
+        return;
+    }
     assert(0); ctx->do_exit = 1;
 }
 
@@ -902,12 +1327,15 @@ static void action_delete2(LVGActionCtx *ctx, uint8_t *a)
 
 static void action_define_local(LVGActionCtx *ctx, uint8_t *a)
 {
+    ASAtom tmp;
     ASVal *se_val = &ctx->stack[ctx->stack_ptr];
     ASVal *se_name = se_val + 1;
     assert(ASVAL_STRING == se_name->type && se_name->str);
     if (ASVAL_STRING != se_name->type || !se_name->str)
         return;
-    ASVal *res = create_local(ctx, THIS, se_name->str);
+    ASVal *res = create_local_atom(ctx, THIS, val_atom(se_name, &tmp));
+    val_release(ctx, res);
+    gc_barrier(ctx, se_val);
     *res = *se_val;
     se_val->is_dynamic = 0;
     stack_pop(ctx, 2);
@@ -915,6 +1343,7 @@ static void action_define_local(LVGActionCtx *ctx, uint8_t *a)
 
 static void action_call_function(LVGActionCtx *ctx, uint8_t *a)
 {
+    ASAtom tmp;
     if (ctx->call_depth >= sizeof(ctx->calls)/sizeof(ctx->calls[0]))
     {
         ctx->do_exit = 1;
@@ -930,7 +1359,7 @@ static void action_call_function(LVGActionCtx *ctx, uint8_t *a)
     }
     assert(ASVAL_INT == se_nargs->type || ASVAL_DOUBLE == se_nargs->type || ASVAL_FLOAT == se_nargs->type);
     uint32_t nargs = to_int(se_nargs);
-    ASVal *var = search_var(ctx, se_name->str);
+    ASVal *var = search_var_atom(ctx, val_atom(se_name, &tmp));
     if (var)
     {
         stack_pop(ctx, 2);
@@ -970,8 +1399,9 @@ static void action_new_object(LVGActionCtx *ctx, uint8_t *a)
     assert(ASVAL_INT == se_nargs->type || ASVAL_DOUBLE == se_nargs->type || ASVAL_FLOAT == se_nargs->type);
     uint32_t nargs = to_int(se_nargs);
     ASVal *pcls = 0;
+    ASAtom tmp, *name = val_atom(se_name, &tmp);
     for (int i = 0; i < g_num_classes; i++)
-        if (0 == strcmp_identifier(ctx, g_classes[i].cls->name, se_name->str))
+        if (atom_equal(ctx, class_atom(g_classes[i].cls), name))
         {
             pcls = &g_classes[i];
             break;
@@ -1024,15 +1454,21 @@ static void action_add2(LVGActionCtx *ctx, uint8_t *a)
     ASVal *se_b = se_a + 1;
     if (ASVAL_STRING == se_a->type || ASVAL_STRING == se_b->type)
     {
-        const char *val_b = strdup(as_var_to_str(ctx, se_b));
+        char num_b[64]; // number conversion uses static buffer, so keep b before converting a
+        const char *val_b = as_var_to_str(ctx, se_b);
+        if (ASVAL_STRING != se_b->type)
+        {
+            strncpy(num_b, val_b, sizeof(num_b) - 1);
+            num_b[sizeof(num_b) - 1] = 0;
+            val_b = num_b;
+        }
         const char *val_a = as_var_to_str(ctx, se_a);
         size_t len_b = strlen(val_b);
         size_t len_a = strlen(val_a);
-        char *str = malloc(len_b + len_a + 1);
+        char *str = string_alloc(ctx, len_b + len_a);
         memcpy(str, val_b, len_b);
         memcpy(str + len_b, val_a, len_a);
         str[len_b + len_a] = 0;
-        free((char*)val_b);
         ASVal *res = result_val(ctx, 2);
         SET_STRING(res, str);
         res->is_dynamic = 1;
@@ -1102,8 +1538,7 @@ static void action_push_duplicate(LVGActionCtx *ctx, uint8_t *a)
     stack_push(ctx);
     ASVal *res = &ctx->stack[ctx->stack_ptr];
     *res = *se_top;
-    if (res->is_dynamic)
-        res->str = strdup(res->str);
+    val_retain(res);
 }
 
 static void action_swap(LVGActionCtx *ctx, uint8_t *a)
@@ -1117,6 +1552,7 @@ static void action_swap(LVGActionCtx *ctx, uint8_t *a)
 
 static void action_get_member(LVGActionCtx *ctx, uint8_t *a)
 {
+    ASAtom tmp;
     ASVal *se_member = &ctx->stack[ctx->stack_ptr];
     ASVal *se_var = se_member + 1;
     if (ASVAL_UNDEFINED == se_var->type)
@@ -1126,7 +1562,7 @@ static void action_get_member(LVGActionCtx *ctx, uint8_t *a)
         goto do_exit;
     if (ASVAL_STRING == se_var->type && se_var->str)
     {
-        ASVal *fn = find_class_member(ctx, &g_string, se_member->str);
+        ASVal *fn = find_class_member_atom(ctx, &g_string, val_atom(se_member, &tmp));
         assert(fn && fn->fn);
         if (!fn)
             goto do_exit;
@@ -1138,16 +1574,14 @@ static void action_get_member(LVGActionCtx *ctx, uint8_t *a)
     assert(ASVAL_CLASS == se_var->type && se_var->cls);
     if (ASVAL_CLASS != se_var->type || !se_var->cls)
         goto do_exit;
-    ASClass *c = se_var->cls;
-    for (int i = 0; i < c->num_members; i++)
-        if (0 == strcmp_identifier(ctx, se_member->str, c->members[i].name))
-        {
-            ASVal *res = result_val(ctx, 2);
-            *res = c->members[i].val;
-            if (res->is_dynamic)
-                res->str = strdup(res->str);
-            return;
-        }
+    ASVal *val = find_class_member_atom(ctx, se_var->cls, val_atom(se_member, &tmp));
+    if (val)
+    {
+        ASVal *res = result_val(ctx, 2);
+        *res = *val;
+        val_retain(res);
+        return;
+    }
 do_exit:
     {
         ASVal *res = result_val(ctx, 2);
@@ -1157,6 +1591,7 @@ do_exit:
 
 static void action_set_member(LVGActionCtx *ctx, uint8_t *a)
 {
+    ASAtom tmp;
     ASVal *se_val = &ctx->stack[ctx->stack_ptr];
     ASVal *se_member = se_val + 1;
     ASVal *se_var = se_val + 2;
@@ -1165,31 +1600,34 @@ static void action_set_member(LVGActionCtx *ctx, uint8_t *a)
     assert(ASVAL_CLASS == se_var->type && se_var->cls && ASVAL_STRING == se_member->type);
     if (ASVAL_CLASS != se_var->type || !se_var->cls || ASVAL_STRING != se_member->type)
         goto do_exit;
-    ASClass *c = se_var->cls;
-    for (int i = 0; i < c->num_members; i++)
-        if (0 == strcmp_identifier(ctx, se_member->str, c->members[i].name))
+    ASVal *val = find_class_member_atom(ctx, se_var->cls, val_atom(se_member, &tmp));
+    if (val)
+    {
+        int mnum = is_number(val), vnum = is_number(se_val);
+        if ((mnum && vnum) || val->type == se_val->type)
+            goto transfer;
+        else if (mnum && ASVAL_STRING == se_val->type)
         {
-            int mnum = is_number(&c->members[i].val), vnum = is_number(se_val);
-            if ((mnum && vnum) || c->members[i].val.type == se_val->type)
-                c->members[i].val = *se_val;
-            else if (mnum && ASVAL_STRING == se_val->type)
+            char *end = 0;
+            long int ival = strtol(se_val->str, &end, 10);
+            if (end && 0 == *end)
             {
-                char *end = 0;
-                long int ival = strtol(se_val->str, &end, 10);
-                if (end && 0 == *end)
-                {
-                    SET_INT(&c->members[i].val, ival);
-                    goto do_exit;
-                }
-                double dval = strtod(se_val->str, &end);
-                if (end && 0 == *end)
-                    SET_DOUBLE(&c->members[i].val, dval);
-            } else
-                c->members[i].val = *se_val;
-            se_val->is_dynamic = 0;
-            stack_pop(ctx, 3);
-            return;
+                SET_INT(val, ival);
+                goto do_exit;
+            }
+            double dval = strtod(se_val->str, &end);
+            if (end && 0 == *end)
+                SET_DOUBLE(val, dval);
+            goto do_exit;
         }
+transfer:
+        val_release(ctx, val);
+        gc_barrier(ctx, se_val);
+        *val = *se_val;
+        se_val->is_dynamic = 0;
+        stack_pop(ctx, 3);
+        return;
+    }
 do_exit:
     stack_pop(ctx, 3);
 #ifdef _TEST
@@ -1217,6 +1655,7 @@ static void action_decrement(LVGActionCtx *ctx, uint8_t *a)
 
 static void action_call_method(LVGActionCtx *ctx, uint8_t *a)
 {
+    ASAtom tmp;
     ASVal *se_method = &ctx->stack[ctx->stack_ptr];
     ASVal *se_obj = se_method + 1;
     ASVal *se_nargs = se_method + 2;
@@ -1241,7 +1680,7 @@ static void action_call_method(LVGActionCtx *ctx, uint8_t *a)
         goto do_exit;
     if (ASVAL_STRING == se_obj->type && se_obj->str)
     {
-        ASVal *fn = find_class_member(ctx, &g_string, se_method->str);
+        ASVal *fn = find_class_member_atom(ctx, &g_string, val_atom(se_method, &tmp));
         assert(fn && fn->fn);
         if (!fn)
             goto do_exit;
@@ -1254,13 +1693,13 @@ static void action_call_method(LVGActionCtx *ctx, uint8_t *a)
     if (ASVAL_CLASS != se_obj->type || !se_obj->cls)
         goto do_exit;
     ASClass *c = se_obj->cls;
-    for (int i = 0; i < c->num_members; i++)
-        if (0 == strcmp_identifier(ctx, se_method->str, c->members[i].name))
-        {
-            stack_pop(ctx, 3);
-            do_call(ctx, c, &c->members[i].val, a, nargs);
-            return;
-        }
+    ASVal *method = find_class_member_atom(ctx, c, val_atom(se_method, &tmp));
+    if (method)
+    {
+        stack_pop(ctx, 3);
+        do_call(ctx, c, method, a, nargs);
+        return;
+    }
 do_exit:
     {
         ASVal *res = result_val(ctx, nargs + 3);
@@ -1403,7 +1842,9 @@ static void action_store_register(LVGActionCtx *ctx, uint8_t *a)
 {
     int reg = *(uint8_t*)(a + 2);
     ASVal *se = &ctx->stack[ctx->stack_ptr];
+    val_release(ctx, &ctx->regs[reg]);
     ctx->regs[reg] = *se;
+    val_retain(se);
 }
 
 static void action_constant_pool(LVGActionCtx *ctx, uint8_t *a)
@@ -1417,6 +1858,21 @@ static void action_constant_pool(LVGActionCtx *ctx, uint8_t *a)
         ctx->cpool[i] = s;
         while(*s++);
     }
+    for (int i = 0; i < ctx->num_cpools; i++)
+        if (ctx->cpools[i].src == a)
+        {
+            ctx->cpool_atoms = ctx->cpools[i].atoms;
+            return;
+        }
+    // first execution of this pool - intern all entries
+    ctx->cpools = realloc(ctx->cpools, (ctx->num_cpools + 1)*sizeof(ASConstantPool));
+    ASConstantPool *pool = ctx->cpools + ctx->num_cpools++;
+    pool->src   = a;
+    pool->size  = ctx->cpool_size;
+    pool->atoms = malloc((ctx->cpool_size ? ctx->cpool_size : 1)*sizeof(ASAtom *));
+    for (int i = 0; i < ctx->cpool_size; i++)
+        pool->atoms[i] = atom_intern(ctx->cpool[i]);
+    ctx->cpool_atoms = pool->atoms;
 }
 
 static void action_wait_for_frame(LVGActionCtx *ctx, uint8_t *a)
@@ -1456,23 +1912,31 @@ static void action_wait_for_frame2(LVGActionCtx *ctx, uint8_t *a)
     stack_pop(ctx, 1);
 }
 
-static void action_define_function2(LVGActionCtx *ctx, uint8_t *a)
-{
-    const char *fname = (const char *)a + 2;
-    const uint8_t *data = (const uint8_t *)a + 2;
+static const uint8_t *function_body(const uint8_t *a, int action)
+{   // returns function code size field which is followed by function body
+    const uint8_t *data = a + 2;
     int i = 0;
     while (data[i++]);
     int nparams = *(uint16_t*)&data[i]; i += 2;
-    /*uint8_t nregs = data[i++];
-    uint8_t flags1 = data[i++];
-    uint8_t flags2 = data[i++];*/
-    i += 3;
+    if (ACTION_DEFINE_FUNCTION2 == action)
+    {
+        /*uint8_t nregs = data[i++];
+        uint8_t flags1 = data[i++];
+        uint8_t flags2 = data[i++];*/
+        i += 3;
+    }
     for (int p = 0; p < nparams; p++)
     {
-        //uint8_t regs = data[i++];
-        i++;
+        if (ACTION_DEFINE_FUNCTION2 == action)
+            i++; //uint8_t regs = data[i++];
         while (data[i++]);
     }
+    return &data[i];
+}
+
+static void define_function(LVGActionCtx *ctx, uint8_t *a, int action)
+{
+    const char *fname = (const char *)a + 2;
     ASVal *res;
     if (!*fname)
     {
@@ -1481,65 +1945,16 @@ static void action_define_function2(LVGActionCtx *ctx, uint8_t *a)
     } else
         res = create_local(ctx, THIS, fname);
     res->type = ASVAL_FUNCTION;
-    res->str  = (const char *)&data[i];
-    int codesize = *(uint16_t*)&data[i]; i += 2;
-    ctx->pc += codesize;
-}
-
-static void action_try(LVGActionCtx *ctx, uint8_t *a) { DBG_BREAK; }
-static void action_with(LVGActionCtx *ctx, uint8_t *a) { DBG_BREAK; }
-static void action_push(LVGActionCtx *ctx, uint8_t *a)
-{
-    int len = *(uint16_t*)a;
-    const char *data = (const char *)a + 2;
-    do {
-        stack_push(ctx);
-        ASVal *se = &ctx->stack[ctx->stack_ptr];
-        int size = 0, type = *(uint8_t*)data;
-        switch(type)
-        {
-        case 0: se->type = ASVAL_STRING; se->str = (const char*)data + 1; size = strlen(se->str) + 1; break;
-        case 1: se->type = ASVAL_FLOAT; se->f_int = read_float((uint8_t*)data + 1); size = 4; break;
-        case 2: se->type = ASVAL_NULL; se->str = 0; break;
-        case 3: se->type = ASVAL_UNDEFINED; se->str = 0; break;
-        case 4: { int reg = *((uint8_t*)data + 1); *se = ctx->regs[reg]; size = 1; } break;
-        case 5: se->type = ASVAL_BOOL; se->boolean = *((uint8_t*)data + 1) ? 1 : 0; size = 1; break;
-        case 6: se->type = ASVAL_DOUBLE; se->d_int = read_double((uint8_t*)data + 1); size = 8; break;
-        case 7: se->type = ASVAL_INT; se->ui32 = *(uint32_t*)((char*)data + 1); size = 4; break;
-        case 8:
-        case 9:
-        {
-            unsigned ptr;
-            if (8 == type)
-            {
-                ptr = *(uint8_t*)((char*)data + 1);  size = 1;
-            } else
-            {
-                ptr = *(uint16_t*)((char*)data + 1); size = 2;
-            }
-            if (ptr >= ctx->cpool_size)
-            {
-                SET_UNDEF(se);
-                break;
-            }
-            se->type = ASVAL_STRING; se->str = ctx->cpool[ptr];
-            break;
-        }
-        default:
-            assert(0); ctx->do_exit = 1;
-            return;
-        }
-        len -= size + 1;
-        data += size + 1;
-    } while (len > 0);
+    res->str  = (const char *)function_body(a, action);
 }
 
-static void action_jump(LVGActionCtx *ctx, uint8_t *a)
+static void action_define_function2(LVGActionCtx *ctx, uint8_t *a)
 {
-    int8_t offset = *(uint16_t *)(a + 2);
-    ctx->pc += offset;
+    define_function(ctx, a, ACTION_DEFINE_FUNCTION2);
 }
 
+static void action_try(LVGActionCtx *ctx, uint8_t *a) { DBG_BREAK; }
+static void action_with(LVGActionCtx *ctx, uint8_t *a) { DBG_BREAK; }
 static void action_get_url2(LVGActionCtx *ctx, uint8_t *a)
 {
     //int flags = *(uint8_t*)a->data;
@@ -1554,38 +1969,7 @@ static void action_get_url2(LVGActionCtx *ctx, uint8_t *a)
 
 static void action_define_function(LVGActionCtx *ctx, uint8_t *a)
 {
-    int i = 0;
-    const uint8_t *data = (const uint8_t *)a + 2;
-    const char *fname = (const char *)data;
-    while (data[i++]);
-    int params = data[i++];
-    params += data[i++]*256;
-    for (int j = 0; j < params;j++)
-    {
-        while (data[i++]);
-    }
-    ASVal *res;
-    if (!*fname)
-    {
-        stack_push(ctx);
-        res = &ctx->stack[ctx->stack_ptr];
-    } else
-        res = create_local(ctx, THIS, fname);
-    res->type = ASVAL_FUNCTION;
-    res->str  = (const char *)&data[i];
-    int codesize = data[i++];
-    codesize += data[i++]*256;
-    ctx->pc += codesize;
-}
-
-static void action_if(LVGActionCtx *ctx, uint8_t *a)
-{
-    ASVal *se_cond = &ctx->stack[ctx->stack_ptr];
-    double cond = to_double(ctx, se_cond);
-    int offset = *(int16_t *)(a + 2);
-    if (0.0 != cond)
-        ctx->pc += offset;
-    stack_pop(ctx, 1);
+    define_function(ctx, a, ACTION_DEFINE_FUNCTION);
 }
 
 static void action_goto_frame2(LVGActionCtx *ctx, uint8_t *a)
@@ -1753,13 +2137,13 @@ static const ActionEntry g_avm1_actions[256] =
     /* version 5 */
     [ACTION_WITH]              = { action_with,              DBG("With", 5,            1, 0) },
     /* version 4 */
-    [ACTION_PUSH]              = { action_push,              DBG("Push", 4,           0, -1) },
-    [ACTION_JUMP]              = { action_jump,              DBG("Jump", 4,            0, 0) },
+    [ACTION_PUSH]              = { 0,                        DBG("Push", 4,           0, -1) },
+    [ACTION_JUMP]              = { 0,                        DBG("Jump", 4,            0, 0) },
     [ACTION_GET_URL2]          = { action_get_url2,          DBG("GetURL2", 4,         2, 0) },
     /* version 5 */
     [ACTION_DEFINE_FUNCTION]   = { action_define_function,   DBG("DefineFunction", 5, 0, -1) },
     /* version 4 */
-    [ACTION_IF]                = { action_if,                DBG("If", 4,              1, 0) },
+    [ACTION_IF]                = { 0,                        DBG("If", 4,              1, 0) },
     [ACTION_CALL]              = { 0,                        DBG("Call", 4,          -1, -1) },
     [ACTION_GOTO_FRAME2]       = { action_goto_frame2,       DBG("GotoFrame2", 4,      1, 0) },
     [ACTION_PLAY_LVG_SOUND]    = { action_play_lvg_sound,    DBG("PlayLVGSound", 0,    0, 0) },
@@ -1772,6 +2156,9 @@ void lvgInitVM(LVGActionCtx *ctx, LVGEngine *e, LVGMovieClip *clip)
     ctx->clip   = clip;
     ctx->stack_ptr = sizeof(ctx->stack)/sizeof(ctx->stack[0]) - 1;
     ctx->version = clip->as_version;
+    for (int i = 0; i < NUM_ATOMS; i++)
+        if (!g_atoms[i])
+            g_atoms[i] = atom_intern(g_atom_names[i]);
 }
 
 void lvgFreeVM(LVGActionCtx *ctx)
@@ -1780,96 +2167,610 @@ void lvgFreeVM(LVGActionCtx *ctx)
     if (ctx->allocated_calsses)
     {
         for (i = 0; i < ctx->num_allocated_calsses; i++)
-        {
-            if (ctx->allocated_calsses[i]->members)
-                free(ctx->allocated_calsses[i]->members);
-            free(ctx->allocated_calsses[i]);
-        }
+            gc_free_object(ctx, ctx->allocated_calsses[i]);
         free(ctx->allocated_calsses);
         ctx->allocated_calsses = NULL;
     }
+    ctx->num_allocated_calsses = 0;
+    if (ctx->gc.gray)
+        free(ctx->gc.gray);
+    memset(&ctx->gc, 0, sizeof(ctx->gc));
     while (ctx->stack_ptr != (sizeof(ctx->stack)/sizeof(ctx->stack[0]) - 1))
         stack_pop(ctx, 1); // free any remaining dynamic values on stack
+    string_arena_free(&ctx->strings);
+    while (ctx->dynamic_atoms)
+    {
+        ASAtom *next = ctx->dynamic_atoms->next;
+        free(ctx->dynamic_atoms);
+        ctx->dynamic_atoms = next;
+    }
     if (ctx->cpool)
         free(ctx->cpool);
     ctx->cpool  = NULL;
+    for (i = 0; i < ctx->num_cpools; i++)
+        free(ctx->cpools[i].atoms);
+    if (ctx->cpools)
+        free(ctx->cpools);
+    ctx->cpools = NULL;
+    ctx->cpool_atoms = NULL;
+    ctx->num_cpools = 0;
+    for (i = 0; ctx->codes && i <= ctx->codes_mask; i++)
+    {
+        ASCode *code = ctx->codes[i];
+        if (!code)
+            continue;
+        free(code->insns);
+        if (code->operands)
+            free(code->operands);
+        free(code);
+    }
+    if (ctx->codes)
+        free(ctx->codes);
+    ctx->codes = NULL;
+    ctx->num_codes = 0;
+}
+
+enum
+{   // pre-decoded instruction ops
+    OP_NOP, OP_CALL, OP_PUSH, OP_JUMP, OP_IF, OP_DEFINE_FUNCTION,
+    OP_GOTO, // jump inserted by translator, not counted as executed action
+    OP_END,
+    // superinstructions produced by optimize_code()
+    OP_IF_NOT, OP_PUSH_GET_VARIABLE,
+    NUM_OPS
+};
+
+enum { PUSH_VALUE, PUSH_REGISTER, PUSH_CONSTANT, PUSH_INVALID };
+
+typedef struct ASTranslator
+{
+    ASCode *code;
+    const uint8_t *actions;
+    int32_t *map; // byte offset -> instruction index
+    int size, alloc_insns, num_operands, alloc_operands;
+} ASTranslator;
+
+static ASInsn *emit_insn(ASTranslator *tr, int op, int action)
+{
+    ASCode *code = tr->code;
+    if (code->num_insns >= tr->alloc_insns)
+    {
+        tr->alloc_insns = tr->alloc_insns ? tr->alloc_insns*2 : 64;
+        code->insns = realloc(code->insns, tr->alloc_insns*sizeof(ASInsn));
+    }
+    ASInsn *insn = code->insns + code->num_insns++;
+    memset(insn, 0, sizeof(*insn));
+    insn->op     = op;
+    insn->action = action;
+    insn->cost   = (OP_GOTO == op || OP_END == op) ? 0 : 1;
+    return insn;
 }
 
-void lvgExecuteActions(LVGActionCtx *ctx, uint8_t *actions, LVGMovieClipGroupState *groupstate, int is_function)
+static ASPushOperand *emit_operand(ASTranslator *tr)
 {
-    if (!actions)
+    if (tr->num_operands >= tr->alloc_operands)
+    {
+        tr->alloc_operands = tr->alloc_operands ? tr->alloc_operands*2 : 64;
+        tr->code->operands = realloc(tr->code->operands, tr->alloc_operands*sizeof(ASPushOperand));
+    }
+    ASPushOperand *o = tr->code->operands + tr->num_operands++;
+    memset(o, 0, sizeof(*o));
+    return o;
+}
+
+static void translate_push(ASTranslator *tr, ASInsn *insn, const uint8_t *a)
+{
+    int len = *(uint16_t*)a;
+    const uint8_t *data = a + 2;
+    insn->target = tr->num_operands;
+    do {
+        ASPushOperand *o = emit_operand(tr);
+        ASVal *v = &o->val;
+        int size = 0, type = *data;
+        insn->nargs++;
+        switch(type)
+        {
+        case 0: v->type = ASVAL_STRING; v->str = (const char*)data + 1; v->atom = atom_intern(v->str); size = strlen(v->str) + 1; break;
+        case 1: v->type = ASVAL_FLOAT; v->f_int = read_float(data + 1); size = 4; break;
+        case 2: v->type = ASVAL_NULL; break;
+        case 3: v->type = ASVAL_UNDEFINED; break;
+        case 4: o->kind = PUSH_REGISTER; o->index = data[1]; size = 1; break;
+        case 5: v->type = ASVAL_BOOL; v->boolean = data[1] ? 1 : 0; size = 1; break;
+        case 6: v->type = ASVAL_DOUBLE; v->d_int = read_double(data + 1); size = 8; break;
+        case 7: v->type = ASVAL_INT; v->ui32 = *(uint32_t*)(data + 1); size = 4; break;
+        case 8: o->kind = PUSH_CONSTANT; o->index = data[1]; size = 1; break;
+        case 9: o->kind = PUSH_CONSTANT; o->index = *(uint16_t*)(data + 1); size = 2; break;
+        default:
+            o->kind = PUSH_INVALID;
+            return;
+        }
+        len -= size + 1;
+        data += size + 1;
+    } while (len > 0);
+}
+
+static int translate_from(ASTranslator *tr, int pc)
+{   // decodes actions starting at byte offset pc until already decoded action or end is reached
+    int start = tr->code->num_insns;
+    while (pc < tr->size)
+    {
+        if (tr->map[pc] >= 0)
+        {
+            emit_insn(tr, OP_GOTO, ACTION_END)->target = tr->map[pc];
+            return start;
+        }
+        tr->map[pc] = tr->code->num_insns;
+        Actions a = tr->actions[pc++];
+        int len = 0;
+        if (a >= 0x80)
+            len = *(uint16_t*)(tr->actions + pc) + 2;
+        uint8_t *opdata = (uint8_t *)&tr->actions[pc];
+        pc += len;
+        ASInsn *insn;
+        switch (a)
+        {
+        case ACTION_PUSH:
+            insn = emit_insn(tr, OP_PUSH, a);
+            translate_push(tr, insn, opdata);
+            break;
+        case ACTION_JUMP:
+            insn = emit_insn(tr, OP_JUMP, a);
+            insn->target = pc + (int8_t)*(uint16_t *)(opdata + 2);
+            break;
+        case ACTION_IF:
+            insn = emit_insn(tr, OP_IF, a);
+            insn->target = pc + *(int16_t *)(opdata + 2);
+            break;
+        case ACTION_DEFINE_FUNCTION:
+        case ACTION_DEFINE_FUNCTION2:
+            insn = emit_insn(tr, OP_DEFINE_FUNCTION, a);
+            insn->vm_func = g_avm1_actions[a].vm_func;
+            insn->target  = pc + *(uint16_t *)function_body(opdata, a);
+            break;
+        default:
+            insn = emit_insn(tr, g_avm1_actions[a].vm_func ? OP_CALL : OP_NOP, a);
+            insn->vm_func = g_avm1_actions[a].vm_func;
+        }
+        insn->a = opdata;
+    }
+    emit_insn(tr, OP_END, ACTION_END);
+    return start;
+}
+
+static int fold_inputs(int action)
+{   // number of stack inputs of actions which are pure functions of numeric arguments
+    switch (action)
+    {
+    case ACTION_NOT: case ACTION_TO_INTEGER: case ACTION_TO_NUMBER: case ACTION_INCREMENT: case ACTION_DECREMENT:
+        return 1;
+    case ACTION_ADD: case ACTION_SUBTRACT: case ACTION_MULTIPLY: case ACTION_DIVIDE: case ACTION_EQUALS: case ACTION_LESS:
+    case ACTION_AND: case ACTION_OR: case ACTION_ADD2: case ACTION_LESS2: case ACTION_EQUALS2: case ACTION_MODULO:
+    case ACTION_BIT_AND: case ACTION_BIT_OR: case ACTION_BIT_XOR: case ACTION_BIT_LSHIFT: case ACTION_BIT_RSHIFT:
+    case ACTION_BIT_URSHIFT: case ACTION_STRICT_EQUALS:
+        return 2;
+    }
+    return 0;
+}
+
+static int is_number_literal(const ASPushOperand *o)
+{
+    return PUSH_VALUE == o->kind && (ASVAL_INT == o->val.type || ASVAL_DOUBLE == o->val.type || ASVAL_FLOAT == o->val.type);
+}
+
+static int fold_constant(LVGActionCtx *ctx, ASInsn *op, const ASPushOperand *args, int nargs, ASVal *res)
+{   // runs action handler itself on free stack slots, so folded value is exactly what interpreter would produce
+    int stack_ptr = ctx->stack_ptr, do_exit = ctx->do_exit, ok;
+    if (stack_ptr < nargs + 1)
+        return 0;
+    for (int i = 0; i < nargs; i++)
+    {
+        stack_push(ctx);
+        ctx->stack[ctx->stack_ptr] = args[i].val;
+    }
+    op->vm_func(ctx, op->a);
+    *res = ctx->stack[ctx->stack_ptr];
+    ok = !ctx->do_exit && (stack_ptr - 1) == ctx->stack_ptr && !res->is_dynamic;
+    if (ctx->stack_ptr < stack_ptr)
+        stack_pop(ctx, stack_ptr - ctx->stack_ptr);
+    ctx->do_exit = do_exit;
+    return ok;
+}
+
+static int fuse_insns(LVGActionCtx *ctx, ASTranslator *tr, ASInsn *p, ASInsn *x)
+{   // tries to merge x into preceding instruction p, x is reachable only through p
+    ASCode *code = tr->code;
+    if ((p->cost + x->cost) > 0xffff)
+        return 0;
+    if (OP_NOP == p->op && OP_GOTO != x->op && OP_END != x->op)
+    {
+        int cost = p->cost;
+        *p = *x;
+        p->cost += cost;
+        return 1;
+    }
+    if (OP_PUSH == p->op && (OP_PUSH == x->op || OP_PUSH_GET_VARIABLE == x->op))
+    {   // push a; push b -> push a, b
+        if (PUSH_INVALID == code->operands[p->target + p->nargs - 1].kind)
+            return 0;
+        if ((p->nargs + x->nargs) > 0xffff)
+            return 0;
+        if ((p->target + p->nargs) != x->target)
+        {   // operands are not adjacent - copy both runs to the end
+            int start = tr->num_operands;
+            for (int i = 0; i < p->nargs; i++)
+            {   // emit_operand can move operands, copy before it
+                ASPushOperand o = code->operands[p->target + i];
+                *emit_operand(tr) = o;
+            }
+            for (int i = 0; i < x->nargs; i++)
+            {
+                ASPushOperand o = code->operands[x->target + i];
+                *emit_operand(tr) = o;
+            }
+            p->target = start;
+        }
+        p->nargs += x->nargs;
+        p->cost  += x->cost;
+        p->op     = x->op;
+        return 1;
+    }
+    if (OP_PUSH == p->op && OP_CALL == x->op)
+    {
+        ASPushOperand *last = code->operands + p->target + p->nargs - 1;
+        int i, nargs = fold_inputs(x->action);
+        if (nargs && p->nargs >= nargs)
+        {   // push 1, 2; add -> push 3
+            ASVal res;
+            for (i = 0; i < nargs; i++)
+                if (!is_number_literal(last - i))
+                    return 0;
+            if (!fold_constant(ctx, x, last - (nargs - 1), nargs, &res))
+                return 0;
+            last -= nargs - 1;
+            memset(last, 0, sizeof(*last));
+            last->val = res;
+            p->nargs -= nargs - 1;
+            p->cost  += x->cost;
+            return 1;
+        }
+        if (ACTION_POP == x->action && (PUSH_VALUE == last->kind || PUSH_CONSTANT == last->kind))
+        {   // push a, b; pop -> push a
+            if (!--p->nargs)
+                p->op = OP_NOP;
+            p->cost += x->cost;
+            return 1;
+        }
+        if (ACTION_GET_VARIABLE == x->action && ((PUSH_VALUE == last->kind && ASVAL_STRING == last->val.type) || PUSH_CONSTANT == last->kind))
+        {   // push "name"; getVariable -> lookup by atom without string on stack
+            p->op    = OP_PUSH_GET_VARIABLE;
+            p->a     = x->a;
+            p->cost += x->cost;
+            return 1;
+        }
+        return 0;
+    }
+    if (OP_CALL == p->op && ACTION_NOT == p->action && (OP_IF == x->op || OP_IF_NOT == x->op))
+    {   // not; if -> if_not, not; not; if -> if
+        p->op     = (OP_IF == x->op) ? OP_IF_NOT : OP_IF;
+        p->target = x->target;
+        p->cost  += x->cost;
+        return 1;
+    }
+    return 0;
+}
+
+static void optimize_code(LVGActionCtx *ctx, ASTranslator *tr)
+{
+    ASCode *code = tr->code;
+    int i, n = code->num_insns, num_kept = 0;
+    if (n < 2)
         return;
-    int execution_budget = 1000000; // limit execution time
-    ctx->groupstate = groupstate;
-    ctx->group  = ctx->clip->groups + groupstate->group_num;
-    ctx->frame  = ctx->group->frames + groupstate->cur_frame;
+    uint8_t *is_target = calloc(n, 1);
+    int32_t *kept = malloc(n*sizeof(int32_t)), *remap = malloc(n*sizeof(int32_t));
+    is_target[0] = 1;
+    for (i = 0; i < n; i++)
+    {
+        int op = code->insns[i].op;
+        if (OP_JUMP == op || OP_IF == op || OP_DEFINE_FUNCTION == op || OP_GOTO == op)
+            is_target[code->insns[i].target] = 1;
+    }
+    for (i = 0; i < n; i++)
+    {
+        remap[i] = -1;
+        kept[num_kept++] = i;
+        // fuse backwards while fused instruction can be reached only by falling through
+        while (num_kept >= 2 && !is_target[kept[num_kept - 1]] &&
+            fuse_insns(ctx, tr, code->insns + kept[num_kept - 2], code->insns + kept[num_kept - 1]))
+        {
+            is_target[kept[num_kept - 2]] |= is_target[kept[num_kept - 1]];
+            num_kept--;
+        }
+    }
+    for (i = 0; i < num_kept; i++)
+    {
+        code->insns[i] = code->insns[kept[i]];
+        remap[kept[i]] = i;
+    }
+    for (i = n - 1; i >= 0; i--)
+        if (remap[i] < 0)
+            remap[i] = (i + 1) < n ? remap[i + 1] : num_kept - 1;
+    for (i = 0; i < num_kept; i++)
+    {
+        int op = code->insns[i].op;
+        if (OP_JUMP == op || OP_IF == op || OP_IF_NOT == op || OP_DEFINE_FUNCTION == op || OP_GOTO == op)
+            code->insns[i].target = remap[code->insns[i].target];
+    }
+    code->num_insns = num_kept;
+    free(is_target);
+    free(kept);
+    free(remap);
+}
+
+static ASCode *translate_actions(LVGActionCtx *ctx, const uint8_t *src, int is_function)
+{
+    ASTranslator tr;
+    memset(&tr, 0, sizeof(tr));
+    tr.code = calloc(1, sizeof(ASCode));
+    tr.code->src = src;
     if (is_function)
     {
-        ctx->size = *(uint16_t*)actions;
-        actions += 2;
-        // TODO: use DEFINEFUNCTION2 flags
-        ctx->regs[1] = *search_var(ctx, "_root");
+        tr.size = *(uint16_t*)src;
+        tr.actions = src + 2;
     } else
     {
-        ctx->size = *(uint32_t*)actions;
-        actions += 4;
+        tr.size = *(uint32_t*)src;
+        tr.actions = src + 4;
     }
-    ctx->actions = actions;
-    ctx->pc = 0;
-restart:
-    for (; ctx->pc < ctx->size;)
+    tr.map = malloc(tr.size*sizeof(int32_t));
+    for (int i = 0; i < tr.size; i++)
+        tr.map[i] = -1;
+    translate_from(&tr, 0);
+    // resolve byte offset targets, decoding more code if target lands inside of some action
+    int end = tr.code->num_insns - 1;
+    for (int i = 0; i < tr.code->num_insns; i++)
     {
-        Actions a = actions[ctx->pc++];
-        int len = 0;
-        if (a >= 0x80)
-            len = *(uint16_t*)(actions + ctx->pc) + 2;
-        const ActionEntry *ae = &g_avm1_actions[a];
-        uint8_t *opdata = &actions[ctx->pc];
-        ctx->pc += len;
-#if defined(_DEBUG) && !defined(_TEST)
-        printf("AS2: s%d %s(", ctx->stack_ptr, ae->name);
-        int i, stack_ptr = ctx->stack_ptr;
-        if (ae->npop_params > 0)
+        ASInsn *insn = tr.code->insns + i;
+        if (OP_JUMP != insn->op && OP_IF != insn->op && OP_DEFINE_FUNCTION != insn->op)
+            continue;
+        int pc = insn->target, target = end;
+        if (pc >= 0 && pc < tr.size)
+            target = tr.map[pc] >= 0 ? tr.map[pc] : translate_from(&tr, pc);
+        tr.code->insns[i].target = target; // translate_from() may realloc insns
+    }
+#ifdef _TEST
+    for (int i = 0; i < tr.code->num_insns; i++)
+        ctx->num_actions += tr.code->insns[i].cost;
+#endif
+    if (!ctx->e || !ctx->e->b_no_avm1_optimize)
+        optimize_code(ctx, &tr);
+#ifdef _TEST
+    ctx->num_insns += tr.code->num_insns;
+#endif
+    // extra end instruction past num_insns, return action sets pc = size
+    emit_insn(&tr, OP_END, ACTION_END);
+    tr.code->num_insns--;
+    free(tr.map);
+    return tr.code;
+}
+
+static ASCode *get_code(LVGActionCtx *ctx, const uint8_t *src, int is_function)
+{
+    uint32_t i;
+    if (ctx->codes)
+        for (i = ((uintptr_t)src >> 2)*2654435761u & ctx->codes_mask; ctx->codes[i]; i = (i + 1) & ctx->codes_mask)
+            if (ctx->codes[i]->src == src)
+                return ctx->codes[i];
+    if ((ctx->num_codes + 1)*2 > ctx->codes_mask)
+    {
+        ASCode **old = ctx->codes;
+        int old_size = old ? ctx->codes_mask + 1 : 0;
+        ctx->codes_mask = old_size ? old_size*2 - 1 : 63;
+        ctx->codes = calloc(ctx->codes_mask + 1, sizeof(ASCode *));
+        for (int j = 0; j < old_size; j++)
         {
-            for (i = 0; i < ae->npop_params; i++)
+            if (!old[j])
+                continue;
+            for (i = ((uintptr_t)old[j]->src >> 2)*2654435761u & ctx->codes_mask; ctx->codes[i]; i = (i + 1) & ctx->codes_mask);
+            ctx->codes[i] = old[j];
+        }
+        if (old)
+            free(old);
+    }
+    for (i = ((uintptr_t)src >> 2)*2654435761u & ctx->codes_mask; ctx->codes[i]; i = (i + 1) & ctx->codes_mask);
+    ctx->num_codes++;
+    return ctx->codes[i] = translate_actions(ctx, src, is_function);
+}
+
+static inline void push_operands(LVGActionCtx *ctx, const ASPushOperand *o, int nargs)
+{
+    for (int i = 0; i < nargs; i++, o++)
+    {
+        stack_push(ctx);
+        ASVal *se = &ctx->stack[ctx->stack_ptr];
+        switch (o->kind)
+        {
+        case PUSH_VALUE: *se = o->val; break;
+        case PUSH_REGISTER: *se = ctx->regs[o->index]; val_retain(se); break;
+        case PUSH_CONSTANT:
+            if (o->index >= ctx->cpool_size)
             {
-                ASVal *val = &ctx->stack[ctx->stack_ptr + i];
-                if (ASVAL_STRING == val->type)
-                    printf((i + 1) == ae->npop_params ? "\"%s\"" : "\"%s\", ", as_var_to_str(ctx, val));
-                else
-                    printf((i + 1) == ae->npop_params ? "%s" : "%s, ", as_var_to_str(ctx, val));
+                SET_UNDEF(se);
+                break;
             }
-        } else
-            printf("...");
-        printf(") = "); fflush(stdout);
-#endif
-        if (ae->vm_func)
-            ae->vm_func(ctx, opdata);
+            se->type = ASVAL_STRING; se->str = ctx->cpool[o->index]; se->atom = ctx->cpool_atoms[o->index];
+            break;
+        default:
+            assert(0); ctx->do_exit = 1;
+        }
+    }
+}
+
 #if defined(_DEBUG) && !defined(_TEST)
-        int npush_params = ae->npush_params > 0 ? ae->npush_params : 0;
-        if (ae->npush_params < 0)
-            npush_params = stack_ptr - ctx->stack_ptr;
-        for (i = 0; i < npush_params; i++)
+static void debug_action_args(LVGActionCtx *ctx, const ActionEntry *ae)
+{
+    printf("AS2: s%d %s(", ctx->stack_ptr, ae->name);
+    if (ae->npop_params > 0)
+    {
+        for (int i = 0; i < ae->npop_params; i++)
         {
             ASVal *val = &ctx->stack[ctx->stack_ptr + i];
             if (ASVAL_STRING == val->type)
-                printf((i + 1) == npush_params ? "\"%s\"" : "\"%s\", ", as_var_to_str(ctx, val));
+                printf((i + 1) == ae->npop_params ? "\"%s\"" : "\"%s\", ", as_var_to_str(ctx, val));
             else
-                printf((i + 1) == npush_params ? "%s" : "%s, ", as_var_to_str(ctx, val));
+                printf((i + 1) == ae->npop_params ? "%s" : "%s, ", as_var_to_str(ctx, val));
         }
-        printf(" stack=%d\n", ctx->stack_ptr); fflush(stdout);
+    } else
+        printf("...");
+    printf(") = "); fflush(stdout);
+}
+
+static void debug_action_result(LVGActionCtx *ctx, const ActionEntry *ae, int stack_ptr)
+{
+    int npush_params = ae->npush_params > 0 ? ae->npush_params : 0;
+    if (ae->npush_params < 0)
+        npush_params = stack_ptr - ctx->stack_ptr;
+    for (int i = 0; i < npush_params; i++)
+    {
+        ASVal *val = &ctx->stack[ctx->stack_ptr + i];
+        if (ASVAL_STRING == val->type)
+            printf((i + 1) == npush_params ? "\"%s\"" : "\"%s\", ", as_var_to_str(ctx, val));
+        else
+            printf((i + 1) == npush_params ? "%s" : "%s, ", as_var_to_str(ctx, val));
+    }
+    printf(" stack=%d\n", ctx->stack_ptr); fflush(stdout);
+}
+#define DEBUG_ACTION_BEGIN int stack_ptr = ctx->stack_ptr; debug_action_args(ctx, &g_avm1_actions[insn->action]);
+#define DEBUG_ACTION_END debug_action_result(ctx, &g_avm1_actions[insn->action], stack_ptr);
+#else
+#define DEBUG_ACTION_BEGIN
+#define DEBUG_ACTION_END
 #endif
-        if (ctx->do_exit)
-            break;
-        if (!--execution_budget)
+
+#ifdef __GNUC__
+#define VM_DISPATCH goto *dispatch[insn->op];
+#define VM_SWITCH VM_DISPATCH
+#define VM_CASE(op) L_##op:
+#else
+#define VM_DISPATCH goto dispatch;
+#define VM_SWITCH dispatch: switch (insn->op)
+#define VM_CASE(op) case op:
+#endif
+#define VM_FETCH insn = ctx->code->insns + ctx->pc++;
+#define VM_NEXT \
+    if (ctx->do_exit) \
+        goto done; \
+    if ((execution_budget -= insn->cost) <= 0) \
+    { \
+        printf("error: execution limit reached\n"); \
+        goto done; \
+    } \
+    VM_FETCH VM_DISPATCH
+
+void lvgExecuteActions(LVGActionCtx *ctx, uint8_t *actions, LVGMovieClipGroupState *groupstate, int is_function)
+{
+    if (!actions)
+        return;
+    PROF_SCOPE(PROF_ACTIONS);
+    int execution_budget = 1000000; // limit execution time
+    ctx->groupstate = groupstate;
+    ctx->group  = ctx->clip->groups + groupstate->group_num;
+    ctx->frame  = ctx->group->frames + groupstate->cur_frame;
+    if (is_function)
+    {   // TODO: use DEFINEFUNCTION2 flags
+        ctx->regs[1] = *search_var_atom(ctx, g_atoms[ATOM_ROOT]);
+    }
+#ifdef _TEST
+    struct timespec ts0, ts1;
+    clock_gettime(CLOCK_MONOTONIC, &ts0);
+#endif
+#ifdef __GNUC__
+    static const void *dispatch[NUM_OPS] = {
+        &&L_OP_NOP, &&L_OP_CALL, &&L_OP_PUSH, &&L_OP_JUMP, &&L_OP_IF, &&L_OP_DEFINE_FUNCTION, &&L_OP_GOTO, &&L_OP_END,
+        &&L_OP_IF_NOT, &&L_OP_PUSH_GET_VARIABLE
+    };
+#endif
+    ctx->code = get_code(ctx, actions, is_function);
+    ctx->pc   = 0;
+    ctx->size = ctx->code->num_insns;
+    ASInsn *insn;
+    VM_FETCH
+    VM_SWITCH
+    {
+    VM_CASE(OP_NOP)
+        VM_NEXT
+    VM_CASE(OP_CALL)
+    {
+        DEBUG_ACTION_BEGIN
+        insn->vm_func(ctx, insn->a);
+        DEBUG_ACTION_END
+        VM_NEXT
+    }
+    VM_CASE(OP_PUSH)
+    {
+        DEBUG_ACTION_BEGIN
+        push_operands(ctx, ctx->code->operands + insn->target, insn->nargs);
+        DEBUG_ACTION_END
+        VM_NEXT
+    }
+    VM_CASE(OP_JUMP)
+        ctx->pc = insn->target;
+        VM_NEXT
+    VM_CASE(OP_IF)
+    {
+        ASVal *se_cond = &ctx->stack[ctx->stack_ptr];
+        double cond = to_double(ctx, se_cond);
+        if (0.0 != cond)
+            ctx->pc = insn->target;
+        stack_pop(ctx, 1);
+        VM_NEXT
+    }
+    VM_CASE(OP_IF_NOT)
+    {
+        ASVal *se_cond = &ctx->stack[ctx->stack_ptr];
+        double cond = to_double(ctx, se_cond);
+        if (0.0 == cond)
+            ctx->pc = insn->target;
+        stack_pop(ctx, 1);
+        VM_NEXT
+    }
+    VM_CASE(OP_PUSH_GET_VARIABLE)
+    {
+        ASPushOperand *name = ctx->code->operands + insn->target + insn->nargs - 1;
+        ASAtom *atom = 0;
+        push_operands(ctx, name - (insn->nargs - 1), insn->nargs - 1);
+        if (PUSH_VALUE == name->kind)
+            atom = name->val.atom;
+        else if (name->index < ctx->cpool_size)
+            atom = ctx->cpool_atoms[name->index];
+        if (!atom)
         {
-            printf("error: execution limit reached\n");
-            return;
+            push_operands(ctx, name, 1);
+            action_get_variable(ctx, insn->a);
+            VM_NEXT
         }
+        ASVal *var = search_var_atom(ctx, atom);
+        stack_push(ctx);
+        ASVal *res = &ctx->stack[ctx->stack_ptr];
+        if (var)
+        {
+            *res = *var;
+            val_retain(res);
+        } else
+            SET_UNDEF(res);
+        VM_NEXT
     }
-    if (ctx->call_depth && !ctx->do_exit)
-    {
+    VM_CASE(OP_DEFINE_FUNCTION)
+        insn->vm_func(ctx, insn->a);
+        ctx->pc = insn->target;
+        VM_NEXT
+    VM_CASE(OP_GOTO)
+        ctx->pc = insn->target;
+        VM_FETCH VM_DISPATCH
+    VM_CASE(OP_END)
+        if (!ctx->call_depth || ctx->do_exit)
+            goto done;
         ctx->call_depth--;
+        ctx->code = ctx->calls[ctx->call_depth].save_code;
         ctx->pc   = ctx->calls[ctx->call_depth].save_pc;
         ctx->size = ctx->calls[ctx->call_depth].save_size;
         THIS = ctx->calls[ctx->call_depth].save_this;
@@ -1879,6 +2780,13 @@ restart:
             SET_UNDEF(&ctx->stack[ctx->stack_ptr]);
         }
         g_properties[0].val.type = THIS ? ASVAL_CLASS : ASVAL_UNDEFINED;
-        goto restart;
+        VM_FETCH VM_DISPATCH
     }
+done:
+#ifdef _TEST
+    clock_gettime(CLOCK_MONOTONIC, &ts1);
+    ctx->exec_time += (ts1.tv_sec - ts0.tv_sec)*1000000000LL + (ts1.tv_nsec - ts0.tv_nsec);
+    ctx->num_ops += 1000000 - execution_budget;
+#endif
+    return;
 }
@@ -3,7 +3,7 @@
 #include <src/lvg.h>
 
 #define STACK_SIZE 4096
-#define SET_STRING(se, string) { (se)->type = ASVAL_STRING; (se)->str = string; }
+#define SET_STRING(se, string) { (se)->type = ASVAL_STRING; (se)->str = string; (se)->atom = 0; (se)->is_dynamic = 0; }
 #define SET_DOUBLE(se, number) { (se)->type = ASVAL_DOUBLE; (se)->d_int = number; }
 #define SET_INT(se, number)    { (se)->type = ASVAL_INT;    (se)->i32 = number; }
 #define SET_BOOL(se, value)    { (se)->type = ASVAL_BOOL;   (se)->boolean = value; }
@@ -123,6 +123,16 @@ typedef enum {
 } ASValType;
 
 typedef struct ASClass ASClass;
+
+typedef struct ASAtom
+{   // interned identifier, compared by pointer
+    const char *str;
+    struct ASAtom *fold; // lower case atom, used for SWF < 7 identifiers
+    struct ASAtom *next;
+    uint32_t hash;
+    int dynamic;         // name built at runtime: not interned, compared by string
+} ASAtom;
+
 typedef void (*as_native_fn)(LVGActionCtx *ctx, ASClass *cls, uint8_t *a, uint32_t nargs);
 
 typedef struct ASVal
@@ -139,12 +149,14 @@ typedef struct ASVal
     };
     ASValType type;
     char is_dynamic;
+    ASAtom *atom;        // cached atom of string value
 } ASVal;
 
 typedef struct ASMember
 {
     const char *name;
     ASVal val;
+    ASAtom *atom;
 } ASMember;
 
 typedef struct ASClass
@@ -153,11 +165,81 @@ typedef struct ASClass
     ASMember *members;
     void *priv;
     int num_members, ref_count;
+    uint32_t gc_mark;    // equals collector epoch when reached in current cycle
+    uint8_t gc_free_priv;
+    ASAtom *atom;
 } ASClass;
 
+typedef struct ASConstantPool
+{
+    const uint8_t *src;
+    ASAtom **atoms;
+    int size;
+} ASConstantPool;
+
+typedef struct ASPushOperand
+{
+    ASVal val;           // pre-parsed literal
+    uint16_t index;      // register or constant pool index
+    uint8_t kind;
+} ASPushOperand;
+
+typedef struct ASInsn
+{   // pre-decoded action
+    void (*vm_func)(LVGActionCtx *ctx, uint8_t *a);
+    uint8_t *a;          // original operand data for generic handlers
+    int32_t target;      // jump target / first push operand
+    uint16_t nargs;
+    uint16_t cost;       // number of source actions this instruction executes
+    uint8_t op, action;
+} ASInsn;
+
+typedef struct ASCode
+{   // action block translated on first execution
+    const uint8_t *src;
+    ASInsn *insns;
+    ASPushOperand *operands;
+    int num_insns;
+} ASCode;
+
+enum {
+    ATOM_ROOT, ATOM_CURRENTFRAME, ATOM_TOTALFRAMES, ATOM_FRAMESLOADED, ATOM_VISIBLE, ATOM_ALPHA, ATOM_ONENTERFRAME, ATOM_CACHEASBITMAP,
+    NUM_ATOMS
+};
+
+#define STRING_CLASSES 8       // arena block sizes 16 << n, larger strings use malloc
+#define STRING_CHUNK_SIZE 65536
+
+typedef struct ASStringArena
+{   // per VM storage of dynamic (is_dynamic) strings, shared by reference counting
+    char *free_blocks[STRING_CLASSES];
+    void *chunks;
+    char *cur, *end;
+#ifdef _TEST
+    int64_t num_allocs, num_heap_allocs;
+#endif
+} ASStringArena;
+
+#define GC_STEP_WORK 2048      // members scanned or objects swept per frame step
+#define GC_MIN_THRESHOLD 256   // heap objects before first cycle starts
+
+enum { GC_IDLE, GC_MARK, GC_SWEEP };
+
+typedef struct ASCollector
+{   // incremental mark and sweep over instances created by scripts
+    ASClass **gray;
+    int num_gray, max_gray, max_objects;
+    int phase, sweep_pos, sweep_end, sweep_live, threshold;
+    uint32_t epoch;
+#ifdef _TEST
+    int64_t num_cycles, num_freed, peak_objects, pause_time, max_pause;
+#endif
+} ASCollector;
+
 typedef struct LVGActionCall
 {
     ASClass *save_this;
+    struct ASCode *save_code;
     int save_pc;
     int save_size;
     int save_stack_ptr;
@@ -174,9 +256,19 @@ typedef struct LVGActionCtx
     ASVal regs[256];
     LVGActionCall calls[256];
     const char **cpool;
+    ASAtom **cpool_atoms;
+    ASConstantPool *cpools;  // atoms of each constant pool, interned on first execution
+    ASStringArena strings;
+    ASCollector gc;
+    ASCode **codes;          // open addressing hash of translated action blocks
+    ASCode *code;
     uint8_t *actions;
-    ASClass **allocated_calsses;
-    int size, version, stack_ptr, cpool_size, pc, call_depth, do_exit, num_allocated_calsses;
+    ASClass **allocated_calsses; // collector heap
+    ASAtom *dynamic_atoms;   // names of members created from runtime strings, freed with vm
+    int size, version, stack_ptr, cpool_size, pc, call_depth, do_exit, num_allocated_calsses, num_cpools, num_codes, codes_mask;
+#ifdef _TEST
+    int64_t num_lookups, num_ops, exec_time, num_actions, num_insns;
+#endif
 } LVGActionCtx;
 
 extern ASVal g_classes[];
@@ -186,6 +278,7 @@ extern int g_num_properties;
 extern ASClass g_movieclip;
 extern ASClass g_button;
 extern ASClass g_string;
+extern ASAtom *g_atoms[NUM_ATOMS];
 
 void stack_push(LVGActionCtx *ctx);
 void stack_pop(LVGActionCtx *ctx, int n);
@@ -194,9 +287,13 @@ double to_double(LVGActionCtx *ctx, ASVal *v);
 int32_t to_int(ASVal *v);
 ASClass *to_object(LVGActionCtx *ctx, ASVal *v);
 int strcmp_identifier(LVGActionCtx *ctx, const char *s1, const char *s2);
+ASAtom *atom_intern(const char *str);
 ASVal *search_var(LVGActionCtx *ctx, const char *name);
+ASVal *search_var_atom(LVGActionCtx *ctx, ASAtom *atom);
 ASVal *find_class_member(LVGActionCtx *ctx, ASClass *c, const char *name);
+ASVal *find_class_member_atom(LVGActionCtx *ctx, ASClass *c, ASAtom *atom);
 ASVal *create_local(LVGActionCtx *ctx, ASClass *c, const char *name);
+ASVal *create_local_atom(LVGActionCtx *ctx, ASClass *c, ASAtom *atom);
 ASClass *create_instance(LVGActionCtx *ctx, ASClass *base);
 void free_instance(ASClass *cls);
 void handle_frame_change(LVGActionCtx *ctx, LVGMovieClipGroupState *groupstate);
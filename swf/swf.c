@@ -1,8 +1,10 @@
 #include <assert.h>
 #include <limits.h>
+#include <time.h>
 #include <rfxswf.h>
 #include <stb_image.h>
 #include <lvg.h>
+#include <jobs.h>
 #include "adpcm.h"
 #include "avm1.h"
 
@@ -15,6 +17,135 @@ typedef struct
     enum CHARACTER_TYPE type;
 } character_t;
 
+typedef struct arena_block
+{
+    struct arena_block *next;
+    size_t size, used;
+    char data[] __attribute__((aligned(16)));
+} arena_block;
+
+typedef struct shape_arena
+{   // per clip load scratch memory for shape parsing
+    arena_block *blocks, *cur;  // bump allocator for subpaths, reset after each style flush
+    LINE *lines, *lines2;       // edges of current subpath (lines2 - morph end shape)
+    NSVGshape *shapes, *shapes2;
+    int lines_size, lines2_size, shapes_size, shapes2_size;
+} shape_arena;
+
+#define ARENA_BLOCK_SIZE (256*1024)
+
+static void *arena_alloc(shape_arena *a, size_t size)
+{
+    size = (size + 15) & ~(size_t)15;
+    while (a->cur && (a->cur->used + size) > a->cur->size)
+        a->cur = a->cur->next;
+    if (!a->cur)
+    {
+        size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        arena_block *b = (arena_block *)malloc(sizeof(arena_block) + block_size);
+        b->next = 0;
+        b->size = block_size;
+        b->used = 0;
+        arena_block **last = &a->blocks;
+        while (*last)
+            last = &(*last)->next;
+        *last = a->cur = b;
+    }
+    void *p = a->cur->data + a->cur->used;
+    a->cur->used += size;
+    return p;
+}
+
+static void arena_reset(shape_arena *a)
+{
+    for (arena_block *b = a->blocks; b; b = b->next)
+        b->used = 0;
+    a->cur = a->blocks;
+}
+
+static void arena_free(shape_arena *a)
+{
+    arena_block *b = a->blocks;
+    while (b)
+    {
+        arena_block *next = b->next;
+        free(b);
+        b = next;
+    }
+    if (a->lines)
+        free(a->lines);
+    if (a->lines2)
+        free(a->lines2);
+    if (a->shapes)
+        free(a->shapes);
+    if (a->shapes2)
+        free(a->shapes2);
+    memset(a, 0, sizeof(*a));
+}
+
+static LINE *arena_grow_lines(LINE **lines, int *size, int min_size)
+{
+    if (*size >= min_size)
+        return *lines;
+    int new_size = *size ? *size : 4096;
+    while (new_size < min_size)
+        new_size *= 2;
+    *lines = (LINE *)realloc(*lines, new_size*sizeof(LINE));
+    *size = new_size;
+    return *lines;
+}
+
+static NSVGshape *arena_grow_shapes(NSVGshape **shapes, int *size, int min_size)
+{
+    if (*size >= min_size)
+        return *shapes;
+    int new_size = *size ? *size : 64;
+    while (new_size < min_size)
+        new_size *= 2;
+    *shapes = (NSVGshape *)realloc(*shapes, new_size*sizeof(NSVGshape));
+    *size = new_size;
+    return *shapes;
+}
+
+static SUBPATH *arena_add_subpath(shape_arena *a, SUBPATH **subpaths, int *num_subpaths)
+{   // grow by doubling, old array stays in arena until reset
+    int n = *num_subpaths;
+    if (!(n & (n - 1)))
+    {
+        SUBPATH *s = (SUBPATH *)arena_alloc(a, (n ? n*2 : 1)*sizeof(SUBPATH));
+        if (n)
+            memcpy(s, *subpaths, n*sizeof(SUBPATH));
+        *subpaths = s;
+    }
+    (*num_subpaths)++;
+    return *subpaths + n;
+}
+
+static void arena_reset_subpaths(shape_arena *a, SHAPE2 *swf_shape)
+{   // subpaths live in arena, drop references instead of swf_ShapeFreeSubpaths()
+    int i;
+    for (i = 0; i < swf_shape->numfillstyles; i++)
+    {
+        swf_shape->fillstyles[i].subpaths = 0;
+        swf_shape->fillstyles[i].num_subpaths = 0;
+    }
+    for (i = 0; i < swf_shape->numlinestyles; i++)
+    {
+        swf_shape->linestyles[i].subpaths = 0;
+        swf_shape->linestyles[i].num_subpaths = 0;
+    }
+    arena_reset(a);
+}
+
+static NSVGshape *arena_finish_shapes(NSVGshape *scratch, int num_shapes)
+{   // final shape storage with exact size
+    if (!num_shapes)
+        return 0;
+    NSVGshape *shapes = (NSVGshape*)malloc(num_shapes*sizeof(NSVGshape));
+    memcpy(shapes, scratch, num_shapes*sizeof(NSVGshape));
+    return shapes;
+}
+
 
 static void path_addPoint(NSVGpath *p, float x, float y)
 {
@@ -291,7 +422,6 @@ start_new:
         }
         append = 1;
     }
-    e->render->cache_shape(e->render_obj, shape);
 }
 
 static void add_playsound_action(LVGMovieClipGroup *group, int frame_num, int sound_id, int flags, int start_sample, int end_sample, int loops)
@@ -384,24 +514,23 @@ static void parse_button_record(TAG *tag, LVGButton *b, character_t *idtable)
     }
 }
 
-static void parseShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMovieClip *clip, SHAPE2 *swf_shape, LVGShapeCollection *shape)
+static void parseShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMovieClip *clip, shape_arena *arena, SHAPE2 *swf_shape, LVGShapeCollection *shape)
 {
-    shape->shapes = (NSVGshape*)calloc(1, /*(swf_shape->numfillstyles + swf_shape->numlinestyles)*/65536*sizeof(NSVGshape));
-
     swf_ResetReadBits(tag);
-    int fillbits = swf_GetBits(tag, 4);
-    int linebits = swf_GetBits(tag, 4);
-    // TODO: optimize
-    LINE *path = (LINE*)calloc(1, sizeof(LINE)*/*nlines*/65536);
+    BITREADER br;
+    swf_BitReaderInit(&br, tag);
+    int fillbits = swf_BitReaderGetBits(&br, 4);
+    int linebits = swf_BitReaderGetBits(&br, 4);
+    LINE *path = arena_grow_lines(&arena->lines, &arena->lines_size, 1);
     LINE *ppath = path;
     int i, fill0 = 0, fill1 = 0, line = 0, start_x = 0, start_y = 0, x = 0, y = 0;
 
     while(1)
     {
-        int flags = swf_GetBits(tag, 1);
+        int flags = swf_BitReaderGetBits(&br, 1);
         if (!flags)
         {   // style change
-            flags = swf_GetBits(tag, 5);
+            flags = swf_BitReaderGetBits(&br, 5);
 
             int subpath_size = ppath - path;
             if (subpath_size)
@@ -419,11 +548,10 @@ static void parseShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMovieCli
                 if (fill0)
                 {
                     FILLSTYLE *fs = &swf_shape->fillstyles[fill0 - 1];
-                    fs->subpaths = realloc(fs->subpaths, (fs->num_subpaths + 1)*sizeof(SUBPATH));
-                    SUBPATH *subpath = fs->subpaths + fs->num_subpaths++;
+                    SUBPATH *subpath = arena_add_subpath(arena, &fs->subpaths, &fs->num_subpaths);
                     subpath->num_lines = subpath_size + 1;
                     subpath->path_used = 0;
-                    subpath->subpath   = malloc((subpath_size + 1)*sizeof(LINE));
+                    subpath->subpath   = (LINE*)arena_alloc(arena, (subpath_size + 1)*sizeof(LINE));
                     subpath->subpath2  = 0;
                     subpath->subpath[0].type = moveTo;
                     subpath->subpath[0].x = start_x;
@@ -440,11 +568,10 @@ static void parseShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMovieCli
                     ppath = p;
                     FILLSTYLE *fs = &swf_shape->fillstyles[fill1 - 1];
                     // CCW used for normal shapes - add with reverse order
-                    fs->subpaths = realloc(fs->subpaths, (fs->num_subpaths + 1)*sizeof(SUBPATH));
-                    SUBPATH *subpath = fs->subpaths + fs->num_subpaths++;
+                    SUBPATH *subpath = arena_add_subpath(arena, &fs->subpaths, &fs->num_subpaths);
                     subpath->num_lines = subpath_size + 1;
                     subpath->path_used = 0;
-                    subpath->subpath   = malloc((subpath_size + 1)*sizeof(LINE));
+                    subpath->subpath   = (LINE*)arena_alloc(arena, (subpath_size + 1)*sizeof(LINE));
                     subpath->subpath2  = 0;
                     LINE *pline = subpath->subpath + subpath_size;
                     subpath->subpath[0].type = moveTo;
@@ -484,11 +611,10 @@ static void parseShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMovieCli
                 if (line)
                 {
                     LINESTYLE *ls = &swf_shape->linestyles[line - 1];
-                    ls->subpaths = realloc(ls->subpaths, (ls->num_subpaths + 1)*sizeof(SUBPATH));
-                    SUBPATH *subpath = ls->subpaths + ls->num_subpaths++;
+                    SUBPATH *subpath = arena_add_subpath(arena, &ls->subpaths, &ls->num_subpaths);
                     subpath->num_lines = subpath_size + 1;
                     subpath->path_used = 0;
-                    subpath->subpath   = malloc((subpath_size + 1)*sizeof(LINE));
+                    subpath->subpath   = (LINE*)arena_alloc(arena, (subpath_size + 1)*sizeof(LINE));
                     subpath->subpath2  = 0;
                     subpath->subpath[0].type = moveTo;
                     subpath->subpath[0].x = start_x;
@@ -505,13 +631,15 @@ static void parseShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMovieCli
             if (!flags || (flags & 16))
             {   // new styles or end, we must flush all shape parts here, all filled shapes must be closed
                 //printf("flush\n"); fflush(stdout);
+                NSVGshape *shapes = arena_grow_shapes(&arena->shapes, &arena->shapes_size, shape->num_shapes + swf_shape->numfillstyles + swf_shape->numlinestyles);
                 for (i = 0; i < swf_shape->numfillstyles; i++)
                 {
                     FILLSTYLE *fs = swf_shape->fillstyles + i;
                     if (!fs->num_subpaths)
                         continue;
-                    memcpy(shape->shapes[shape->num_shapes].bounds, shape->bounds, sizeof(shape->bounds));
-                    NSVGshape *s = shape->shapes + shape->num_shapes++;
+                    NSVGshape *s = shapes + shape->num_shapes++;
+                    memset(s, 0, sizeof(NSVGshape));
+                    memcpy(s->bounds, shape->bounds, sizeof(shape->bounds));
                     flushStyleToShape(e, idtable, clip, s, 0, fs, 0);
                 }
                 for (i = 0; i < swf_shape->numlinestyles; i++)
@@ -519,27 +647,28 @@ static void parseShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMovieCli
                     LINESTYLE *ls = swf_shape->linestyles + i;
                     if (!ls->num_subpaths)
                         continue;
-                    memcpy(shape->shapes[shape->num_shapes].bounds, shape->bounds, sizeof(shape->bounds));
-                    NSVGshape *s = shape->shapes + shape->num_shapes++;
+                    NSVGshape *s = shapes + shape->num_shapes++;
+                    memset(s, 0, sizeof(NSVGshape));
+                    memcpy(s->bounds, shape->bounds, sizeof(shape->bounds));
                     flushStyleToShape(e, idtable, clip, s, 0, 0, ls);
                 }
-                swf_ShapeFreeSubpaths(swf_shape);
+                arena_reset_subpaths(arena, swf_shape);
             }
 
             if (!flags)
                 break;
             if (flags & 1)
             {   // move
-                int n = swf_GetBits(tag, 5);
-                x = swf_GetSBits(tag, n);
-                y = swf_GetSBits(tag, n);
+                int n = swf_BitReaderGetBits(&br, 5);
+                x = swf_BitReaderGetSBits(&br, n);
+                y = swf_BitReaderGetSBits(&br, n);
             }
             if (flags & 2)
-                fill0 = swf_GetBits(tag, fillbits);
+                fill0 = swf_BitReaderGetBits(&br, fillbits);
             if (flags & 4)
-                fill1 = swf_GetBits(tag, fillbits);
+                fill1 = swf_BitReaderGetBits(&br, fillbits);
             if (flags & 8)
-                line  = swf_GetBits(tag, linebits);
+                line  = swf_BitReaderGetBits(&br, linebits);
             if (flags & 16)
             {
                 if (swf_shape->fillstyles)
@@ -561,27 +690,36 @@ static void parseShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMovieCli
                 swf_shape->linestyles = 0;
                 swf_shape->numlinestyles = 0;
                 swf_shape->numfillstyles = 0;
-                if (!parseFillStyleArray(tag, swf_shape))
+                swf_BitReaderSync(&br);
+                int styles_ok = parseFillStyleArray(tag, swf_shape);
+                swf_BitReaderInit(&br, tag);
+                if (!styles_ok)
                     break;
-                fillbits = swf_GetBits(tag, 4);
-                linebits = swf_GetBits(tag, 4);
+                fillbits = swf_BitReaderGetBits(&br, 4);
+                linebits = swf_BitReaderGetBits(&br, 4);
             }
             start_x = x;
             start_y = y;
         } else
         {
-            flags = swf_GetBits(tag, 1);
+            if ((ppath - path) >= arena->lines_size)
+            {
+                ptrdiff_t num_lines = ppath - path;
+                path  = arena_grow_lines(&arena->lines, &arena->lines_size, num_lines + 1);
+                ppath = path + num_lines;
+            }
+            flags = swf_BitReaderGetBits(&br, 1);
             if (flags)
             {   // straight edge
-                int n = swf_GetBits(tag, 4) + 2;
-                if (swf_GetBits(tag, 1))
+                int n = swf_BitReaderGetBits(&br, 4) + 2;
+                if (swf_BitReaderGetBits(&br, 1))
                 {   // line flag
-                    x += swf_GetSBits(tag, n); //delta x
-                    y += swf_GetSBits(tag, n); //delta y
+                    x += swf_BitReaderGetSBits(&br, n); //delta x
+                    y += swf_BitReaderGetSBits(&br, n); //delta y
                 } else
                 {
-                    int v = swf_GetBits(tag, 1);
-                    int d = swf_GetSBits(tag, n); //vert/horz
+                    int v = swf_BitReaderGetBits(&br, 1);
+                    int d = swf_BitReaderGetSBits(&br, n); //vert/horz
                     if (v)
                         y += d;
                     else
@@ -592,13 +730,13 @@ static void parseShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMovieCli
                 ppath->type = lineTo;
             } else
             {   // curved edge
-                int n = swf_GetBits(tag, 4) + 2;
-                x += swf_GetSBits(tag, n);
-                y += swf_GetSBits(tag, n);
+                int n = swf_BitReaderGetBits(&br, 4) + 2;
+                x += swf_BitReaderGetSBits(&br, n);
+                y += swf_BitReaderGetSBits(&br, n);
                 ppath->sx = x;
                 ppath->sy = y;
-                x += swf_GetSBits(tag, n);
-                y += swf_GetSBits(tag, n);
+                x += swf_BitReaderGetSBits(&br, n);
+                y += swf_BitReaderGetSBits(&br, n);
                 ppath->type = splineTo;
             }
             ppath->x = x;
@@ -606,42 +744,47 @@ static void parseShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMovieCli
             ppath++;
         }
     }
-    shape->shapes = (NSVGshape*)realloc(shape->shapes, shape->num_shapes*sizeof(NSVGshape));
+    swf_BitReaderSync(&br);
+    arena_reset_subpaths(arena, swf_shape);
+    shape->shapes = arena_finish_shapes(arena->shapes, shape->num_shapes);
     assert(shape->num_shapes);
-    free(path);
+    for (i = 0; i < shape->num_shapes; i++)
+        e->render->cache_shape(e->render_obj, shape->shapes + i);
 }
 
-static void parseMorphShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMovieClip *clip, SHAPE2 *swf_shape, LVGShapeCollection *shape)
+static void parseMorphShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMovieClip *clip, shape_arena *arena, SHAPE2 *swf_shape, LVGShapeCollection *shape)
 {
-    shape->shapes = (NSVGshape*)calloc(1, 65536*sizeof(NSVGshape));
     shape->morph = calloc(1, sizeof(LVGShapeCollection));
-    shape->morph->shapes = (NSVGshape*)calloc(1, 65536*sizeof(NSVGshape));
     LVGShapeCollection *morph_shape = shape->morph;
 
     swf_ResetReadBits(tag);
-    int fillbits = swf_GetBits(tag, 4);
-    int linebits = swf_GetBits(tag, 4);
+    BITREADER br;
+    swf_BitReaderInit(&br, tag);
+    int fillbits = swf_BitReaderGetBits(&br, 4);
+    int linebits = swf_BitReaderGetBits(&br, 4);
     //if (!fillbits && !linebits)
     //    return;
 
     TAG tag2 = *tag;
     tag2.pos = swf_shape->endEdgesOffset;
-    int fillbits2 = swf_GetBits(&tag2, 4);
-    int linebits2 = swf_GetBits(&tag2, 4);
+    BITREADER br2;
+    swf_BitReaderInit(&br2, &tag2);
+    int fillbits2 = swf_BitReaderGetBits(&br2, 4);
+    int linebits2 = swf_BitReaderGetBits(&br2, 4);
     assert(!fillbits2 && !linebits2);
 
-    LINE *path  = (LINE*)calloc(1, sizeof(LINE)*65536);
-    LINE *path2 = (LINE*)calloc(1, sizeof(LINE)*65536);
+    LINE *path  = arena_grow_lines(&arena->lines, &arena->lines_size, 1);
+    LINE *path2 = arena_grow_lines(&arena->lines2, &arena->lines2_size, arena->lines_size);
     LINE *ppath = path, *ppath2 = path2;
     int i, fill0 = 0, fill1 = 0, line = 0, start_x = 0, start_y = 0, x = 0, y = 0;
     int start_x2 = 0, start_y2 = 0, x2 = 0, y2 = 0;
 
     while (1)
     {
-        int flags = swf_GetBits(tag, 1);
+        int flags = swf_BitReaderGetBits(&br, 1);
         if (!flags)
         {   // style change
-            flags = swf_GetBits(tag, 5);
+            flags = swf_BitReaderGetBits(&br, 5);
 
             int subpath_size = ppath - path;
             if (subpath_size)
@@ -650,12 +793,11 @@ static void parseMorphShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMov
                 if (fill0)
                 {
                     FILLSTYLE *fs = &swf_shape->fillstyles[fill0 - 1];
-                    fs->subpaths  = realloc(fs->subpaths, (fs->num_subpaths + 1)*sizeof(SUBPATH));
-                    SUBPATH *subpath = fs->subpaths + fs->num_subpaths++;
+                    SUBPATH *subpath = arena_add_subpath(arena, &fs->subpaths, &fs->num_subpaths);
                     subpath->num_lines = subpath_size + 1;
                     subpath->path_used = 0;
-                    subpath->subpath   = malloc((subpath_size + 1)*sizeof(LINE));
-                    subpath->subpath2  = malloc((subpath_size + 1)*sizeof(LINE));
+                    subpath->subpath   = (LINE*)arena_alloc(arena, (subpath_size + 1)*sizeof(LINE));
+                    subpath->subpath2  = (LINE*)arena_alloc(arena, (subpath_size + 1)*sizeof(LINE));
                     subpath->subpath[0].type = moveTo;
                     subpath->subpath[0].x = start_x;
                     subpath->subpath[0].y = start_y;
@@ -678,12 +820,11 @@ static void parseMorphShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMov
                     ppath2 = path2;
                     FILLSTYLE *fs = &swf_shape->fillstyles[fill1 - 1];
                     // CCW used for normal shapes - add with reverse order
-                    fs->subpaths = realloc(fs->subpaths, (fs->num_subpaths + 1)*sizeof(SUBPATH));
-                    SUBPATH *subpath = fs->subpaths + fs->num_subpaths++;
+                    SUBPATH *subpath = arena_add_subpath(arena, &fs->subpaths, &fs->num_subpaths);
                     subpath->num_lines = subpath_size + 1;
                     subpath->path_used = 0;
-                    subpath->subpath   = malloc((subpath_size + 1)*sizeof(LINE));
-                    subpath->subpath2  = malloc((subpath_size + 1)*sizeof(LINE));
+                    subpath->subpath   = (LINE*)arena_alloc(arena, (subpath_size + 1)*sizeof(LINE));
+                    subpath->subpath2  = (LINE*)arena_alloc(arena, (subpath_size + 1)*sizeof(LINE));
                     LINE *pline  = subpath->subpath + subpath_size;
                     LINE *pline2 = subpath->subpath2 + subpath_size;
                     subpath->subpath[0].type = moveTo;
@@ -749,12 +890,11 @@ static void parseMorphShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMov
                 if (line)
                 {
                     LINESTYLE *ls = &swf_shape->linestyles[line - 1];
-                    ls->subpaths = realloc(ls->subpaths, (ls->num_subpaths + 1)*sizeof(SUBPATH));
-                    SUBPATH *subpath = ls->subpaths + ls->num_subpaths++;
+                    SUBPATH *subpath = arena_add_subpath(arena, &ls->subpaths, &ls->num_subpaths);
                     subpath->num_lines = subpath_size + 1;
                     subpath->path_used = 0;
-                    subpath->subpath   = malloc((subpath_size + 1)*sizeof(LINE));
-                    subpath->subpath2  = malloc((subpath_size + 1)*sizeof(LINE));
+                    subpath->subpath   = (LINE*)arena_alloc(arena, (subpath_size + 1)*sizeof(LINE));
+                    subpath->subpath2  = (LINE*)arena_alloc(arena, (subpath_size + 1)*sizeof(LINE));
                     subpath->subpath[0].type = moveTo;
                     subpath->subpath[0].x = start_x;
                     subpath->subpath[0].y = start_y;
@@ -776,39 +916,50 @@ static void parseMorphShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMov
             }
             if (!flags || (flags & 16))
             {   // new styles or end, we must flush all shape parts here, all filled shapes must be closed
+                int max_shapes = shape->num_shapes + swf_shape->numfillstyles + swf_shape->numlinestyles;
+                NSVGshape *shapes  = arena_grow_shapes(&arena->shapes, &arena->shapes_size, max_shapes);
+                NSVGshape *shapes2 = arena_grow_shapes(&arena->shapes2, &arena->shapes2_size, max_shapes);
                 for (i = 0; i < swf_shape->numfillstyles; i++)
                 {
                     FILLSTYLE *fs = swf_shape->fillstyles + i;
                     if (!fs->num_subpaths)
                         continue;
-                    memcpy(shape->shapes[shape->num_shapes].bounds, shape->bounds, sizeof(shape->bounds));
-                    flushStyleToShape(e, idtable, clip, shape->shapes + shape->num_shapes++, morph_shape->shapes + morph_shape->num_shapes++, fs, 0);
+                    NSVGshape *s  = shapes + shape->num_shapes++;
+                    NSVGshape *s2 = shapes2 + morph_shape->num_shapes++;
+                    memset(s, 0, sizeof(NSVGshape));
+                    memset(s2, 0, sizeof(NSVGshape));
+                    memcpy(s->bounds, shape->bounds, sizeof(shape->bounds));
+                    flushStyleToShape(e, idtable, clip, s, s2, fs, 0);
                 }
                 for (i = 0; i < swf_shape->numlinestyles; i++)
                 {
                     LINESTYLE *ls = swf_shape->linestyles + i;
                     if (!ls->num_subpaths)
                         continue;
-                    memcpy(shape->shapes[shape->num_shapes].bounds, shape->bounds, sizeof(shape->bounds));
-                    flushStyleToShape(e, idtable, clip, shape->shapes + shape->num_shapes++, morph_shape->shapes + morph_shape->num_shapes++, 0, ls);
+                    NSVGshape *s  = shapes + shape->num_shapes++;
+                    NSVGshape *s2 = shapes2 + morph_shape->num_shapes++;
+                    memset(s, 0, sizeof(NSVGshape));
+                    memset(s2, 0, sizeof(NSVGshape));
+                    memcpy(s->bounds, shape->bounds, sizeof(shape->bounds));
+                    flushStyleToShape(e, idtable, clip, s, s2, 0, ls);
                 }
-                swf_ShapeFreeSubpaths(swf_shape);
+                arena_reset_subpaths(arena, swf_shape);
             }
 
             if (!flags)
                 break;
             if (flags & 1)
             {   // move
-                int n = swf_GetBits(tag, 5);
-                x = swf_GetSBits(tag, n);
-                y = swf_GetSBits(tag, n);
+                int n = swf_BitReaderGetBits(&br, 5);
+                x = swf_BitReaderGetSBits(&br, n);
+                y = swf_BitReaderGetSBits(&br, n);
             }
             if (flags & 2)
-                fill0 = swf_GetBits(tag, fillbits);
+                fill0 = swf_BitReaderGetBits(&br, fillbits);
             if (flags & 4)
-                fill1 = swf_GetBits(tag, fillbits);
+                fill1 = swf_BitReaderGetBits(&br, fillbits);
             if (flags & 8)
-                line  = swf_GetBits(tag, linebits);
+                line  = swf_BitReaderGetBits(&br, linebits);
             if (flags & 16)
             {
                 if (swf_shape->fillstyles)
@@ -830,27 +981,38 @@ static void parseMorphShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMov
                 swf_shape->linestyles = 0;
                 swf_shape->numlinestyles = 0;
                 swf_shape->numfillstyles = 0;
-                if (!parseFillStyleArray(tag, swf_shape))
+                swf_BitReaderSync(&br);
+                int styles_ok = parseFillStyleArray(tag, swf_shape);
+                swf_BitReaderInit(&br, tag);
+                if (!styles_ok)
                     break;
-                fillbits = swf_GetBits(tag, 4);
-                linebits = swf_GetBits(tag, 4);
+                fillbits = swf_BitReaderGetBits(&br, 4);
+                linebits = swf_BitReaderGetBits(&br, 4);
             }
             start_x = x;
             start_y = y;
         } else
         {
-            flags = swf_GetBits(tag, 1);
+            if ((ppath - path) >= arena->lines_size)
+            {
+                ptrdiff_t num_lines = ppath - path, num_lines2 = ppath2 - path2;
+                path   = arena_grow_lines(&arena->lines, &arena->lines_size, num_lines + 1);
+                path2  = arena_grow_lines(&arena->lines2, &arena->lines2_size, arena->lines_size);
+                ppath  = path + num_lines;
+                ppath2 = path2 + num_lines2;
+            }
+            flags = swf_BitReaderGetBits(&br, 1);
             if (flags)
             {   // straight edge
-                int n = swf_GetBits(tag, 4) + 2;
-                if (swf_GetBits(tag, 1))
+                int n = swf_BitReaderGetBits(&br, 4) + 2;
+                if (swf_BitReaderGetBits(&br, 1))
                 {   // line flag
-                    x += swf_GetSBits(tag, n); //delta x
-                    y += swf_GetSBits(tag, n); //delta y
+                    x += swf_BitReaderGetSBits(&br, n); //delta x
+                    y += swf_BitReaderGetSBits(&br, n); //delta y
                 } else
                 {
-                    int v = swf_GetBits(tag, 1);
-                    int d = swf_GetSBits(tag, n); //vert/horz
+                    int v = swf_BitReaderGetBits(&br, 1);
+                    int d = swf_BitReaderGetSBits(&br, n); //vert/horz
                     if (v)
                         y += d;
                     else
@@ -861,13 +1023,13 @@ static void parseMorphShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMov
                 ppath->type = lineTo;
             } else
             {   // curved edge
-                int n = swf_GetBits(tag, 4) + 2;
-                x += swf_GetSBits(tag, n);
-                y += swf_GetSBits(tag, n);
+                int n = swf_BitReaderGetBits(&br, 4) + 2;
+                x += swf_BitReaderGetSBits(&br, n);
+                y += swf_BitReaderGetSBits(&br, n);
                 ppath->sx = x;
                 ppath->sy = y;
-                x += swf_GetSBits(tag, n);
-                y += swf_GetSBits(tag, n);
+                x += swf_BitReaderGetSBits(&br, n);
+                y += swf_BitReaderGetSBits(&br, n);
                 ppath->type = splineTo;
             }
             ppath->x = x;
@@ -878,23 +1040,23 @@ static void parseMorphShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMov
         ptrdiff_t subpath_size = ppath - path;
         while ((ppath2 - path2) < subpath_size)
         {
-            flags = swf_GetBits(&tag2, 1);
+            flags = swf_BitReaderGetBits(&br2, 1);
             if (!flags)
             {   // style change
-                flags = swf_GetBits(&tag2, 5);
+                flags = swf_BitReaderGetBits(&br2, 5);
 
                 if (flags & 1)
                 {   // move
-                    int n = swf_GetBits(&tag2, 5);
-                    x2 = swf_GetSBits(&tag2, n);
-                    y2 = swf_GetSBits(&tag2, n);
+                    int n = swf_BitReaderGetBits(&br2, 5);
+                    x2 = swf_BitReaderGetSBits(&br2, n);
+                    y2 = swf_BitReaderGetSBits(&br2, n);
                 }
                 if ((flags & 2) && fillbits2)
-                    swf_GetBits(&tag2, fillbits2);
+                    swf_BitReaderGetBits(&br2, fillbits2);
                 if ((flags & 4) && fillbits2)
-                    swf_GetBits(&tag2, fillbits2);
+                    swf_BitReaderGetBits(&br2, fillbits2);
                 if ((flags & 8) && linebits2)
-                    swf_GetBits(&tag2, linebits2);
+                    swf_BitReaderGetBits(&br2, linebits2);
                 if (flags & 16)
                 {
                     assert(0);
@@ -903,18 +1065,18 @@ static void parseMorphShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMov
                 start_y2 = y2;
             } else
             {
-                flags = swf_GetBits(&tag2, 1);
+                flags = swf_BitReaderGetBits(&br2, 1);
                 if (flags)
                 {   // straight edge
-                    int n = swf_GetBits(&tag2, 4) + 2;
-                    if (swf_GetBits(&tag2, 1))
+                    int n = swf_BitReaderGetBits(&br2, 4) + 2;
+                    if (swf_BitReaderGetBits(&br2, 1))
                     {   // line flag
-                        x2 += swf_GetSBits(&tag2, n); //delta x
-                        y2 += swf_GetSBits(&tag2, n); //delta y
+                        x2 += swf_BitReaderGetSBits(&br2, n); //delta x
+                        y2 += swf_BitReaderGetSBits(&br2, n); //delta y
                     } else
                     {
-                        int v = swf_GetBits(&tag2, 1);
-                        int d = swf_GetSBits(&tag2, n); //vert/horz
+                        int v = swf_BitReaderGetBits(&br2, 1);
+                        int d = swf_BitReaderGetSBits(&br2, n); //vert/horz
                         if (v)
                             y2 += d;
                         else
@@ -925,13 +1087,13 @@ static void parseMorphShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMov
                     ppath2->type = lineTo;
                 } else
                 {   // curved edge
-                    int n = swf_GetBits(&tag2, 4) + 2;
-                    x2 += swf_GetSBits(&tag2, n);
-                    y2 += swf_GetSBits(&tag2, n);
+                    int n = swf_BitReaderGetBits(&br2, 4) + 2;
+                    x2 += swf_BitReaderGetSBits(&br2, n);
+                    y2 += swf_BitReaderGetSBits(&br2, n);
                     ppath2->sx = x2;
                     ppath2->sy = y2;
-                    x2 += swf_GetSBits(&tag2, n);
-                    y2 += swf_GetSBits(&tag2, n);
+                    x2 += swf_BitReaderGetSBits(&br2, n);
+                    y2 += swf_BitReaderGetSBits(&br2, n);
                     ppath2->type = splineTo;
                 }
                 ppath2->x = x2;
@@ -940,12 +1102,14 @@ static void parseMorphShape(LVGEngine *e, TAG *tag, character_t *idtable, LVGMov
             }
         }
     }
-    shape->shapes = (NSVGshape*)realloc(shape->shapes, shape->num_shapes*sizeof(NSVGshape));
-    shape->morph->shapes = (NSVGshape*)realloc(shape->morph->shapes, shape->morph->num_shapes*sizeof(NSVGshape));
+    swf_BitReaderSync(&br);
+    arena_reset_subpaths(arena, swf_shape);
+    shape->shapes = arena_finish_shapes(arena->shapes, shape->num_shapes);
+    morph_shape->shapes = arena_finish_shapes(arena->shapes2, morph_shape->num_shapes);
     assert(shape->num_shapes);
-    assert(shape->morph->num_shapes == shape->num_shapes);
-    free(path);
-    free(path2);
+    assert(morph_shape->num_shapes == shape->num_shapes);
+    for (i = 0; i < shape->num_shapes; i++)
+        e->render->cache_shape(e->render_obj, shape->shapes + i);
 }
 
 static TAG *skip_sprite(TAG *tag)
@@ -956,7 +1120,103 @@ static TAG *skip_sprite(TAG *tag)
     return tag;
 }
 
-static void flush_stream_sound(LVGMovieClip *clip, LVGMovieClipGroup *group, const unsigned char *stream_buffer, int stream_buf_size, int stream_sound, int stream_format, int stream_bits, int stream_frame, int end_frame)
+#define SOUND_JOB_PACKETS 16    // adpcm packets of 4096 samples per channel in one block of DefineSound
+#define SOUND_JOB_SAMPLES 65536 // blocks are grouped to jobs of at least this many samples
+
+typedef struct sound_block
+{   // packet range of DefineSound or one SoundStreamBlock, packets restart predictors and decode alone
+    int pos, size, sample_pos, max_samples, first_packet, num_packets;
+} sound_block;
+
+typedef struct sound_decode
+{   // parser fills sound length and allocates samples, last finished job frees compressed data
+    LVGSound *sound;
+    unsigned char *data;
+    sound_block *blocks;
+    int num_blocks, format, pending;
+} sound_decode;
+
+typedef struct sound_job
+{
+    sound_decode *d;
+    int first_block, num_blocks;
+} sound_job;
+
+static void sound_decode_job(void *arg)
+{
+    sound_job *j = arg;
+    sound_decode *d = j->d;
+    LVGSound *sound = d->sound;
+    for (int i = j->first_block; i < j->first_block + j->num_blocks; i++)
+    {
+        sound_block *b = d->blocks + i;
+        if (1 == d->format)
+            adpcm_decode_packets(d->data + b->pos, b->size, sound->channels, sound->samples + b->sample_pos, b->max_samples, b->first_packet, b->num_packets);
+        else
+        {   // 8-bit pcm
+            for (int k = 0; k < b->size; k++)
+                sound->samples[b->sample_pos + k] = d->data[b->pos + k];
+        }
+    }
+    if (!__sync_sub_and_fetch(&d->pending, 1))
+    {
+        free(d->data);
+        free(d->blocks);
+        free(d);
+    }
+    free(j);
+}
+
+static void add_sound_job(LVGEngine *e, LVGMovieClip *clip, LVGSound *sound, unsigned char *data, int size, sound_block *blocks, int num_blocks, int format)
+{   // blocks are split between jobs when pool has threads
+    sound_decode *d = malloc(sizeof(sound_decode));
+    int i, first, samples, num_jobs = 0, len = 1 == format ? sound->num_samples*sound->channels : size;
+    if (!blocks)
+    {
+        blocks = calloc(1, sizeof(sound_block));
+        blocks->size = blocks->max_samples = size;
+        num_blocks = 1;
+    }
+    sound->samples = (short*)calloc(len ? len : 1, 2);
+    d->sound = sound;
+    d->data = data;
+    d->blocks = blocks;
+    d->num_blocks = num_blocks;
+    d->format = format;
+    if (!clip->jobs)
+        clip->jobs = jobs_create(e->load_threads);
+    int split = jobs_threads(clip->jobs) > 1;
+    sound_job *jobs = malloc(num_blocks*sizeof(sound_job));
+    for (i = 0; i < num_blocks; num_jobs++)
+    {
+        jobs[num_jobs].first_block = first = i;
+        for (samples = 0; i < num_blocks && (!split || samples < SOUND_JOB_SAMPLES); i++)
+        {
+            int n = blocks[i].num_packets*4096*sound->channels;
+            samples += blocks[i].num_packets ? (n < blocks[i].max_samples ? n : blocks[i].max_samples) : blocks[i].size;
+        }
+        jobs[num_jobs].num_blocks = i - first;
+    }
+    d->pending = num_jobs;
+    clip->num_sound_jobs += num_jobs;
+    if (!num_jobs)
+    {
+        free(data);
+        free(blocks);
+        free(d);
+    }
+    for (i = 0; i < num_jobs; i++)
+    {
+        sound_job *j = malloc(sizeof(sound_job));
+        *j = jobs[i];
+        j->d = d;
+        jobs_add(clip->jobs, sound_decode_job, j);
+    }
+    free(jobs);
+}
+
+static void flush_stream_sound(LVGEngine *e, LVGMovieClip *clip, LVGMovieClipGroup *group, unsigned char *stream_buffer, int stream_buf_size, sound_block *stream_blocks, int stream_num_blocks,
+    int stream_sound, int stream_format, int stream_bits, int stream_frame, int end_frame)
 {
     group->ssounds = realloc(group->ssounds, (group->num_ssounds + 1)*sizeof(group->ssounds[0]));
     LVGStreamSound *ssound = group->ssounds + group->num_ssounds++;
@@ -964,24 +1224,19 @@ static void flush_stream_sound(LVGMovieClip *clip, LVGMovieClipGroup *group, con
     ssound->start_frame = stream_frame;
     ssound->end_frame = end_frame;
     LVGSound *sound = clip->sounds + stream_sound;
-    if (0 == stream_format || 1 == stream_format)
-    {
-        if (stream_bits || 1 == stream_format)
-        {
-            sound->samples = (short*)stream_buffer;
-        } else
-        {
-            sound->samples = (short*)malloc(stream_buf_size*2);
-            for (int i = 0; i < stream_buf_size; i++)
-                sound->samples[i] = stream_buffer[i];
-        }
+    if (0 == stream_format && stream_bits)
+        sound->samples = (short*)stream_buffer;
+    else if ((0 == stream_format && !stream_bits) || 1 == stream_format)
+    {   // job owns compressed stream
+        add_sound_job(e, clip, sound, stream_buffer, stream_buf_size, stream_blocks, stream_num_blocks, stream_format);
+        stream_blocks = 0;
     } else
     if (2 == stream_format)
-    {
-        sound->samples = lvgLoadMP3Buf(stream_buffer, stream_buf_size, &sound->rate, &sound->channels, &sound->num_samples);
-    }
-    if (!((0 == stream_format && stream_bits) || 1 == stream_format))
-        free((void*)stream_buffer);
+    {   // sound owns compressed stream
+        lvgLoadMP3Sound(sound, stream_buffer, stream_buf_size);
+    } else
+        free(stream_buffer);
+    free(stream_blocks);
     // add action to start stream sound
     add_playsound_action(group, stream_frame, stream_sound, 0, 0, sound->num_samples, 0);
 }
@@ -996,10 +1251,12 @@ static void skipActions(TAG *tag)
     } while (op);
 }
 
-static TAG *parseGroup(LVGEngine *e, TAG *firstTag, character_t *idtable, LVGMovieClip *clip, LVGMovieClipGroup *group)
+static TAG *parseGroup(LVGEngine *e, TAG *firstTag, character_t *idtable, LVGMovieClip *clip, shape_arena *arena, LVGMovieClipGroup *group)
 {
     static const int rates[4] = { 5500, 11025, 22050, 44100 };
     int stream_sound = -1, stream_buf_size = 0, stream_samples = 0, stream_format = 0, stream_bits = 0, stream_channels = 0, stream_rate = 0, stream_frame = -1, sound_block_frame = 0;
+    sound_block *stream_blocks = 0;
+    int stream_num_blocks = 0;
     unsigned char *stream_buffer = 0;
     group->num_frames = 0;
     TAG *tag = firstTag;
@@ -1045,9 +1302,9 @@ done:
                 shapecol->bounds[1] = idtable[id].bbox.ymax/20.0f;
                 if (ST_DEFINEMORPHSHAPE == tag->id || ST_DEFINEMORPHSHAPE2 == tag->id)
                 {
-                    parseMorphShape(e, tag, idtable, clip, swf_shape, shapecol);
+                    parseMorphShape(e, tag, idtable, clip, arena, swf_shape, shapecol);
                 } else
-                    parseShape(e, tag, idtable, clip, swf_shape, shapecol);
+                    parseShape(e, tag, idtable, clip, arena, swf_shape, shapecol);
                 shapecol->bounds[0] = idtable[id].bbox.xmin/20.0f;
                 shapecol->bounds[1] = idtable[id].bbox.ymin/20.0f;
                 shapecol->bounds[2] = idtable[id].bbox.xmax/20.0f;
@@ -1067,7 +1324,7 @@ done:
                 free(data);
             } else if (ST_DEFINESPRITE == tag->id)
             {
-                tag = parseGroup(e, tag->next, idtable, clip, &clip->groups[clip->num_groups]);
+                tag = parseGroup(e, tag->next, idtable, clip, arena, &clip->groups[clip->num_groups]);
                 idtable[id].type = sprite_type;
                 idtable[id].lvg_id = clip->num_groups++;
             } else if (ST_DEFINEFONT == tag->id || ST_DEFINEFONT2 == tag->id || ST_DEFINEFONT3 == tag->id)
@@ -1100,7 +1357,7 @@ done:
                     tag2->data = shape->data;
                     tag2->len = tag2->memsize = (shape->bitlen + 7)/8;
                     if (tag2->len > 14)
-                        parseShape(e, tag2, idtable, clip, swf_shape, shapecol);
+                        parseShape(e, tag2, idtable, clip, arena, swf_shape, shapecol);
                     font->glyphs[t] = clip->num_shapes++;
                     swf_Shape2Free(swf_shape);
                     free(swf_shape);
@@ -1208,19 +1465,27 @@ done:
                 unsigned char *buf = &tag->data[tag->pos];
                 int buf_size = tag->len - tag->pos;
                 if (1 == format)
-                {
-                    sound->samples = (short*)malloc(num_samples*2*sound->channels);
-                    int dec_samples = adpcm_decode(tag, buf_size, stereo + 1, sound->samples, num_samples);
-                    assert(dec_samples == num_samples*sound->channels);
-                    sound->num_samples = dec_samples/sound->channels;
+                {   // length comes from header, packet ranges are decoded by jobs
+                    unsigned char *adpcm = malloc(buf_size);
+                    memcpy(adpcm, buf, buf_size);
+                    assert(adpcm_samples(adpcm, buf_size, sound->channels) >= num_samples*sound->channels);
+                    int num_packets = adpcm_num_packets(adpcm, buf_size, sound->channels), num_blocks = (num_packets + SOUND_JOB_PACKETS - 1)/SOUND_JOB_PACKETS;
+                    sound_block *blocks = calloc(num_blocks ? num_blocks : 1, sizeof(sound_block));
+                    for (int i = 0; i < num_blocks; i++)
+                    {
+                        blocks[i].size = buf_size;
+                        blocks[i].max_samples = num_samples*sound->channels;
+                        blocks[i].first_packet = i*SOUND_JOB_PACKETS;
+                        blocks[i].num_packets = num_packets - blocks[i].first_packet < SOUND_JOB_PACKETS ? num_packets - blocks[i].first_packet : SOUND_JOB_PACKETS;
+                    }
+                    sound->num_samples = num_samples;
+                    add_sound_job(e, clip, sound, adpcm, buf_size, blocks, num_blocks, format);
                 } else
                 if (2 == format)
-                {
-                    int rate, channels;
-                    sound->samples = lvgLoadMP3Buf(buf, buf_size, &rate, &channels, &sound->num_samples);
-                    assert(/*num_samples == sound->num_samples && */sound->channels == channels && sound->rate == rate);
-                    sound->channels = channels;
-                    sound->rate     = rate;
+                {   // keep compressed, rate and channels come from frame headers
+                    unsigned char *mp3 = malloc(buf_size);
+                    memcpy(mp3, buf, buf_size);
+                    lvgLoadMP3Sound(sound, mp3, buf_size);
                 }
                 swf_SetTagPos(tag, oldTagPos);
                 idtable[id].type = sound_type;
@@ -1347,20 +1612,20 @@ done:
                 stream_frame = nframe;
 
             if (1 == stream_format)
-            {
-                short *buf = (short*)malloc(size*16);
-                int dec_samples = adpcm_decode(tag, size, stream_channels, buf, size*8);
-                stream_buf_size += dec_samples*2;
-                stream_buffer = (unsigned char *)realloc(stream_buffer, stream_buf_size);
-                memcpy(stream_buffer + old_size, buf, dec_samples*2);
-                sound->num_samples += dec_samples/stream_channels;
-                free(buf);
-            } else
-            {
-                stream_buf_size += size;
-                stream_buffer = (unsigned char *)realloc(stream_buffer, stream_buf_size);
-                memcpy(stream_buffer + old_size, &tag->data[tag->pos], size);
+            {   // blocks are decoded by jobs when stream is flushed
+                stream_blocks = (sound_block *)realloc(stream_blocks, (stream_num_blocks + 1)*sizeof(sound_block));
+                sound_block *b = stream_blocks + stream_num_blocks++;
+                b->pos = old_size;
+                b->size = size;
+                b->sample_pos = sound->num_samples*stream_channels;
+                b->max_samples = adpcm_samples(&tag->data[tag->pos], size, stream_channels);
+                b->first_packet = 0;
+                b->num_packets = adpcm_num_packets(&tag->data[tag->pos], size, stream_channels);
+                sound->num_samples += b->max_samples/stream_channels;
             }
+            stream_buf_size += size;
+            stream_buffer = (unsigned char *)realloc(stream_buffer, stream_buf_size);
+            memcpy(stream_buffer + old_size, &tag->data[tag->pos], size);
             sound_block_frame = 1;
             swf_SetTagPos(tag, oldTagPos);
         } else if (ST_VIDEOFRAME == tag->id)
@@ -1411,8 +1676,10 @@ done:
         {
             if (stream_buffer && !sound_block_frame)
             {
-                flush_stream_sound(clip, group, stream_buffer, stream_buf_size, stream_sound, stream_format, stream_bits, stream_frame, nframe);
+                flush_stream_sound(e, clip, group, stream_buffer, stream_buf_size, stream_blocks, stream_num_blocks, stream_sound, stream_format, stream_bits, stream_frame, nframe);
                 stream_buffer = NULL;
+                stream_blocks = NULL;
+                stream_num_blocks = 0;
                 stream_samples = stream_buf_size = 0;
                 stream_sound = stream_frame = -1;
             }
@@ -1424,7 +1691,7 @@ done:
     }
     if (stream_buffer)
     {
-        flush_stream_sound(clip, group, stream_buffer, stream_buf_size, stream_sound, stream_format, stream_bits, stream_frame, nframe);
+        flush_stream_sound(e, clip, group, stream_buffer, stream_buf_size, stream_blocks, stream_num_blocks, stream_sound, stream_format, stream_bits, stream_frame, nframe);
 #ifndef _TEST
         //assert(stream_samples == clip->sounds[stream_sound].num_samples);
 #endif
@@ -1433,8 +1700,59 @@ done:
     return tag;
 }
 
+#define KEYFRAME_INTERVAL 32 // frames between full display lists, bounds seek cost
+
+static int same_object(const LVGObject *a, const LVGObject *b)
+{   // place flag is per frame
+    LVGObject x = *a, y = *b;
+    x.flags &= ~1;
+    y.flags &= ~1;
+    return !memcmp(&x, &y, sizeof(x));
+}
+
+static void frame_delta(LVGMovieClipFrame *frame, const LVGObject *prev, int num_prev, const LVGObject *cur, int num_cur)
+{   // merge display lists of previous and current frame, both sorted by depth
+    int i = 0, j = 0;
+    for (i = 1; i < num_prev; i++)
+        assert(prev[i - 1].depth < prev[i].depth);
+    for (i = 1; i < num_cur; i++)
+        assert(cur[i - 1].depth < cur[i].depth);
+    i = 0;
+    frame->changes = malloc(sizeof(LVGObject)*(num_cur + 1));
+    frame->removed = malloc(sizeof(int)*(num_prev + 1));
+    while (i < num_prev || j < num_cur)
+    {
+        if (j == num_cur || (i < num_prev && prev[i].depth < cur[j].depth))
+            frame->removed[frame->num_removed++] = prev[i++].depth;
+        else if (i == num_prev || cur[j].depth < prev[i].depth)
+            frame->changes[frame->num_changes++] = cur[j++];
+        else
+        {
+            if ((cur[j].flags & 1) || !same_object(prev + i, cur + j))
+                frame->changes[frame->num_changes++] = cur[j];
+            i++, j++;
+        }
+    }
+    if (frame->num_changes)
+        frame->changes = realloc(frame->changes, sizeof(LVGObject)*frame->num_changes);
+    else
+    {
+        free(frame->changes);
+        frame->changes = 0;
+    }
+    if (frame->num_removed)
+        frame->removed = realloc(frame->removed, sizeof(int)*frame->num_removed);
+    else
+    {
+        free(frame->removed);
+        frame->removed = 0;
+    }
+}
+
 static TAG *parsePlacements(TAG *firstTag, character_t *idtable, LVGMovieClip *clip, LVGMovieClipGroup *group, int version)
 {
+    LVGObject *prev = 0, *cur;
+    int num_prev = 0;
     group->num_frames = 0;
     SWFPLACEOBJECT *placements = (SWFPLACEOBJECT*)calloc(1, sizeof(SWFPLACEOBJECT)*65536);
     int i, j;
@@ -1531,7 +1849,10 @@ static TAG *parsePlacements(TAG *firstTag, character_t *idtable, LVGMovieClip *c
             {
                 assert(placements[depth].id == id);
             }
+            if (placements[depth].name)
+                free(placements[depth].name);
             swf_GetPlaceObject(0, placements + depth, version);
+            placements[depth].id = INVALID_ID; // not drawn, depth must not show up in display list
             swf_SetTagPos(tag, oldTagPos);
         } else if (ST_FRAMELABEL == tag->id)
         {
@@ -1552,8 +1873,7 @@ do_show_frame:
                 numplacements++;
             }
             LVGMovieClipFrame *frame = group->frames + group->num_frames;
-            frame->num_objects = numplacements;
-            frame->objects = calloc(1, sizeof(LVGObject)*numplacements);
+            cur = calloc(1, sizeof(LVGObject)*(numplacements + 1));
             for (i = 0, j = 0; i < 65536; i++)
             {
                 SWFPLACEOBJECT *p = &placements[i];
@@ -1561,11 +1881,11 @@ do_show_frame:
                     continue;
                 MATRIX *m = &p->matrix;
                 CXFORM *cx = &p->cxform;
-                LVGObject *o = &frame->objects[j++];
+                LVGObject *o = &cur[j++];
                 character_t *c = &idtable[p->id];
                 o->id = c->lvg_id;
                 o->type = c->type;
-                o->depth = p->depth;
+                o->depth = i;
                 o->ratio = p->ratio;
                 o->blend_mode = p->blendmode ? p->blendmode - 1 : 0;
                 o->t[0] = m->sx/65536.0f;
@@ -1589,33 +1909,23 @@ do_show_frame:
                     frame->obj_labels = realloc(frame->obj_labels, (frame->num_labels + 1)*sizeof(frame->obj_labels[0]));
                     LVGObjectLabel *l = frame->obj_labels + frame->num_labels++;
                     l->name = p->name;
+                    l->atom = atom_intern(p->name);
                     l->type = o->type;
                     l->id   = o->id;
                     p->name = 0;
                 }
-#ifdef LVG_INTERPOLATE
-                if (group->num_frames)
-                {
-                    LVGMovieClipFrame *prev = group->frames + group->num_frames - 1;
-                    for (int k = 0; k < prev->num_objects; k++)
-                    {
-                        LVGObject *prev_o = prev->objects + k;
-                        if (prev_o->depth == o->depth && prev_o->id == o->id)
-                        {
-                            if (prev_o->ratio != o->ratio || memcmp(prev_o->t, o->t, sizeof(o->t)))
-                            {   // have previous object and it's moving
-                                if (abs(prev_o->ratio - o->ratio) > 16384 ||
-                                   (fabs(prev_o->t[4] - o->t[4]) > 200) || (fabs(prev_o->t[5] - o->t[5]) > 200) ||
-                                   (fabs(prev_o->t[0] - o->t[0]) > 0.3) || (fabs(prev_o->t[3] - o->t[3]) > 0.3))
-                                    break;
-                                prev_o->interpolate_obj = o;
-                            }
-                            break;
-                        }
-                    }
-                }
-#endif
             }
+            if (!(group->num_frames % KEYFRAME_INTERVAL))
+            {
+                frame->keyframe = 1;
+                frame->num_objects = j;
+                frame->objects = malloc(sizeof(LVGObject)*(j + 1));
+                memcpy(frame->objects, cur, sizeof(LVGObject)*j);
+            } else
+                frame_delta(frame, prev, num_prev, cur, j);
+            free(prev);
+            prev = cur;
+            num_prev = j;
             group->num_frames++;
             if (ST_END == tag->id)
                 break;
@@ -1631,6 +1941,7 @@ do_show_frame:
         if (placements[i].name)
             free(placements[i].name);
     free(placements);
+    free(prev);
     assert(tag && ST_END == tag->id);
     return tag;
 }
@@ -1734,7 +2045,10 @@ done:
     clip->num_groups = 1;
     clip->num_fonts  = 0;
     clip->num_sounds = 0;
-    parseGroup(e, swf->firstTag, idtable, clip, clip->groups);
+    shape_arena arena;
+    memset(&arena, 0, sizeof(arena));
+    parseGroup(e, swf->firstTag, idtable, clip, &arena, clip->groups);
+    arena_free(&arena);
     clip->num_groups = 1;
     clip->num_groupstates = 1;
     clip->groupstates = calloc(1, sizeof(LVGMovieClipGroupState));
@@ -1749,28 +2063,225 @@ done:
     return clip;
 }
 
+#ifdef _TEST
+static double bench_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static inline __attribute__((always_inline)) uint32_t bench_bits(TAG *tag, BITREADER *br, int cached, int n)
+{
+    return cached ? swf_BitReaderGetBits(br, n) : swf_GetBits(tag, n);
+}
+
+static inline __attribute__((always_inline)) int32_t bench_sbits(TAG *tag, BITREADER *br, int cached, int n)
+{
+    return cached ? swf_BitReaderGetSBits(br, n) : swf_GetSBits(tag, n);
+}
+
+static inline __attribute__((always_inline)) int64_t bench_edges(TAG *tag, int cached)
+{   // decode shape records same way as parseShape does, without building paths
+    BITREADER br;
+    SHAPE2 styles;
+    int64_t sum = 0;
+    int x = 0, y = 0;
+    memset(&styles, 0, sizeof(styles));
+    swf_ResetReadBits(tag);
+    swf_BitReaderInit(&br, tag);
+    int fillbits = bench_bits(tag, &br, cached, 4);
+    int linebits = bench_bits(tag, &br, cached, 4);
+    while (1)
+    {
+        if (!bench_bits(tag, &br, cached, 1))
+        {   // style change
+            int flags = bench_bits(tag, &br, cached, 5);
+            if (!flags)
+                break;
+            if (flags & 1)
+            {
+                int n = bench_bits(tag, &br, cached, 5);
+                x = bench_sbits(tag, &br, cached, n);
+                y = bench_sbits(tag, &br, cached, n);
+            }
+            if (flags & 2)
+                sum += bench_bits(tag, &br, cached, fillbits);
+            if (flags & 4)
+                sum += bench_bits(tag, &br, cached, fillbits);
+            if (flags & 8)
+                sum += bench_bits(tag, &br, cached, linebits);
+            if (flags & 16)
+            {
+                if (cached)
+                    swf_BitReaderSync(&br);
+                int styles_ok = parseFillStyleArray(tag, &styles);
+                swf_Shape2Free(&styles);
+                memset(&styles, 0, sizeof(styles));
+                swf_BitReaderInit(&br, tag);
+                if (!styles_ok)
+                    break;
+                fillbits = bench_bits(tag, &br, cached, 4);
+                linebits = bench_bits(tag, &br, cached, 4);
+            }
+        } else if (bench_bits(tag, &br, cached, 1))
+        {   // straight edge
+            int n = bench_bits(tag, &br, cached, 4) + 2;
+            if (bench_bits(tag, &br, cached, 1))
+            {
+                x += bench_sbits(tag, &br, cached, n);
+                y += bench_sbits(tag, &br, cached, n);
+            } else if (bench_bits(tag, &br, cached, 1))
+                y += bench_sbits(tag, &br, cached, n);
+            else
+                x += bench_sbits(tag, &br, cached, n);
+        } else
+        {   // curved edge
+            int n = bench_bits(tag, &br, cached, 4) + 2;
+            x += bench_sbits(tag, &br, cached, n);
+            y += bench_sbits(tag, &br, cached, n);
+            x += bench_sbits(tag, &br, cached, n);
+            y += bench_sbits(tag, &br, cached, n);
+        }
+        sum += x + y;
+    }
+    if (cached)
+        swf_BitReaderSync(&br);
+    return sum + tag->pos;
+}
+
+static int64_t bench_edges_tag(TAG *tag)
+{
+    return bench_edges(tag, 0);
+}
+
+static int64_t bench_edges_cached(TAG *tag)
+{
+    return bench_edges(tag, 1);
+}
+
+static void bench_shapes(SWF *swf)
+{
+#define BENCH_ITERATIONS 100
+    double t_tag = 0, t_cached = 0;
+    int64_t sum_tag = 0, sum_cached = 0;
+    int i, num_shapes = 0;
+    for (TAG *tag = swf->firstTag; tag; tag = tag->next)
+    {
+        if (!swf_isShapeTag(tag) || ST_DEFINEMORPHSHAPE == tag->id || ST_DEFINEMORPHSHAPE2 == tag->id)
+            continue;
+        SHAPE2 swf_shape;
+        swf_ParseDefineShape(tag, &swf_shape);
+        swf_Shape2Free(&swf_shape);
+        uint32_t pos = tag->pos;
+        double t = bench_time();
+        for (i = 0; i < BENCH_ITERATIONS; i++)
+        {
+            swf_SetTagPos(tag, pos);
+            sum_tag += bench_edges_tag(tag);
+        }
+        double t2 = bench_time();
+        for (i = 0; i < BENCH_ITERATIONS; i++)
+        {
+            swf_SetTagPos(tag, pos);
+            sum_cached += bench_edges_cached(tag);
+        }
+        t_cached += bench_time() - t2;
+        t_tag += t2 - t;
+        num_shapes++;
+    }
+    printf("bench: shape bits: %d shapes, tag reader %.2fus, cached reader %.2fus%s\n", num_shapes,
+        t_tag*1e6/BENCH_ITERATIONS, t_cached*1e6/BENCH_ITERATIONS, (sum_tag != sum_cached) ? ", MISMATCH" : "");
+}
+#endif
+
+typedef struct inflate_reader
+{   // CWS payload decompressed on demand while tags are read
+    zipInflate_t stream;
+    char header[8];
+    uint32_t size;
+} inflate_reader;
+
+static int reader_inflate_read(reader_t *reader, void *data, int len)
+{
+    inflate_reader *ir = (inflate_reader *)reader->internal;
+    int n = 0;
+    if (len > (int)(ir->size - reader->pos))
+        len = ir->size - reader->pos;
+    while (reader->pos + n < 8 && n < len)
+    {
+        ((char *)data)[n] = ir->header[reader->pos + n];
+        n++;
+    }
+    if (n < len)
+    {
+        int ret = lvgInflatePull(&ir->stream, (char *)data + n, len - n);
+        if (ret > 0)
+            n += ret;
+    }
+    reader->pos += n;
+    return n;
+}
+
+static int reader_inflate_seek(reader_t *reader, int pos)
+{
+    return -1;
+}
+
+static void reader_inflate_dealloc(reader_t *reader)
+{
+    inflate_reader *ir = (inflate_reader *)reader->internal;
+    if (ir)
+    {
+        lvgInflateFree(&ir->stream);
+        free(ir);
+    }
+    memset(reader, 0, sizeof(reader_t));
+}
+
+static int reader_init_inflatereader(reader_t *r, const char *b, size_t file_size)
+{
+    inflate_reader *ir = (inflate_reader *)malloc(sizeof(inflate_reader));
+    if (!ir || lvgInflateInit(&ir->stream, 1))
+    {
+        free(ir);
+        return -1;
+    }
+    memcpy(ir->header, b, 8);
+    ir->header[0] = 'F';
+    ir->size = GET32(&b[4]);
+    lvgInflateFeed(&ir->stream, b + 8, file_size - 8, 1);
+    memset(r, 0, sizeof(reader_t));
+    r->read = reader_inflate_read;
+    r->seek = reader_inflate_seek;
+    r->dealloc = reader_inflate_dealloc;
+    r->internal = ir;
+    r->bitpos = 8;
+    return 0;
+}
+
 LVGMovieClip *lvgClipLoadBuf(LVGEngine *e, char *b, size_t file_size, int free_buf)
 {
     SWF swf;
     if ((b[0] != 'F' && b[0] != 'C') || b[1] != 'W' || b[2] != 'S')
         return 0;
-    uint32_t uncompressedSize = GET32(&b[4]);
 
     reader_t reader;
+    int ret = -1;
     if (b[0] == 'C')
+    {   // tags are read while payload is being decompressed, no full uncompressed copy
+        if (file_size >= 8 && !reader_init_inflatereader(&reader, b, file_size))
+            ret = 0;
+    } else
+    {
+        reader_init_memreader(&reader, (void*)b, file_size);
+        ret = 0;
+    }
+    if (!ret)
     {
-        char *u_data = malloc(uncompressedSize + 8);
-        memcpy(u_data, b, 8);
-        u_data[0] = 'F';
-        stbi_zlib_decode_buffer(u_data + 8, uncompressedSize - 8, b + 8, file_size - 8);
-        if (free_buf)
-            free(b);
-        free_buf = 1;
-        b = u_data;
-        file_size = uncompressedSize;
+        ret = swf_ReadSWF2(&reader, &swf);
+        reader.dealloc(&reader);
     }
-    reader_init_memreader(&reader, (void*)b, file_size);
-    int ret = swf_ReadSWF2(&reader, &swf);
     if (free_buf)
         free(b);
     if (ret < 0)
@@ -1778,9 +2289,12 @@ LVGMovieClip *lvgClipLoadBuf(LVGEngine *e, char *b, size_t file_size, int free_b
         printf("error: could not open swf.\n");
         return 0;
     }
+#ifdef _TEST
+    if (e->b_benchmark)
+        bench_shapes(&swf);
+#endif
     LVGMovieClip *clip = swf_ReadObjects(e, &swf);
     swf_FreeTags(&swf);
-    reader.dealloc(&reader);
     int i;
     if (clip)
         for (i = 0; i < clip->num_sounds; i++)
@@ -1790,12 +2304,14 @@ LVGMovieClip *lvgClipLoadBuf(LVGEngine *e, char *b, size_t file_size, int free_b
 
 LVGMovieClip *lvgClipLoad(LVGEngine *e, const char *file)
 {
-    char *b;
+    const char *b;
     uint32_t file_size;
-    if (!(b = lvgGetFileContents(e, file, &file_size)))
+    if (!(b = lvgGetFileView(e, file, &file_size)))
     {
         printf("error: could not open swf.\n");
         return 0;
     }
-    return lvgClipLoadBuf(e, b, file_size, 1);
+    LVGMovieClip *clip = lvgClipLoadBuf(e, (char *)b, file_size, 0);
+    lvgReleaseFileView(e, b);
+    return clip;
 }
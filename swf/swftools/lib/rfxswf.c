@@ -199,6 +199,68 @@ int32_t swf_GetSBits(TAG *t, int nbits)
     return (int32_t)res;
 }
 
+void swf_BitReaderInit(BITREADER *br, TAG *t)
+{
+    br->tag   = t;
+    br->cache = 0;
+    br->bits  = 0;
+    br->pos   = t->pos;
+    br->tag_owned = t->pos >= t->len;
+    if (t->readBit && !br->tag_owned)
+    {   // continue from partially read byte
+        br->bits  = __builtin_ctz(t->readBit) + 1;
+        br->cache = (uint64_t)(t->data[t->pos] & ((t->readBit << 1) - 1)) << (64 - br->bits);
+        br->pos++;
+    }
+}
+
+void swf_BitReaderSync(BITREADER *br)
+{
+    if (br->tag_owned)
+        return;
+    uint64_t bitpos = (uint64_t)br->pos*8 - br->bits;
+    br->tag->pos = (uint32_t)(bitpos >> 3);
+    br->tag->readBit = (bitpos & 7) ? (0x80 >> (bitpos & 7)) : 0;
+}
+
+static void swf_BitReaderRefill(BITREADER *br)
+{
+    TAG *t = br->tag;
+    if (br->pos + 8 <= t->len)
+    {   // load whole word, bits of partially loaded last byte are loaded again by next refill
+        uint64_t v;
+        memcpy(&v, t->data + br->pos, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        v = __builtin_bswap64(v);
+#endif
+        br->cache |= v >> br->bits;
+        int bytes = (63 - br->bits) >> 3;
+        br->pos  += bytes;
+        br->bits += bytes*8;
+        return;
+    }
+    while (br->bits <= 56 && br->pos < t->len)
+    {
+        br->cache |= (uint64_t)t->data[br->pos++] << (56 - br->bits);
+        br->bits += 8;
+    }
+}
+
+uint32_t swf_BitReaderGetBitsSlow(BITREADER *br, int nbits)
+{
+    if (!br->tag_owned)
+    {
+        swf_BitReaderRefill(br);
+        if (br->bits >= nbits)
+            return swf_BitReaderGetBits(br, nbits);
+        swf_BitReaderSync(br);
+    }
+    // not enough data - let swf_GetBits() handle out of bounds read
+    uint32_t res = swf_GetBits(br->tag, nbits);
+    swf_BitReaderInit(br, br->tag);
+    return res;
+}
+
 uint32_t reader_GetBits(reader_t *reader, int nbits)
 {
     return reader_readbits(reader, nbits);
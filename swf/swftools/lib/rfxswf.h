@@ -224,6 +224,44 @@ int   swf_SetBits(TAG * t,uint32_t v,int nbits);
 int   swf_CountUBits(uint32_t v,int nbits);
 int   swf_CountBits(uint32_t v,int nbits);
 
+// Cached Bit Reader
+// pulls multi-bit fields from a 64-bit cache, use it for long bit-packed records (shape edges etc.)
+// TAG position is updated only by swf_BitReaderSync(), call it before using other swf_Get* functions
+
+typedef struct _BITREADER
+{
+    TAG      *tag;
+    uint64_t  cache;        // unread bits, msb first
+    uint32_t  pos;          // next byte to load into cache
+    int       bits;         // number of valid bits in cache
+    int       tag_owned;    // reader hit end of tag data, TAG holds the state
+} BITREADER;
+
+void  swf_BitReaderInit(BITREADER *br, TAG *t);
+void  swf_BitReaderSync(BITREADER *br);
+uint32_t swf_BitReaderGetBitsSlow(BITREADER *br, int nbits);
+
+static inline uint32_t swf_BitReaderGetBits(BITREADER *br, int nbits)
+{
+    uint32_t res;
+    if (!nbits)
+        return 0;
+    if (br->bits < nbits)
+        return swf_BitReaderGetBitsSlow(br, nbits);
+    res = (uint32_t)(br->cache >> (64 - nbits));
+    br->cache <<= nbits;
+    br->bits -= nbits;
+    return res;
+}
+
+static inline int32_t swf_BitReaderGetSBits(BITREADER *br, int nbits)
+{
+    if (!nbits)
+        return 0;
+    uint32_t res = swf_BitReaderGetBits(br, nbits);
+    return (int32_t)(res << (32 - nbits)) >> (32 - nbits);
+}
+
 int   swf_GetBlock(TAG * t,uint8_t * b,int l);   // resets Bitcount
 int   swf_SetBlock(TAG * t,const uint8_t * b,int l);
 
@@ -0,0 +1,34 @@
+_FILENAME=${0##*/}
+CUR_DIR=${0/${_FILENAME}}
+CUR_DIR=$(cd $(dirname ${CUR_DIR}); pwd)/$(basename ${CUR_DIR})/
+
+pushd $CUR_DIR > /dev/null
+
+APP=../../build/lvg_test
+if [ ! -f "$APP" ]; then
+    echo "build lvg_test first (see test.sh)"
+    exit 1
+fi
+
+# runs lvg_test in benchmark mode over trace corpus and sums up reported timings
+for i in trace/*.swf; do
+    $APP -b $i 2>/dev/null | grep "^bench: "
+done | awk -F': ' '
+{
+    split($3, f, ", ")
+    for (k in f)
+    {
+        n = split(f[k], w, " ")
+        val = w[n]; unit = val; sub(/^[0-9.]+/, "", unit); sub(/[a-zA-Z%]+$/, "", val)
+        name = $2 ": " f[k]; sub(/ [0-9.]+[a-zA-Z%]*$/, "", name)
+        if (val == "" || f[k] ~ /MISMATCH/) { if (f[k] ~ /MISMATCH/) mismatch[$2]++; continue }
+        sum[name] += val; cnt[name]++; units[name] = unit
+    }
+}
+END {
+    for (name in sum)
+        printf("%s %.2f%s\n", name, name ~ /\/sec$/ ? sum[name]/cnt[name] : sum[name], units[name]) # rates are averaged
+    for (name in mismatch)
+        printf("%s: %d MISMATCH\n", name, mismatch[name])
+}' | sort
+popd > /dev/null
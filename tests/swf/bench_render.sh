@@ -0,0 +1,38 @@
+_FILENAME=${0##*/}
+CUR_DIR=${0/${_FILENAME}}
+CUR_DIR=$(cd $(dirname ${CUR_DIR}); pwd)/$(basename ${CUR_DIR})/
+
+pushd $CUR_DIR > /dev/null
+
+APP=../../build/lvg_test
+if [ ! -f "$APP" ]; then
+    echo "build lvg_test first (see test.sh)"
+    exit 1
+fi
+
+# renders svg and trace corpus with software render at several thread counts
+# usage: bench_render.sh [thread counts], default 1 2 4 8
+THREADS=${@:-1 2 4 8}
+for t in $THREADS; do
+    for i in ../svg/*.svg trace/*.swf; do
+        $APP -b -s -t$t $i 2>/dev/null | grep "^bench: render sw"
+    done
+done | awk -F': ' '
+{
+    split($2, g, " "); t = g[3]
+    split($3, f, ", ")
+    for (k in f)
+    {
+        n = split(f[k], w, " ")
+        val = w[n]; sub(/[a-z]+$/, "", val)
+        name = f[k]; sub(/ [0-9.]+[a-z]*$/, "", name)
+        sum[t, name] += val
+    }
+    threads[t] = 1
+}
+END {
+    for (t in threads)
+        printf("render sw %d threads: frame time %.2fus, raster time %.2fus, raster speedup %.2fx\n", t,
+            sum[t, "frame time"], sum[t, "raster time"], sum[1, "raster time"] ? sum[1, "raster time"]/sum[t, "raster time"] : 0)
+}' | sort -n -k3
+popd > /dev/null